@@ -0,0 +1,199 @@
+// bytecraft_bench.cpp:
+//    Throughput baselines: dispatch per instruction class and engine,
+//    memory operands, syscalls, the assembler and the BVM loader.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/bench.hpp"
+#include "bytecraft/bytecode.hpp"
+#include "bytecraft/gen.hpp"
+#include "bytecraft/vm.hpp"
+
+namespace {
+
+constexpr int ENGINE_COUNT = static_cast<int>(bc::Engine::Tiered) + 1;
+
+// Loop bodies per instruction class; each runs LOOP_COUNT times between
+// "loop:" and the closing cmp/jneq.
+constexpr int LOOP_COUNT = 100000;
+
+const char* const MOV_BODY =
+  "  mov r2, r1\n"
+  "  mov r3, 7\n"
+  "  mov r4, r2\n"
+  "  mov r5, r3\n";
+
+const char* const ALU_BODY =
+  "  add r2, r1\n"
+  "  xor r3, r2\n"
+  "  sub r4, r3\n"
+  "  add r5, 3\n";
+
+const char* const BRANCH_BODY =
+  "  cmp r1, 7\n"
+  "  jeq skip\n"
+  "  jmp skip\n"
+  "skip:\n"
+  "  cmp r2, r1\n"
+  "  jla skip2\n"
+  "skip2:\n";
+
+const char* const MEMORY_BODY =
+  "  mov r2, [a]\n"
+  "  add r2, r1\n"
+  "  mov [b], r2\n"
+  "  mov r3, [b]\n"
+  "  mov [a], r3\n";
+
+// Zero-length write to stdout: the cost of crossing into the host and back.
+const char* const SYSCALL_BODY =
+  "  mov r6, r1\n"
+  "  mov r1, 1\n"
+  "  mov r2, 1\n"
+  "  mov r3, a\n"
+  "  mov r4, 0\n"
+  "  syscall\n"
+  "  mov r1, r6\n";
+
+std::string loop_source(const char* body) {
+  return std::string("_main:\n"
+                     "  mov r1, 0\n"
+                     "loop:\n")
+       + body
+       + "  add r1, 1\n"
+         "  cmp r1, " + std::to_string(LOOP_COUNT) + "\n"
+         "  jneq loop\n"
+         "  mov r1, 0\n"
+         "  syscall\n"
+         "_data:\n"
+         "  DB a[4]\n"
+         "  DB b[4]\n";
+}
+
+// Generated source with @p block_count labelled blocks (bytecraft gen large).
+std::string large_source(int block_count) {
+  bc::GenOptions options;
+  options.workload = bc::Workload::Large;
+  options.size = static_cast<std::uint32_t>(block_count);
+  return bc::generate_program(options);
+}
+
+bc::Module assemble(const std::string& source) {
+  bc::Assembler assembler;
+  bc::Module module;
+  std::string error_message;
+  if (!assembler.assemble_string(source, module, error_message)) {
+    std::fprintf(stderr, "bench source failed to assemble: %s\n", error_message.c_str());
+  }
+  return module;
+}
+
+// Instructions one run of @p module executes, counted once with --stats.
+std::uint64_t count_instructions(const bc::Module& module) {
+  bc::VM vm = bc::make_bench_vm(module, bc::Engine::Switch);
+  vm.set_stats(true);
+  vm.run();
+  return vm.stats()->counter(bc::ExecStats::INSTRUCTION_SLOT);
+}
+
+// Runs the loop around @p body to completion on the engine in range(0).
+void run_loop(benchmark::State& state, const char* body) {
+  bc::Engine engine = static_cast<bc::Engine>(state.range(0));
+  bc::Module module = assemble(loop_source(body));
+  std::uint64_t instructions = count_instructions(module);
+  state.SetLabel(bc::engine_name(engine));
+
+  for (auto _ : state) {
+    bc::VM vm = bc::make_bench_vm(module, engine);
+    vm.run();
+    benchmark::DoNotOptimize(vm.get_register(bc::R5));
+  }
+  state.counters["instrs/s"] = benchmark::Counter(static_cast<double>(instructions * state.iterations()),
+                                                  benchmark::Counter::kIsRate);
+}
+
+void BM_DispatchMov(benchmark::State& state) {
+  run_loop(state, MOV_BODY);
+}
+
+void BM_DispatchAlu(benchmark::State& state) {
+  run_loop(state, ALU_BODY);
+}
+
+void BM_DispatchBranch(benchmark::State& state) {
+  run_loop(state, BRANCH_BODY);
+}
+
+void BM_MemoryOperands(benchmark::State& state) {
+  run_loop(state, MEMORY_BODY);
+}
+
+void BM_Syscall(benchmark::State& state) {
+  run_loop(state, SYSCALL_BODY);
+}
+
+void BM_Assemble(benchmark::State& state) {
+  std::string source = large_source(static_cast<int>(state.range(0)));
+  for (auto _ : state) {
+    bc::Assembler assembler;
+    bc::Module module;
+    std::string error_message;
+    benchmark::DoNotOptimize(assembler.assemble_string(source, module, error_message));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(source.size()) * state.iterations());
+}
+
+std::string temp_bvm_path() {
+  return (std::filesystem::temp_directory_path() / "bytecraft_bench.bvm").string();
+}
+
+std::size_t module_bytes(const bc::Module& module) {
+  return module.code_section.size() + module.data_section.size();
+}
+
+void BM_SaveBvm(benchmark::State& state) {
+  bc::Module module = assemble(large_source(static_cast<int>(state.range(0))));
+  std::string path = temp_bvm_path();
+  std::string error_message;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bc::save_bvm(path, module, error_message));
+  }
+  std::remove(path.c_str());
+  state.SetBytesProcessed(static_cast<std::int64_t>(module_bytes(module)) * state.iterations());
+}
+
+void BM_LoadBvm(benchmark::State& state) {
+  bc::Module module = assemble(large_source(static_cast<int>(state.range(0))));
+  std::string path = temp_bvm_path();
+  std::string error_message;
+  if (!bc::save_bvm(path, module, error_message)) {
+    state.SkipWithError(error_message.c_str());
+    return;
+  }
+  for (auto _ : state) {
+    bc::Module loaded;
+    benchmark::DoNotOptimize(bc::load_bvm(path, loaded, error_message));
+  }
+  std::remove(path.c_str());
+  state.SetBytesProcessed(static_cast<std::int64_t>(module_bytes(module)) * state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BM_DispatchMov)->DenseRange(0, ENGINE_COUNT - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DispatchAlu)->DenseRange(0, ENGINE_COUNT - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DispatchBranch)->DenseRange(0, ENGINE_COUNT - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MemoryOperands)->DenseRange(0, ENGINE_COUNT - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Syscall)->DenseRange(0, ENGINE_COUNT - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Assemble)->Arg(1000)->Arg(20000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SaveBvm)->Arg(20000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_LoadBvm)->Arg(20000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
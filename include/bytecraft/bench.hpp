@@ -0,0 +1,156 @@
+//  bench.hpp:
+//    Built-in benchmark suite, JSON results and regression comparison.
+//
+
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "vm.hpp"
+
+namespace bc {
+
+  /**
+   * @brief Repeated measurements of one benchmark.
+   *
+   * VM benchmarks measure instructions per second, the assembler MB of
+   * source per second; both are higher-is-better rates with one sample per
+   * repetition.
+   */
+  struct BenchResult {
+    std::string name;
+    std::string unit;
+    std::vector<double> samples;
+
+    double mean() const;
+    double stddev() const;
+  };
+
+  /**
+   * @brief One run of the suite, as written to and read from JSON.
+   */
+  struct BenchReport {
+    std::string engine;
+    std::uint64_t peak_rss_kib = 0;
+    std::vector<BenchResult> results;
+  };
+
+  /**
+   * @brief Parameters of run_bench_suite().
+   */
+  struct BenchOptions {
+    Engine engine = Engine::Tiered;
+    std::uint32_t repetitions = 5;
+    std::uint32_t iterations = 20000;
+  };
+
+  /**
+   * @brief Build an untraced VM for @p module on @p engine, as the benchmarks run it.
+   *
+   * The code is verified so the switch engine takes its unchecked path.
+   * Shared by run_bench_suite() and the google-benchmark baselines.
+   *
+   * @param module  Assembled program.
+   * @param engine  Engine to run on.
+   * @return The VM, ready to run().
+   */
+  VM make_bench_vm(const Module& module, Engine engine);
+
+  /**
+   * @brief Run every generated workload on one engine, plus the assembler.
+   *
+   * Each VM benchmark assembles a fixed-seed `bytecraft gen` program,
+   * counts its instructions once, then times @c repetitions full runs.
+   * Guest output is discarded.
+   *
+   * @param options        Engine, repetitions and loop iterations.
+   * @param out_report     Samples per benchmark and the process's peak RSS.
+   * @param error_message  Set on failure.
+   * @return true on success, false if a workload does not assemble.
+   */
+  bool run_bench_suite(const BenchOptions& options, BenchReport& out_report, std::string& error_message);
+
+  /**
+   * @brief Write @p report as JSON.
+   *
+   * Per benchmark: name, unit, mean, stddev, samples; VM benchmarks also
+   * carry ns_per_instr (derived from the mean rate).
+   *
+   * @param out     Stream to write to.
+   * @param report  Report to write.
+   * @return void
+   */
+  void write_bench_json(std::ostream& out, const BenchReport& report);
+
+  /**
+   * @brief Parse a report written by write_bench_json().
+   *
+   * @param text           JSON text.
+   * @param out_report     Parsed report on success.
+   * @param error_message  Set on failure.
+   * @return true on success, false if the text is not a benchmark report.
+   */
+  bool read_bench_json(const std::string& text, BenchReport& out_report, std::string& error_message);
+
+  /**
+   * @brief One benchmark present in both compared reports.
+   */
+  struct BenchComparison {
+    std::string name;
+    std::string unit;
+    double base_mean = 0.0;
+    double current_mean = 0.0;
+    double change_percent = 0.0;  // current vs. base; negative is slower
+    double p_value = 1.0;         // two-sided Welch t-test on the samples
+    bool regression = false;
+  };
+
+  /**
+   * @brief Result of compare_bench(): the matched benchmarks and what did not match.
+   */
+  struct BenchDiff {
+    std::vector<BenchComparison> comparisons;  // in the order of the current report
+    std::vector<std::string> missing;          // in the base report only
+    std::vector<std::string> added;            // in the current report only
+    bool engine_mismatch = false;              // the reports ran on different engines
+
+    /**
+     * @brief Whether the reports cover different benchmarks or engines.
+     */
+    bool mismatched() const {
+      return engine_mismatch || !missing.empty() || !added.empty();
+    }
+  };
+
+  /**
+   * @brief Compare two reports benchmark by benchmark.
+   *
+   * A benchmark regresses when it got slower by more than
+   * @p threshold_percent and the difference is significant at @p alpha.
+   * Single-sample benchmarks can never be significant, so repeat runs.
+   * Benchmarks found in only one report, and reports from different
+   * engines, are listed in the result rather than dropped.
+   *
+   * @param base               Reference report.
+   * @param current            Report under test.
+   * @param threshold_percent  Slowdown ignored as noise, in percent.
+   * @param alpha              Significance level.
+   * @return Comparisons in the order of @p current, plus the mismatches.
+   */
+  BenchDiff compare_bench(const BenchReport& base,
+                          const BenchReport& current,
+                          double threshold_percent,
+                          double alpha);
+
+  /**
+   * @brief Two-sided p-value of Welch's t-test for equal means.
+   *
+   * @param a  First sample set.
+   * @param b  Second sample set.
+   * @return p-value in [0, 1]; 1 if either set has fewer than two samples.
+   */
+  double welch_p_value(const std::vector<double>& a, const std::vector<double>& b);
+
+}  // namespace bc
@@ -9,12 +9,43 @@
 
 namespace bc {
 
+  struct Symbol {
+    std::string name;
+    std::uint32_t address = 0;
+  };
+
+  struct LineEntry {
+    std::uint32_t address = 0;
+    std::uint32_t line = 0;
+  };
+
   struct Module {
     std::uint32_t entry_point = 0;
     std::vector<std::uint8_t> code_section;
     std::vector<std::uint8_t> data_section;
+    std::vector<Symbol> code_symbols;  // code labels, sorted by address
+    std::vector<Symbol> data_symbols;  // DB buffers (absolute addresses), sorted by address
+    std::vector<LineEntry> line_table; // source line per instruction, sorted by address
   };
 
+  /**
+   * @brief Find the symbol covering @p address: the last one at or below it.
+   *
+   * @param symbols  Symbols sorted by address.
+   * @param address  Address to look up.
+   * @return The symbol, or nullptr if @p address lies before the first one.
+   */
+  const Symbol* find_symbol(const std::vector<Symbol>& symbols, std::uint32_t address);
+
+  /**
+   * @brief Find the line entry of the instruction covering @p address.
+   *
+   * @param lines    Line table sorted by address.
+   * @param address  Address to look up.
+   * @return The entry, or nullptr if @p address lies before the first one.
+   */
+  const LineEntry* find_line(const std::vector<LineEntry>& lines, std::uint32_t address);
+
   bool save_bvm(const std::string& path, const Module& module, std::string& error_message);
   bool load_bvm(const std::string& path, Module& module, std::string& error_message);
 
@@ -0,0 +1,123 @@
+//  cache_sim.hpp:
+//    Set-associative cache hierarchy simulator for guest data accesses.
+//
+
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bytecode.hpp"
+
+namespace bc {
+
+  /**
+   * @brief Geometry of one cache level.
+   */
+  struct CacheLevelConfig {
+    std::uint32_t size_bytes = 0;
+    std::uint32_t line_bytes = 0;
+    std::uint32_t ways = 0;
+  };
+
+  /**
+   * @brief Parse a hierarchy description such as "32K:64:8,256K:64:8".
+   *
+   * One size:line:ways triple per level, L1 first. Sizes accept K and M
+   * suffixes; line sizes and the resulting set counts must be powers of two.
+   *
+   * @param text           Description to parse.
+   * @param out_levels     Parsed levels on success.
+   * @param error_message  Set on failure.
+   * @return true on success, false if the description is malformed.
+   */
+  bool parse_cache_config(const std::string& text,
+                          std::vector<CacheLevelConfig>& out_levels,
+                          std::string& error_message);
+
+  /**
+   * @brief Simulates guest data accesses through an LRU cache hierarchy.
+   *
+   * Every access looks up L1 first and goes one level further on each
+   * miss; missing levels are filled on the way back (write-allocate, no
+   * distinction between reads and writes beyond counting them). An access
+   * that straddles a line boundary is simulated as one access per line.
+   * Accesses and L1 misses are also kept per accessed address, so the
+   * report can rank data symbols; memory operands are immediate addresses,
+   * so there are only as many of those as the program has operands.
+   */
+  class CacheSimulator {
+   public:
+    /**
+     * @brief Create a cold hierarchy.
+     *
+     * @param levels  Level geometries, L1 first (validated by parse_cache_config()).
+     */
+    explicit CacheSimulator(std::vector<CacheLevelConfig> levels);
+
+    /**
+     * @brief Simulate one guest data access.
+     *
+     * @param address  First byte accessed.
+     * @param bytes    Access size.
+     * @param write    true for a store.
+     * @return void
+     */
+    void access(std::uint32_t address, std::uint32_t bytes, bool write);
+
+    std::uint64_t reads() const {
+      return reads_;
+    }
+
+    std::uint64_t writes() const {
+      return writes_;
+    }
+
+    /**
+     * @brief Line lookups that hit in level @p level (0 = L1).
+     */
+    std::uint64_t hits(std::size_t level) const;
+
+    /**
+     * @brief Line lookups that missed in level @p level (0 = L1).
+     */
+    std::uint64_t misses(std::size_t level) const;
+
+    /**
+     * @brief Print hit rates per level and the data symbols with the most L1 misses.
+     *
+     * @param out           Stream to print to.
+     * @param data_symbols  Data symbols of the module, sorted by address.
+     * @param code_size     Size of the code section; accesses below it count as "(code)".
+     * @return void
+     */
+    void write_report(std::ostream& out, const std::vector<Symbol>& data_symbols, std::uint32_t code_size) const;
+
+   private:
+    struct Level {
+      CacheLevelConfig config;
+      std::uint32_t set_count = 0;
+      std::uint32_t line_shift = 0;
+      std::vector<std::uint32_t> tags;      // set * ways + way; line number + 1, 0 = empty
+      std::vector<std::uint64_t> last_use;  // same layout
+      std::uint64_t hits = 0;
+      std::uint64_t misses = 0;
+    };
+
+    struct AddressCounts {
+      std::uint64_t accesses = 0;
+      std::uint64_t misses = 0;
+    };
+
+    bool lookup(Level& level, std::uint32_t line_address);
+
+    std::vector<Level> levels_;
+    std::uint64_t clock_ = 0;
+    std::uint64_t reads_ = 0;
+    std::uint64_t writes_ = 0;
+    std::unordered_map<std::uint32_t, AddressCounts> address_counts_;
+  };
+
+}  // namespace bc
@@ -0,0 +1,94 @@
+//  coverage.hpp:
+//    Basic-block hit counts and an AFL-style edge coverage bitmap.
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "bytecode.hpp"
+
+namespace bc {
+
+  /**
+   * @brief Block and edge coverage of a guest run.
+   *
+   * A block starts at the program entry, at every branch target, after
+   * every not-taken conditional branch and wherever an IP write lands.
+   * Each entry bumps a 64-bit hit count for the block's address and an
+   * 8-bit wrapping counter for the edge (previous block, this block) in a
+   * fixed 64 KiB bitmap: blocks are hashed to 16-bit IDs and the edge slot
+   * is id ^ (previous id >> 1), as in AFL. The bitmap stays in L2, and its
+   * layout is what AFL-compatible fuzzers expect.
+   */
+  class Coverage {
+   public:
+    static constexpr std::size_t MAP_SIZE = 1u << 16;
+
+    /**
+     * @brief Create empty coverage for a code section of @p code_size bytes.
+     *
+     * @param code_size  Size of the code section.
+     */
+    explicit Coverage(std::uint32_t code_size);
+
+    void enter_block(std::uint32_t ip) {
+      if (ip < block_hits_.size()) {
+        block_hits_[ip] += 1;
+      }
+      std::uint32_t location = block_id(ip);
+      edge_map_[location ^ previous_location_] += 1;
+      previous_location_ = location >> 1;
+    }
+
+    /**
+     * @brief Times the block starting at @p ip was entered.
+     *
+     * @param ip  Block start address.
+     * @return Hit count, 0 outside the code section.
+     */
+    std::uint64_t block_hits(std::uint32_t ip) const;
+
+    /**
+     * @brief Number of non-zero edge slots in the bitmap.
+     *
+     * @return Covered edge count.
+     */
+    std::size_t edges_covered() const;
+
+    const std::vector<std::uint8_t>& edge_map() const {
+      return edge_map_;
+    }
+
+    /**
+     * @brief Print one line per executed block, in address order.
+     *
+     * Each line has the block address, its hit count, the code label it
+     * belongs to and its source line; with @p source_lines (the assembly
+     * source split into lines) the source text is printed as well.
+     *
+     * @param out           Stream to print to.
+     * @param code_symbols  Code labels of the module.
+     * @param line_table    Line table of the module.
+     * @param source_lines  Assembly source lines, or empty.
+     * @return void
+     */
+    void write_report(std::ostream& out,
+                      const std::vector<Symbol>& code_symbols,
+                      const std::vector<LineEntry>& line_table,
+                      const std::vector<std::string>& source_lines) const;
+
+   private:
+    static std::uint32_t block_id(std::uint32_t ip) {
+      return (ip * 2654435761u) >> 16;
+    }
+
+    std::vector<std::uint64_t> block_hits_;
+    std::vector<std::uint8_t> edge_map_;
+    std::uint32_t previous_location_ = 0;
+  };
+
+}  // namespace bc
@@ -0,0 +1,130 @@
+//  decode.hpp:
+//    Decode-once representation of a BVM code section.
+//
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "isa.hpp"
+
+namespace bc {
+
+  class VM;
+  struct DecodedInstr;
+
+  /**
+   * @brief Execution handler bound to a decoded record by the VM.
+   *
+   * Returns the next record to run, or nullptr when the caller must resync from IP.
+   */
+  using ExecHandler = const DecodedInstr* (*)(VM& vm, const DecodedInstr& instr);
+
+  /**
+   * @brief Sentinel index meaning "no decoded record starts at this IP".
+   */
+  inline constexpr std::uint32_t NO_INDEX = 0xFFFFFFFFu;
+
+  /**
+   * @brief Dense key of an (opcode, dst type, src type) form, for engines that switch on it.
+   *
+   * Valid forms use operand types below 4, so every key fits in a byte.
+   */
+  constexpr std::uint8_t form_of(Op op, std::uint8_t dst_type, std::uint8_t src_type) {
+    return static_cast<std::uint8_t>((op << 4) | (dst_type << 2) | src_type);
+  }
+
+  /**
+   * @brief Form key of records that must run through VM::step().
+   */
+  inline constexpr std::uint8_t FORM_STEP = 0xFF;
+
+  /**
+   * @brief Record flags.
+   *
+   * DF_DECODED: the instruction decoded cleanly and can run from the record.
+   *             Records without it are executed through VM::step(), which
+   *             reproduces the exact fault behavior of the byte interpreter.
+   * DF_FUSED:   the record's handler is a superinstruction that also runs
+   *             the following record(s); those keep their own handlers for
+   *             control flow that lands on them directly.
+   */
+  enum DecodeFlags : std::uint8_t {
+    DF_DECODED = 1u << 0,
+    DF_FUSED   = 1u << 1
+  };
+
+  /**
+   * @brief One fixed-size decoded instruction.
+   *
+   * Register operands are pre-validated against REG_COUNT, immediates and
+   * absolute addresses are pre-read, and immediate branch targets are
+   * pre-resolved to record indices when they land on an instruction boundary.
+   */
+  struct DecodedInstr {
+    Op op = OP_NOP;
+    std::uint8_t mode = 0;
+    std::uint8_t dst_type = OT_NONE;
+    std::uint8_t src_type = OT_NONE;
+    std::uint8_t dst_reg = 0;
+    std::uint8_t src_reg = 0;
+    std::uint8_t flags = 0;
+    std::uint8_t form = FORM_STEP;   // form_of(op, dst_type, src_type) when DF_DECODED
+    std::uint32_t dst_value = 0;     // address for OT_MEM destinations
+    std::uint32_t src_value = 0;     // immediate or address for OT_IMM/OT_MEM sources
+    std::uint32_t ip = 0;
+    std::uint32_t next_ip = 0;
+    std::uint32_t target_index = NO_INDEX;
+    ExecHandler handler = nullptr;   // (opcode, mode)-specialized handler
+    const void* thread = nullptr;    // handler address for the threaded engine
+  };
+
+  /**
+   * @brief A code section translated into a dense array of records.
+   *
+   * Records are stored in address order, so the fall-through successor of
+   * a decoded record at index i is always record i + 1. The array ends with
+   * a sentinel record (no DF_DECODED) at IP == code size.
+   */
+  struct DecodedProgram {
+    std::vector<DecodedInstr> instrs;
+    std::vector<std::uint32_t> index_of_ip;
+
+    /**
+     * @brief Map an IP to the index of the record starting there.
+     *
+     * @param ip  Code offset.
+     * @return Record index, or NO_INDEX when no record starts at @p ip.
+     */
+    std::uint32_t index_at(std::uint32_t ip) const {
+      return (ip < index_of_ip.size()) ? index_of_ip[ip] : NO_INDEX;
+    }
+  };
+
+  /**
+   * @brief Decode a single instruction at @p ip.
+   *
+   * @param code       Pointer to the code section.
+   * @param code_size  Size of the code section in bytes.
+   * @param ip         Offset of the instruction to decode.
+   * @param out        Output record; op/ip/next_ip are filled even on failure.
+   * @return true if the instruction is well-formed, false if executing it would fault.
+   */
+  bool decode_instruction(const std::uint8_t* code,
+                          std::uint32_t code_size,
+                          std::uint32_t ip,
+                          DecodedInstr& out);
+
+  /**
+   * @brief Translate a whole code section by linear sweep.
+   *
+   * Bytes that do not decode produce a single non-decoded record and the
+   * sweep resumes at the next byte.
+   *
+   * @param code       Pointer to the code section.
+   * @param code_size  Size of the code section in bytes.
+   * @return The decoded program.
+   */
+  DecodedProgram decode_program(const std::uint8_t* code, std::uint32_t code_size);
+
+}  // namespace bc
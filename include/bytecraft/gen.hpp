@@ -0,0 +1,76 @@
+//  gen.hpp:
+//    Synthetic workload generator: parameterized, seeded .asm programs.
+//
+
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace bc {
+
+  /**
+   * @brief Shape of a generated program.
+   *
+   * Arith:    tight loop of random add/sub/xor on registers and immediates.
+   * Stream:   loop of loads (and some stores) striding through a large
+   *           contiguous data region.
+   * Branchy:  state machine with data-dependent branches and
+   *           register-indirect dispatch.
+   * Syscall:  loop writing short records to stdout.
+   * Large:    straight-line source with many labelled blocks, forward
+   *           branches and data buffers, for the assembler and loader.
+   */
+  enum class Workload : std::uint8_t {
+    Arith,
+    Stream,
+    Branchy,
+    Syscall,
+    Large
+  };
+
+  /**
+   * @brief Parse a workload name as used on the command line.
+   *
+   * @param name          "arith", "stream", "branchy", "syscall" or "large".
+   * @param out_workload  Parsed workload on success.
+   * @return true if @p name is a known workload, false otherwise.
+   */
+  bool parse_workload(const std::string& name, Workload& out_workload);
+
+  /**
+   * @brief Return the command-line name of a workload.
+   *
+   * @param workload  Workload to name.
+   * @return Workload name, e.g. "stream".
+   */
+  const char* workload_name(Workload workload);
+
+  /**
+   * @brief Parameters of a generated program.
+   *
+   * The meaning of @c size depends on the workload: loop body instructions
+   * (arith), data bytes streamed per iteration (stream), states (branchy),
+   * bytes per record (syscall) or labelled blocks (large). Zero picks the
+   * workload's default. @c iterations is ignored by the large workload,
+   * which runs each block once.
+   */
+  struct GenOptions {
+    Workload workload = Workload::Arith;
+    std::uint64_t seed = 1;
+    std::uint32_t iterations = 100000;
+    std::uint32_t size = 0;
+  };
+
+  /**
+   * @brief Generate an assembly program.
+   *
+   * The output depends only on @p options: the same seed yields the same
+   * source on every host, so benchmark inputs stay comparable across
+   * versions. Every generated program halts with exit.
+   *
+   * @param options  Workload, seed and size.
+   * @return Assembly source accepted by Assembler::assemble_string().
+   */
+  std::string generate_program(const GenOptions& options);
+
+}  // namespace bc
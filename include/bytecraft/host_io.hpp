@@ -0,0 +1,325 @@
+//  host_io.hpp:
+//    Host side of guest I/O: buffered output for SC_WRITE, bulk stdin reads,
+//    the sandboxed file descriptor table and file mappings.
+//
+
+#pragma once
+#include <sys/uio.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bc {
+
+  /**
+   * @brief Per-fd output buffers between SC_WRITE and the host.
+   *
+   * Guest bytes are appended straight from guest memory to a host buffer
+   * for stdout (fd 1, and any fd other than 2) or stderr (fd 2). A buffer
+   * is handed to the host when it would pass FLUSH_THRESHOLD, on flush(),
+   * and on destruction; a write of at least FLUSH_THRESHOLD bytes skips
+   * the buffer and goes out directly from guest memory.
+   *
+   * By default the bytes go through std::cout/std::cerr, so redirecting
+   * those streams captures guest output. With direct I/O they go to the
+   * host's file descriptors 1 and 2 with write(2) instead.
+   */
+  class OutputBuffers {
+   public:
+    static constexpr std::size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    OutputBuffers() = default;
+    OutputBuffers(const OutputBuffers&) = delete;
+    OutputBuffers& operator=(const OutputBuffers&) = delete;
+    OutputBuffers(OutputBuffers&&) = default;
+    OutputBuffers& operator=(OutputBuffers&&) = default;
+    ~OutputBuffers();
+
+    /**
+     * @brief Use write(2) on host fds 1/2 instead of std::cout/std::cerr.
+     *
+     * Pending output is flushed through the old path first.
+     *
+     * @param enabled  true for write(2).
+     * @return void
+     */
+    void set_direct(bool enabled);
+
+    bool direct() const {
+      return direct_;
+    }
+
+    /**
+     * @brief Queue @p size bytes at @p data for guest fd @p fd.
+     *
+     * @param fd    Guest file descriptor (2 = stderr, anything else = stdout).
+     * @param data  Bytes to write; only read during the call.
+     * @param size  Number of bytes.
+     * @return void
+     */
+    void write(std::uint32_t fd, const std::uint8_t* data, std::size_t size);
+
+    /**
+     * @brief Queue @p count segments for guest fd @p fd, in order.
+     *
+     * Segments that fit below FLUSH_THRESHOLD are appended to the buffer.
+     * Larger totals flush the buffer and go out in one writev(2) with
+     * direct I/O, or one stream write per segment otherwise.
+     *
+     * @param fd        Guest file descriptor.
+     * @param segments  Byte ranges; only read during the call.
+     * @param count     Number of segments.
+     * @return void
+     */
+    void write(std::uint32_t fd, const iovec* segments, std::size_t count);
+
+    /**
+     * @brief Hand the buffer of guest fd @p fd to the host.
+     *
+     * @param fd  Guest file descriptor.
+     * @return void
+     */
+    void flush(std::uint32_t fd);
+
+    /**
+     * @brief Flush stdout, then stderr.
+     *
+     * @return void
+     */
+    void flush_all();
+
+   private:
+    static constexpr std::size_t STDOUT_BUFFER = 0;
+    static constexpr std::size_t STDERR_BUFFER = 1;
+
+    static std::size_t buffer_index(std::uint32_t fd) {
+      return (fd == 2) ? STDERR_BUFFER : STDOUT_BUFFER;
+    }
+
+    void emit(std::size_t index, const std::uint8_t* data, std::size_t size);
+
+    std::vector<std::uint8_t> buffers_[2];
+    bool direct_ = false;
+  };
+
+  /**
+   * @brief Read guest stdin straight into guest memory.
+   *
+   * Through std::cin this waits for @p size bytes or end of input, like a
+   * loop of get() but in one call. With @p direct it is a single read(2)
+   * on host fd 0 and may return fewer bytes (a line from a terminal, what
+   * a pipe holds); interrupted reads are retried.
+   *
+   * @param data    Destination in guest memory.
+   * @param size    Maximum number of bytes.
+   * @param direct  true for read(2) instead of std::cin.
+   * @return Bytes read; 0 at end of input or on error.
+   */
+  std::size_t read_stdin(std::uint8_t* data, std::size_t size, bool direct);
+
+  /**
+   * @brief Read guest stdin into several ranges of guest memory.
+   *
+   * Through std::cin the segments are filled in order until input ends.
+   * With @p direct it is a single readv(2) on host fd 0.
+   *
+   * @param segments  Destination ranges in guest memory.
+   * @param count     Number of segments.
+   * @param direct    true for readv(2) instead of std::cin.
+   * @return Total bytes read; 0 at end of input or on error.
+   */
+  std::size_t read_stdin(const iovec* segments, std::size_t count, bool direct);
+
+  /**
+   * @brief Whether read_stdin() of @p size bytes would return without blocking.
+   *
+   * Through std::cin the stream buffer must already hold @p size bytes, or
+   * be at end of input, since std::cin waits for the full count. With
+   * @p direct a zero-timeout poll(2) on host fd 0 decides, as read(2)
+   * returns whatever is there.
+   *
+   * @param size    Bytes the read asks for.
+   * @param direct  true for read(2) instead of std::cin.
+   * @return true if the read can go ahead now.
+   */
+  bool stdin_ready(std::size_t size, bool direct);
+
+  /**
+   * @brief A host memory mapping that backs a range of guest memory.
+   *
+   * File mappings share the page cache with the file when read-only and
+   * are private when copy-on-write, so guest stores never reach the file.
+   * They keep a duplicate of the file's fd, because pages past the end of
+   * a truncated file raise SIGBUS: accessible() reports how much of the
+   * mapping the file still covers. Snapshots are anonymous copies that
+   * later changes to the file never reach. Unmapped on destruction.
+   */
+  class HostMapping {
+   public:
+    HostMapping() = default;
+    HostMapping(const HostMapping&) = delete;
+    HostMapping& operator=(const HostMapping&) = delete;
+    HostMapping(HostMapping&& other) noexcept;
+    HostMapping& operator=(HostMapping&& other) noexcept;
+    ~HostMapping();
+
+    /**
+     * @brief Map a private anonymous copy of @p size bytes at @p data.
+     *
+     * Used to rebuild a file mapping from a replay log.
+     *
+     * @param data      Bytes to copy.
+     * @param size      Number of bytes; 0 fails.
+     * @param writable  false to make the copy read-only.
+     * @return The mapping; empty on failure.
+     */
+    static HostMapping copy_of(const std::uint8_t* data, std::size_t size, bool writable);
+
+    /**
+     * @brief Bytes from the start of the mapping that are safe to touch now.
+     *
+     * size() for snapshots; for file mappings, size() capped at the file's
+     * current size (one fstat(2)), or 0 if that cannot be read.
+     */
+    std::size_t accessible() const;
+
+    std::uint8_t* data() const {
+      return static_cast<std::uint8_t*>(address_);
+    }
+
+    std::size_t size() const {
+      return size_;
+    }
+
+    bool writable() const {
+      return writable_;
+    }
+
+    bool empty() const {
+      return address_ == nullptr;
+    }
+
+   private:
+    friend class FileTable;
+    HostMapping(void* address, std::size_t size, bool writable, int file_fd = -1)
+        : address_(address), size_(size), writable_(writable), file_fd_(file_fd) {}
+    static HostMapping allocate(std::size_t size, bool writable);
+    bool seal();
+    void reset();
+
+    void* address_ = nullptr;
+    std::size_t size_ = 0;
+    bool writable_ = false;
+    int file_fd_ = -1;  // file mappings only
+  };
+
+  /**
+   * @brief Guest file descriptors 3 and up, backed by host files.
+   *
+   * Files can only be opened below a root directory set with set_root();
+   * without one every open fails. Guest paths are relative to the root
+   * (a leading '/' is ignored) and are rejected if, after resolving ".."
+   * and symlinks, they lead outside it. The root is held open as a
+   * directory fd and paths are resolved against it by openat2(2) with
+   * RESOLVE_BENEATH, in the same call that opens the file; without
+   * openat2 no symlinks or ".." are followed at all. Guest fds are the lowest free slot
+   * from FIRST_FD; the table holds at most MAX_FILES files. All calls
+   * return -1 for errors, including unknown fds.
+   */
+  class FileTable {
+   public:
+    static constexpr std::uint32_t FIRST_FD = 3;
+    static constexpr std::size_t MAX_FILES = 64;
+
+    FileTable() = default;
+    FileTable(const FileTable&) = delete;
+    FileTable& operator=(const FileTable&) = delete;
+    FileTable(FileTable&& other) noexcept;
+    FileTable& operator=(FileTable&& other) noexcept;
+    ~FileTable();
+
+    /**
+     * @brief Allow opens below @p directory.
+     *
+     * @param directory      Existing host directory.
+     * @param error_message  Set on failure.
+     * @return true on success, false if @p directory is not a directory.
+     */
+    bool set_root(const std::string& directory, std::string& error_message);
+
+    /**
+     * @brief Open a file for the guest.
+     *
+     * @param guest_path  Path relative to the root.
+     * @param flags       OPEN_* bits from isa.hpp.
+     * @return Guest fd, or -1.
+     */
+    std::int64_t open(const std::string& guest_path, std::uint32_t flags);
+
+    /**
+     * @brief Close guest fd @p fd.
+     *
+     * @return 0, or -1.
+     */
+    std::int64_t close(std::uint32_t fd);
+
+    /**
+     * @brief read(2) on the file behind @p fd.
+     *
+     * @return Bytes read (0 at end of file), or -1.
+     */
+    std::int64_t read(std::uint32_t fd, std::uint8_t* data, std::size_t size);
+
+    /**
+     * @brief write(2) the whole range to the file behind @p fd.
+     *
+     * @return Bytes written, or -1.
+     */
+    std::int64_t write(std::uint32_t fd, const std::uint8_t* data, std::size_t size);
+
+    /**
+     * @brief readv(2) on the file behind @p fd.
+     *
+     * @return Bytes read (0 at end of file), or -1.
+     */
+    std::int64_t readv(std::uint32_t fd, const iovec* segments, std::size_t count);
+
+    /**
+     * @brief writev(2) all segments to the file behind @p fd.
+     *
+     * @return Bytes written, or -1.
+     */
+    std::int64_t writev(std::uint32_t fd, const iovec* segments, std::size_t count);
+
+    /**
+     * @brief lseek(2) on the file behind @p fd.
+     *
+     * @param offset  Signed offset.
+     * @param whence  SEEK_FROM_* value from isa.hpp.
+     * @return New position, or -1.
+     */
+    std::int64_t seek(std::uint32_t fd, std::int64_t offset, std::uint32_t whence);
+
+    /**
+     * @brief mmap(2) the whole file behind @p fd, or map a snapshot of it.
+     *
+     * The file must be non-empty and smaller than 4 GiB, and the fd must be
+     * readable. The mapping stays valid after the fd is closed.
+     *
+     * @param copy_on_write  true for a private writable mapping, false for read-only.
+     * @param snapshot       true to read the file once into anonymous memory.
+     * @param out_mapping    The mapping on success.
+     * @return Mapped size in bytes, or -1.
+     */
+    std::int64_t map(std::uint32_t fd, bool copy_on_write, bool snapshot, HostMapping& out_mapping);
+
+   private:
+    int host_fd(std::uint32_t fd) const;
+    void close_all();
+
+    int root_fd_ = -1;
+    std::vector<int> host_fds_;  // guest fd - FIRST_FD; -1 = free
+  };
+
+}  // namespace bc
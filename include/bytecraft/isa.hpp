@@ -65,6 +65,24 @@ namespace bc {
     OP_SYSCALL
   };
 
+  inline std::string_view opcode_name(std::uint8_t opcode) {
+    static constexpr std::string_view names[] = {
+      "nop",
+      "mov",
+      "add",
+      "sub",
+      "xor",
+      "cmp",
+      "jmp",
+      "jeq",
+      "jneq",
+      "jla",
+      "jle",
+      "syscall"
+    };
+    return (opcode <= OP_SYSCALL) ? names[opcode] : std::string_view{"??"};
+  }
+
   enum OperandType : std::uint8_t {
     OT_NONE = 0,
     OT_REG  = 1,
@@ -76,7 +94,42 @@ namespace bc {
     SC_EXIT  = 0,
     SC_WRITE = 1,
     SC_READ  = 2,
-    SC_OPEN  = 3
+    SC_OPEN  = 3,
+    SC_FLUSH = 4,
+    SC_CLOSE = 5,
+    SC_SEEK  = 6,
+    SC_MMAP  = 7,
+    SC_WRITEV = 8,
+    SC_READV  = 9
+  };
+
+  // SC_OPEN flags (r3).
+  enum OpenFlag : std::uint32_t {
+    OPEN_READ     = 1u << 0,
+    OPEN_WRITE    = 1u << 1,
+    OPEN_CREATE   = 1u << 2,
+    OPEN_TRUNCATE = 1u << 3,
+    OPEN_APPEND   = 1u << 4
   };
 
+  // SC_SEEK origin (r4).
+  enum SeekFrom : std::uint32_t {
+    SEEK_FROM_START   = 0,
+    SEEK_FROM_CURRENT = 1,
+    SEEK_FROM_END     = 2
+  };
+
+  // SC_MMAP flags (r3). Without COPY_ON_WRITE the mapping is read-only;
+  // SNAPSHOT copies the file at map time instead of mapping it.
+  enum MmapFlag : std::uint32_t {
+    MMAP_COPY_ON_WRITE = 1u << 0,
+    MMAP_SNAPSHOT      = 1u << 1
+  };
+
+  // Guest addresses of SC_MMAP mappings are multiples of this.
+  constexpr std::uint32_t MMAP_ALIGNMENT = 4096;
+
+  // Most (address, length) pairs one SC_WRITEV/SC_READV may pass.
+  constexpr std::uint32_t IOVEC_MAX = 1024;
+
 }  
@@ -0,0 +1,88 @@
+//  jit.hpp:
+//    Baseline translator from decoded BVM basic blocks to native x86-64.
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "decode.hpp"
+
+namespace bc {
+
+  /**
+   * @brief Native entry point of a translated block.
+   *
+   * Runs on the VM register file and flat memory image, and returns with
+   * IP pointing at the next instruction to execute. Every exit and every
+   * native loop iteration subtracts the block length from *budget; a
+   * looping block returns once the budget is spent.
+   */
+  using JitBlockFn = void (*)(std::uint32_t* registers, std::uint8_t* memory, std::int64_t* budget);
+
+  /**
+   * @brief Report whether this build can generate native code.
+   *
+   * @return true on x86-64 Linux/FreeBSD hosts, false elsewhere.
+   */
+  bool jit_available();
+
+  /**
+   * @brief Cache of translated blocks keyed by entry IP, backed by mmap'd executable memory.
+   *
+   * A block is a straight-line run of decoded instructions ending at the
+   * first branch (inclusive) or at the first instruction the translator does
+   * not handle (exclusive): syscalls, operands naming IP/rF/rS, memory
+   * operands that are out of bounds or store into the code region, and
+   * records that did not decode. Those are left to the interpreter, which
+   * also owns every fault path. A block whose immediate branch targets its
+   * own entry loops natively while the instruction budget lasts.
+   */
+  class JitCache {
+   public:
+    JitCache() = default;
+    ~JitCache();
+
+    JitCache(const JitCache&) = delete;
+    JitCache& operator=(const JitCache&) = delete;
+    JitCache(JitCache&& other) noexcept;
+    JitCache& operator=(JitCache&& other) noexcept;
+
+    /**
+     * @brief Return the translated block starting at @p ip, translating it on first use.
+     *
+     * @param program      Decoded code section.
+     * @param ip           Entry IP of the block.
+     * @param memory_size  Size of the VM memory image (for compile-time bounds checks).
+     * @param code_size    Size of the code region (stores below it are not translated).
+     * @return Native entry point, or nullptr if the first instruction cannot be translated.
+     */
+    JitBlockFn block_at(const DecodedProgram& program,
+                        std::uint32_t ip,
+                        std::size_t memory_size,
+                        std::uint32_t code_size);
+
+    /**
+     * @brief Drop every translated block (e.g. after the code region was written).
+     *
+     * @return void
+     */
+    void clear();
+
+   private:
+    struct Chunk {
+      std::uint8_t* base = nullptr;
+      std::size_t size = 0;
+      std::size_t used = 0;
+    };
+
+    std::vector<Chunk> chunks_;
+    std::vector<JitBlockFn> blocks_;
+    std::vector<std::uint8_t> translated_;
+
+    JitBlockFn install(const std::vector<std::uint8_t>& code);
+    void release();
+  };
+
+}  // namespace bc
@@ -0,0 +1,77 @@
+//  profile.hpp:
+//    Guest sampling profiler: samples IP between run_for() slices.
+//
+
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "vm.hpp"
+
+namespace bc {
+
+  /**
+   * @brief Attributes guest execution to code labels by periodic IP samples.
+   *
+   * The sampling clock is the VM's instruction budget: run() drives the VM
+   * in run_for() slices of a fixed number of instructions and samples IP
+   * after every slice, so the engines carry no profiling code at all and
+   * results do not depend on host load. A sample is charged to the nearest
+   * code label at or below IP; code before the first label counts as
+   * "_main".
+   */
+  class SamplingProfiler {
+   public:
+    /**
+     * @brief Create a profiler for a module's code labels.
+     *
+     * @param code_symbols  Code labels sorted by address (Module::code_symbols).
+     */
+    explicit SamplingProfiler(std::vector<Symbol> code_symbols);
+
+    /**
+     * @brief Run @p vm to completion, sampling every @p interval instructions.
+     *
+     * Reads from stdin that stop a slice are simply resumed.
+     *
+     * @param vm        VM to run.
+     * @param interval  Instructions per sample (at least 1).
+     * @return Halted or Faulted, as reported by the last slice.
+     */
+    RunStatus run(VM& vm, std::uint64_t interval);
+
+    /**
+     * @brief Record one sample at guest address @p ip.
+     *
+     * @param ip  Sampled IP.
+     * @return void
+     */
+    void sample(std::uint32_t ip);
+
+    /**
+     * @brief Total number of samples taken.
+     *
+     * @return Sample count.
+     */
+    std::uint64_t sample_count() const;
+
+    /**
+     * @brief Print samples in folded-stack format ("frame count" per line).
+     *
+     * Guest code has no call stack, so every stack is a single frame. Lines
+     * are sorted by frame name; labels without samples are omitted. The
+     * output feeds flamegraph.pl and compatible viewers directly.
+     *
+     * @param out  Stream to print to.
+     * @return void
+     */
+    void write_folded(std::ostream& out) const;
+
+   private:
+    std::vector<Symbol> code_symbols_;
+    std::vector<std::uint64_t> samples_;  // one per symbol, last one for "_main"
+  };
+
+}  // namespace bc
@@ -0,0 +1,99 @@
+//  replay.hpp:
+//    Binary log of syscall results for deterministic record/replay.
+//
+
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace bc {
+
+  /**
+   * @brief Records the host side of syscalls, or plays it back.
+   *
+   * Only what the host contributes is logged: the value returned in r1 and
+   * any bytes the host produced for guest memory (input of a read, the
+   * contents of a mapped file). Guest
+   * side checks (bounds, faults) run normally in both modes, so a replayed
+   * run takes exactly the same path as the recorded one without touching
+   * real I/O.
+   *
+   * File layout: "BCRL" magic, version (u32), then one entry per host call:
+   * syscall id (u32), result (u32), data size (u32), data bytes, all
+   * little-endian.
+   */
+  class SyscallLog {
+   public:
+    /**
+     * @brief Create @p path and start recording into it.
+     *
+     * @param path           Output log file.
+     * @param error_message  Set on failure.
+     * @return true on success, false if the file cannot be created.
+     */
+    bool open_record(const std::string& path, std::string& error_message);
+
+    /**
+     * @brief Load @p path for replay.
+     *
+     * @param path           Log written by a recording run.
+     * @param error_message  Set on failure.
+     * @return true on success, false if the file is missing or malformed.
+     */
+    bool open_replay(const std::string& path, std::string& error_message);
+
+    bool recording() const {
+      return recording_;
+    }
+
+    bool replaying() const {
+      return replaying_;
+    }
+
+    /**
+     * @brief Append one host call (record mode).
+     *
+     * @param syscall_id  Syscall that made the call.
+     * @param result      Value returned to the guest in r1.
+     * @param data        Bytes produced for guest memory, or nullptr.
+     * @param size        Number of bytes at @p data.
+     * @return void
+     */
+    void record(std::uint32_t syscall_id, std::uint32_t result, const std::uint8_t* data, std::uint32_t size);
+
+    /**
+     * @brief Take the next host call (replay mode).
+     *
+     * A call of a different syscall, or one past the end of the log, means
+     * the guest no longer does what was recorded; the log is then marked
+     * diverged and stays that way.
+     *
+     * @param syscall_id  Syscall asking for its result.
+     * @param out_result  Recorded r1 value.
+     * @param out_data    Recorded bytes for guest memory.
+     * @return true on success, false if the replay diverged.
+     */
+    bool next(std::uint32_t syscall_id, std::uint32_t& out_result, std::vector<std::uint8_t>& out_data);
+
+    bool diverged() const {
+      return diverged_;
+    }
+
+   private:
+    struct Entry {
+      std::uint32_t syscall_id = 0;
+      std::uint32_t result = 0;
+      std::vector<std::uint8_t> data;
+    };
+
+    std::ofstream output_;
+    std::vector<Entry> entries_;
+    std::size_t next_entry_ = 0;
+    bool recording_ = false;
+    bool replaying_ = false;
+    bool diverged_ = false;
+  };
+
+}  // namespace bc
@@ -0,0 +1,85 @@
+//  stats.hpp:
+//    Execution statistics: flat counters per opcode, mode, syscall and branch site.
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "isa.hpp"
+
+namespace bc {
+
+  /**
+   * @brief Counters collected by a VM running with statistics enabled.
+   *
+   * The scalar counters live in one flat array indexed by the slot constants
+   * below, so counting an instruction touches a few adjacent cache lines and
+   * never allocates. Branch sites get a not-taken/taken pair per code byte.
+   */
+  class ExecStats {
+   public:
+    static constexpr std::size_t OPCODE_SLOTS = 0;      // + opcode byte
+    static constexpr std::size_t MODE_SLOTS = 256;      // + mode byte
+    static constexpr std::size_t SYSCALL_SLOTS = 512;   // + syscall id; ids >= 255 share the last slot
+    static constexpr std::size_t INSTRUCTION_SLOT = 768;
+    static constexpr std::size_t LOAD_SLOT = 769;
+    static constexpr std::size_t STORE_SLOT = 770;
+    static constexpr std::size_t SLOT_COUNT = 771;
+
+    /**
+     * @brief Create zeroed counters for a code section of @p code_size bytes.
+     *
+     * @param code_size  Size of the code section (number of possible branch sites).
+     */
+    explicit ExecStats(std::uint32_t code_size);
+
+    void count(std::size_t slot) {
+      counters_[slot] += 1;
+    }
+
+    void count_syscall(std::uint32_t syscall_id) {
+      counters_[SYSCALL_SLOTS + (syscall_id < 255 ? syscall_id : 255)] += 1;
+    }
+
+    void count_branch(std::uint32_t site, bool taken) {
+      branches_[2 * static_cast<std::size_t>(site) + (taken ? 1 : 0)] += 1;
+    }
+
+    std::uint64_t counter(std::size_t slot) const {
+      return counters_[slot];
+    }
+
+    /**
+     * @brief Executions of the branch at @p site that were (not) taken.
+     *
+     * @param site   Code address of the branch instruction.
+     * @param taken  Which outcome to return.
+     * @return Count for that outcome, 0 for addresses outside the code section.
+     */
+    std::uint64_t branch_count(std::uint32_t site, bool taken) const;
+
+    /**
+     * @brief Print a human-readable summary (non-zero counters only).
+     *
+     * @param out  Stream to print to.
+     * @return void
+     */
+    void write_summary(std::ostream& out) const;
+
+    /**
+     * @brief Print all non-zero counters as a single JSON object.
+     *
+     * @param out  Stream to print to.
+     * @return void
+     */
+    void write_json(std::ostream& out) const;
+
+   private:
+    std::vector<std::uint64_t> counters_;
+    std::vector<std::uint64_t> branches_;
+  };
+
+}  // namespace bc
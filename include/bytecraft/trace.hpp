@@ -0,0 +1,132 @@
+//  trace.hpp:
+//    Binary execution trace: fixed-size records, ring buffer and offline dump.
+//
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "isa.hpp"
+
+namespace bc {
+
+  /**
+   * @brief One traced instruction.
+   *
+   * Holds the register file after the instruction; bit i of @c changed is
+   * set when register i differs from the previous record (all bits are set
+   * in the first record of a trace).
+   */
+  struct TraceRecord {
+    std::uint32_t ip_before = 0;
+    std::uint8_t opcode = 0;
+    std::uint16_t changed = 0;
+    std::uint32_t registers[REG_COUNT]{};
+  };
+
+  /**
+   * @brief Size of a record in a trace file.
+   *
+   * File layout: "BCTR" magic, version (u32), record size (u32), then records of
+   * ip_before (u32), opcode (u8), reserved (u8), changed (u16), registers (u32 each),
+   * all little-endian.
+   */
+  inline constexpr std::uint32_t TRACE_RECORD_BYTES = 8 + 4 * REG_COUNT;
+
+  /**
+   * @brief Print one trace line in the human-readable format of VM tracing.
+   *
+   * @param out        Stream to print to.
+   * @param ip_before  IP of the traced instruction.
+   * @param opcode     Opcode byte of the traced instruction.
+   * @param registers  Register file after the instruction (REG_COUNT values).
+   * @return void
+   */
+  void write_trace_line(std::ostream& out,
+                        std::uint32_t ip_before,
+                        std::uint8_t opcode,
+                        const std::uint32_t* registers);
+
+  /**
+   * @brief Render a binary trace file in the human-readable format.
+   *
+   * @param path           Trace file written by TraceWriter.
+   * @param out            Stream to print to.
+   * @param error_message  Set on failure.
+   * @return true on success, false if the file is missing or malformed.
+   */
+  bool dump_trace(const std::string& path, std::ostream& out, std::string& error_message);
+
+  /**
+   * @brief Streams trace records to a file without formatting on the VM thread.
+   *
+   * record() copies a fixed-size record into a single-producer/single-consumer
+   * lock-free ring; a background thread serializes and writes batches. When
+   * the ring is full the producer waits for the writer rather than dropping
+   * records, so a trace is always complete.
+   */
+  class TraceWriter {
+   public:
+    TraceWriter() = default;
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    /**
+     * @brief Create @p path, write the file header and start the writer thread.
+     *
+     * @param path           Output trace file.
+     * @param error_message  Set on failure.
+     * @return true on success, false if the file cannot be created.
+     */
+    bool open(const std::string& path, std::string& error_message);
+
+    /**
+     * @brief Append a record for one executed instruction.
+     *
+     * @param ip_before  IP of the instruction.
+     * @param opcode     Opcode byte of the instruction.
+     * @param registers  Register file after the instruction (REG_COUNT values).
+     * @return void
+     */
+    void record(std::uint32_t ip_before, std::uint8_t opcode, const std::uint32_t* registers);
+
+    /**
+     * @brief Drain the ring, stop the writer thread and close the file.
+     *
+     * @param error_message  Set if any part of the trace could not be written.
+     * @return true if the whole trace reached the file, false otherwise.
+     */
+    bool close(std::string& error_message);
+
+    /**
+     * @brief close() for callers with nowhere to report a write error.
+     *
+     * @return void
+     */
+    void close();
+
+   private:
+    static constexpr std::size_t RING_CAPACITY = 1u << 14;
+
+    std::vector<TraceRecord> ring_ = std::vector<TraceRecord>(RING_CAPACITY);
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> write_failed_{false};  // set by the writer thread
+    std::thread writer_;
+    std::FILE* file_ = nullptr;
+
+    std::uint32_t last_registers_[REG_COUNT]{};
+    bool has_last_ = false;
+
+    void drain();
+  };
+
+}  // namespace bc
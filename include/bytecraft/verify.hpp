@@ -0,0 +1,32 @@
+//  verify.hpp:
+//    Load-time bytecode verifier.
+//
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bc {
+
+  /**
+   * @brief Prove that a code section can run without per-fetch checks.
+   *
+   * Walks the code section once and checks that every instruction decodes
+   * inside the section with valid register indices and operand modes, and
+   * that every immediate branch target lands on an instruction boundary.
+   * Register-indirect jumps, IP writes and memory operands cannot be proven
+   * statically and stay checked at run time.
+   *
+   * @param code            Pointer to the code section.
+   * @param code_size       Size of the code section in bytes.
+   * @param out_boundaries  One byte per code offset, nonzero where an instruction starts.
+   * @param error_message   Set to the first problem found on failure.
+   * @return true if the section verified, false otherwise.
+   */
+  bool verify_code(const std::uint8_t* code,
+                   std::uint32_t code_size,
+                   std::vector<std::uint8_t>& out_boundaries,
+                   std::string& error_message);
+
+}  // namespace bc
@@ -7,12 +7,87 @@
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "bytecode.hpp"
+#include "cache_sim.hpp"
+#include "coverage.hpp"
+#include "decode.hpp"
+#include "host_io.hpp"
 #include "isa.hpp"
+#include "jit.hpp"
+#include "replay.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 namespace bc {
 
+/**
+ * @brief Execution engines selectable at runtime.
+ *
+ * Switch:      byte-at-a-time fetch/decode/execute through step().
+ * Predecoded:  the code section is decoded once into DecodedInstr records
+ *              and the interpreter dispatches over that array.
+ * Threaded:    direct-threaded dispatch over the decoded records using
+ *              labels-as-values; falls back to Predecoded on compilers
+ *              without computed goto.
+ * Cached:      interpreter over the decoded records that keeps registers,
+ *              the pending compare and the budget in locals, writing them
+ *              back only at syscalls, faults and budget exits. Behaves like
+ *              Predecoded while tracing.
+ * Jit:         basic blocks are translated to native x86-64; instructions
+ *              the translator leaves out (syscalls, faults, IP/rF/rS
+ *              operands) run in the decoded interpreter. Behaves like
+ *              Predecoded on other hosts and while tracing.
+ * Tiered:      starts in step() and counts entries per basic block; blocks
+ *              that get hot move to native code when the JIT is available,
+ *              otherwise to the decoded records.
+ */
+enum class Engine : std::uint8_t {
+  Switch,
+  Predecoded,
+  Threaded,
+  Cached,
+  Jit,
+  Tiered
+};
+
+/**
+ * @brief Parse an engine name as used on the command line.
+ *
+ * @param name        "switch", "predecoded", "threaded", "cached", "jit" or "tiered".
+ * @param out_engine  Parsed engine on success.
+ * @return true if @p name is a known engine, false otherwise.
+ */
+bool parse_engine(const std::string& name, Engine& out_engine);
+
+/**
+ * @brief Return the command-line name of an engine.
+ *
+ * @param engine  Engine to name.
+ * @return Engine name, e.g. "predecoded".
+ */
+const char* engine_name(Engine engine);
+
+/**
+ * @brief Why run_for() returned.
+ *
+ * Halted:           the guest called exit.
+ * Faulted:          the VM raised a fault (BAD_INSTR, IP_OOB, READ_OOB, WRITE_OOB)
+ *                   and stopped; fault bits the guest writes to rF itself do not count.
+ * BudgetExhausted:  the instruction budget ran out; run_for() again to continue.
+ * BlockedOnSyscall: the VM stopped in front of a read from stdin; the next
+ *                   run_for() performs it, so the host should wait for input first.
+ */
+enum class RunStatus : std::uint8_t {
+  Halted,
+  Faulted,
+  BudgetExhausted,
+  BlockedOnSyscall
+};
+
 class VM {
  public:
   VM(std::vector<std::uint8_t> memory,
@@ -20,8 +95,53 @@ class VM {
      std::uint32_t code_size,
      std::uint32_t data_size);
 
+  /**
+   * @brief Construct a VM over the [code][data] image of @p module.
+   *
+   * @param module  Assembled or loaded program; entry point and section sizes are taken from it.
+   */
+  explicit VM(const Module& module);
+
   void run();
 
+  /**
+   * @brief Run for roughly @p max_instructions instructions, then return control to the host.
+   *
+   * The budget is charged only at taken branches (and other IP writes) with
+   * the length of the straight-line run that led there, so a slice can
+   * overshoot by up to one basic block. Native JIT blocks charge their
+   * length whenever they exit or loop. Architectural state is identical to
+   * run(); calling run_for() repeatedly resumes where the last slice stopped.
+   *
+   * @param max_instructions  Instruction budget of this slice.
+   * @return Why the slice ended.
+   */
+  RunStatus run_for(std::uint64_t max_instructions);
+
+  /**
+   * @brief Select the execution engine used by run().
+   *
+   * All engines produce identical architectural state; they differ only in speed.
+   *
+   * @param engine  Engine to use.
+   * @return void
+   */
+  void set_engine(Engine engine);
+
+  /**
+   * @brief Verify the code section and enable the unchecked switch-engine path.
+   *
+   * Meant to run once after loading a program. On success step() stops
+   * bounds-checking IP on every fetch and re-checking register indices;
+   * only register-indirect jumps, IP writes and memory operands stay
+   * checked. A later write into the code region drops back to the checked
+   * path. Failure is not fatal: the program still runs, fully checked.
+   *
+   * @param error_message  Set to the first problem found on failure.
+   * @return true if the code section verified, false otherwise.
+   */
+  bool verify(std::string& error_message);
+
     /**
    * @brief Enable or disable per-instruction tracing to stdout.
    *
@@ -30,6 +150,140 @@ class VM {
    */
   void set_tracing(bool enabled);
 
+  /**
+   * @brief Trace to a binary file instead of printing to stdout.
+   *
+   * Enables tracing. Each traced instruction becomes a fixed-size record
+   * that a background thread writes to @p path; `bytecraft trace-dump`
+   * renders it in the stdout format. The file is complete after
+   * close_trace_file() or once the VM is destroyed; only close_trace_file()
+   * reports write errors.
+   *
+   * @param path           Output trace file.
+   * @param error_message  Set on failure.
+   * @return true on success, false if the file cannot be created.
+   */
+  bool set_trace_file(const std::string& path, std::string& error_message);
+
+  /**
+   * @brief Finish the trace file set by set_trace_file().
+   *
+   * Waits for the writer thread, closes the file and stops tracing.
+   *
+   * @param error_message  Set on failure.
+   * @return true if the whole trace was written (or no trace file is set),
+   *         false after a write error such as a full disk.
+   */
+  bool close_trace_file(std::string& error_message);
+
+  /**
+   * @brief Enable or disable execution statistics.
+   *
+   * Enabling starts from zeroed counters. While enabled, every engine runs
+   * the switch loop instantiated with probes; the other instantiations
+   * contain no statistics code.
+   *
+   * @param enabled  true to collect statistics.
+   * @return void
+   */
+  void set_stats(bool enabled);
+
+  /**
+   * @brief Counters collected since set_stats(true).
+   *
+   * @return The counters, or nullptr if statistics are disabled.
+   */
+  const ExecStats* stats() const;
+
+  /**
+   * @brief Enable or disable basic-block and edge coverage.
+   *
+   * Enabling starts from empty coverage at the current IP. Like
+   * statistics, coverage runs the probed switch loop on every engine.
+   *
+   * @param enabled  true to record coverage.
+   * @return void
+   */
+  void set_coverage(bool enabled);
+
+  /**
+   * @brief Coverage recorded since set_coverage(true).
+   *
+   * @return The coverage, or nullptr if coverage is disabled.
+   */
+  const Coverage* coverage() const;
+
+  /**
+   * @brief Stream guest data accesses through a simulated cache hierarchy.
+   *
+   * Every memory operand (load32()/store32()) becomes one access. Starts
+   * cold; like statistics, it runs the probed switch loop on every engine.
+   *
+   * @param levels  Level geometries, L1 first (see parse_cache_config()); empty disables it.
+   * @return void
+   */
+  void set_cache_simulation(const std::vector<CacheLevelConfig>& levels);
+
+  /**
+   * @brief Cache simulation since set_cache_simulation().
+   *
+   * @return The simulator, or nullptr if disabled.
+   */
+  const CacheSimulator* cache_simulation() const;
+
+  /**
+   * @brief Use write(2)/read(2) on the host's fds 0-2 instead of the iostreams.
+   *
+   * Either way SC_WRITE output is buffered per fd and flushed when the
+   * buffer fills, on exit and SC_FLUSH, before reading stdin and whenever
+   * run()/run_for() returns; SC_READ reads straight into guest memory.
+   *
+   * @param enabled  true for write(2)/read(2).
+   * @return void
+   */
+  void set_direct_io(bool enabled);
+
+  /**
+   * @brief Let SC_OPEN open files below a host directory.
+   *
+   * Without a root every SC_OPEN fails. Guest paths are resolved relative
+   * to the root and may not leave it (see FileTable).
+   *
+   * @param directory      Sandbox root.
+   * @param error_message  Set on failure.
+   * @return true on success, false if @p directory is not a directory.
+   */
+  bool set_file_root(const std::string& directory, std::string& error_message);
+
+  /**
+   * @brief Record the host side of every syscall into a log file.
+   *
+   * @param path           Output log file (see SyscallLog).
+   * @param error_message  Set on failure.
+   * @return true on success, false if the file cannot be created.
+   */
+  bool set_syscall_record(const std::string& path, std::string& error_message);
+
+  /**
+   * @brief Replay syscall results from a recorded log instead of doing I/O.
+   *
+   * Reads are filled from the log and writes produce no output. A syscall
+   * that does not match the next log entry stops the VM with F_BAD_INSTR
+   * and marks the log diverged.
+   *
+   * @param path           Log written by set_syscall_record().
+   * @param error_message  Set on failure.
+   * @return true on success, false if the log cannot be loaded.
+   */
+  bool set_syscall_replay(const std::string& path, std::string& error_message);
+
+  /**
+   * @brief Log set by set_syscall_record() or set_syscall_replay().
+   *
+   * @return The log, or nullptr if syscalls use real I/O unrecorded.
+   */
+  const SyscallLog* syscall_log() const;
+
   /**
    * @brief Read the value of a CPU register.
    *
@@ -55,21 +309,117 @@ class VM {
   std::uint32_t code_size_bytes_ = 0;
   std::uint32_t data_size_bytes_ = 0;
   bool is_running_ = false;
+  bool faulted_ = false;  // set by fault(); rF fault bits are guest-writable
   bool tracing_enabled_ = true;
+  std::unique_ptr<TraceWriter> trace_writer_;
+  std::unique_ptr<ExecStats> stats_;
+  std::unique_ptr<Coverage> coverage_;
+  std::unique_ptr<CacheSimulator> cache_sim_;
+  std::unique_ptr<SyscallLog> syscall_log_;
+  OutputBuffers output_;
+  bool direct_io_ = false;
+  FileTable files_;
+
+  // SC_MMAP mappings, in guest address order, all above memory_image_.
+  struct GuestMapping {
+    std::uint32_t base;
+    HostMapping host;
+  };
+  std::vector<GuestMapping> mappings_;
+  std::vector<iovec> io_segments_;  // host ranges of the current SC_WRITEV/SC_READV
+  Engine engine_ = Engine::Switch;
+
+  DecodedProgram decoded_;
+  bool decoded_valid_ = false;
+  bool decoded_threaded_ = false;
+  JitCache jit_;
+  std::vector<std::uint32_t> block_heat_;
 
+  // Lazy condition flags: while flags_pending_ is set, the EQ/GT/LT bits of
+  // registers_[RF] are stale and the last compare is held here instead.
+  std::uint32_t cmp_lhs_ = 0;
+  std::uint32_t cmp_rhs_ = 0;
+  bool cmp_signed_ = false;
+  bool flags_pending_ = false;
+
+  // Instruction budget of the current slice; budget_ is charged at taken
+  // branches with the records from block_entry_ip_ up to the branch.
+  std::int64_t budget_ = 0;
+  std::uint32_t block_entry_ip_ = 0;
+  bool yield_on_blocking_ = false;
+  bool blocking_syscall_ready_ = false;
+  bool yielded_ = false;
+  RunStatus yield_status_ = RunStatus::Halted;
+
+  std::vector<std::uint8_t> code_boundaries_;
+  bool code_verified_ = false;
+  bool ip_check_pending_ = true;
+
+  template <bool CHECKED = true>
   std::uint8_t fetch8();
+  template <bool CHECKED = true>
   std::uint32_t fetch32();
 
-  bool oob_read(std::uint32_t address, std::size_t count = 1);
-  bool oob_write(std::uint32_t address, std::size_t count = 1);
+  void fault(std::uint32_t flag);
+  std::uint8_t* guest_bytes(std::uint32_t address, std::size_t count, bool write);
+  const std::uint8_t* read_range(std::uint32_t address, std::size_t count);
+  std::uint8_t* write_range(std::uint32_t address, std::size_t count);
   std::uint32_t load32(std::uint32_t address);
   void store32(std::uint32_t address, std::uint32_t value);
+  void note_code_write(std::uint32_t address, std::size_t count);
+
+  RunStatus run_slice(std::int64_t budget, bool yield_on_blocking);
+  void yield(RunStatus status);
+  bool charge_branch(std::uint32_t branch_ip, std::uint32_t target_ip);
+
+  bool probing() const {
+    return stats_ || coverage_ || cache_sim_;
+  }
 
   void step();
+  template <bool CHECKED, bool TRACE, bool PROBES = false>
+  void step_impl();
+  template <bool TRACE>
+  void run_engine();
+  template <bool TRACE, bool PROBES = false>
+  void run_switch();
+  template <bool TRACE>
+  void run_predecoded();
+  template <bool TRACE>
+  void run_threaded();
+  void run_cached();
+  void run_jit();
+  template <bool TRACE>
+  void run_tiered();
+  void ensure_decoded();
+  const DecodedInstr* decoded_at(std::uint32_t ip) const;
+
+  template <Op OPCODE, std::uint8_t MODE>
+  static const DecodedInstr* exec(VM& vm, const DecodedInstr& instr);
+  static const DecodedInstr* exec_step(VM& vm, const DecodedInstr& instr);
+  template <ExecHandler FIRST, ExecHandler... REST>
+  static const DecodedInstr* exec_fused(VM& vm, const DecodedInstr& instr);
+  template <std::uint8_t OP_BYTE, std::uint8_t MODE>
+  static constexpr ExecHandler select_handler();
+  static ExecHandler handler_for(std::uint8_t op_byte, std::uint8_t mode);
+  template <ExecHandler... PREFIX>
+  static ExecHandler fuse_with_branch(Op branch_op);
+  void fuse_superinstructions();
   void dump_registers(std::uint32_t ip_before, Op opcode);
   void handle_syscall();
+  static std::uint32_t guest_result(std::int64_t result);
+  std::uint32_t mapping_address(std::uint32_t requested, std::size_t size) const;
+  void add_mapping(std::uint32_t base, HostMapping host);
+  bool gather_io_segments(std::uint32_t array_address, std::uint32_t count, bool write, std::size_t& out_total);
+  void note_segment_writes(std::size_t byte_count);
+  void handle_vectored_io(std::uint32_t syscall_id, bool replaying);
+  bool replay_host_call(std::uint32_t syscall_id, std::vector<std::uint8_t>& out_data);
 
-  void set_compare_flags(std::uint32_t lhs, std::uint32_t rhs);
+  void record_compare(std::uint32_t lhs, std::uint32_t rhs);
+  void materialize_flags();
+  std::uint32_t current_flags() const;
+  template <Op OPCODE>
+  static bool condition_holds(const VM& vm);
 };
 
 }  // namespace bc
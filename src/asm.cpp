@@ -4,6 +4,7 @@
 
 #include "bytecraft/asm.hpp"
 #include "bytecraft/util.hpp"
+#include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <cstdlib>
@@ -420,6 +421,7 @@ bool Assembler::assemble_string(const std::string& source_text,
 
   std::vector<std::uint8_t> code_buffer;
   std::vector<std::uint8_t> data_buffer;
+  std::vector<LineEntry> line_table;
 
   Section current_section = Section::NONE;
 
@@ -720,6 +722,8 @@ bool Assembler::assemble_string(const std::string& source_text,
     }
 
     Op op = parse_op(op_token);
+    line_table.push_back({static_cast<std::uint32_t>(code_buffer.size()),
+                          static_cast<std::uint32_t>(line.line_number)});
     if (op == OP_NOP || op == OP_SYSCALL) {
       emit8(static_cast<std::uint8_t>(op));
       continue;
@@ -870,6 +874,20 @@ bool Assembler::assemble_string(const std::string& source_text,
   out_module.code_section = std::move(code_buffer);
   out_module.data_section = std::move(data_buffer);
 
+  out_module.line_table = std::move(line_table);
+  auto sorted_symbols = [](const std::unordered_map<std::string, std::uint32_t>& symbols) {
+    std::vector<Symbol> sorted;
+    for (const auto& [name, address] : symbols) {
+      sorted.push_back({name, address});
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Symbol& a, const Symbol& b) {
+      return (a.address != b.address) ? a.address < b.address : a.name < b.name;
+    });
+    return sorted;
+  };
+  out_module.code_symbols = sorted_symbols(code_symbols);
+  out_module.data_symbols = sorted_symbols(data_symbols);
+
   return true;
 }
 
@@ -0,0 +1,507 @@
+//  bench.cpp:
+//    Built-in benchmark suite, JSON results and regression comparison.
+//
+
+#include "bytecraft/bench.hpp"
+#include "bytecraft/asm.hpp"
+#include "bytecraft/gen.hpp"
+#include <sys/resource.h>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <streambuf>
+
+namespace bc {
+
+namespace {
+
+// Fixed inputs: results are only comparable while these stay the same.
+constexpr std::uint64_t BENCH_SEED = 1;
+constexpr std::uint32_t BENCH_STREAM_BYTES = 16 * 1024;
+constexpr std::uint32_t BENCH_LARGE_BLOCKS = 5000;
+
+/**
+ * @brief Swallows guest output while a benchmark runs.
+ */
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int ch) override {
+    return ch;
+  }
+
+  std::streamsize xsputn(const char*, std::streamsize count) override {
+    return count;
+  }
+};
+
+std::uint64_t peak_rss_kib() {
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<std::uint64_t>(usage.ru_maxrss);  // KiB on Linux
+}
+
+// Continued fraction for the regularized incomplete beta function
+// (modified Lentz's method).
+double beta_continued_fraction(double a, double b, double x) {
+  constexpr int MAX_TERMS = 200;
+  constexpr double EPSILON = 1e-12;
+  constexpr double TINY = 1e-300;
+
+  double c = 1.0;
+  double d = 1.0 - (a + b) * x / (a + 1.0);
+  d = 1.0 / (std::fabs(d) < TINY ? TINY : d);
+  double h = d;
+  for (int m = 1; m <= MAX_TERMS; m += 1) {
+    double m2 = 2.0 * m;
+    double numerator = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+    d = 1.0 + numerator * d;
+    c = 1.0 + numerator / c;
+    d = 1.0 / (std::fabs(d) < TINY ? TINY : d);
+    c = (std::fabs(c) < TINY) ? TINY : c;
+    h *= d * c;
+
+    numerator = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+    d = 1.0 + numerator * d;
+    c = 1.0 + numerator / c;
+    d = 1.0 / (std::fabs(d) < TINY ? TINY : d);
+    c = (std::fabs(c) < TINY) ? TINY : c;
+    double step = d * c;
+    h *= step;
+    if (std::fabs(step - 1.0) < EPSILON) {
+      break;
+    }
+  }
+  return h;
+}
+
+double incomplete_beta(double a, double b, double x) {
+  if (x <= 0.0) {
+    return 0.0;
+  }
+  if (x >= 1.0) {
+    return 1.0;
+  }
+  double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b)
+                          + a * std::log(x) + b * std::log(1.0 - x));
+  if (x < (a + 1.0) / (a + b + 2.0)) {
+    return front * beta_continued_fraction(a, b, x) / a;
+  }
+  return 1.0 - front * beta_continued_fraction(b, a, 1.0 - x) / b;
+}
+
+double sample_variance(const std::vector<double>& samples, double mean) {
+  double sum = 0.0;
+  for (double sample : samples) {
+    sum += (sample - mean) * (sample - mean);
+  }
+  return sum / static_cast<double>(samples.size() - 1);
+}
+
+/**
+ * @brief Just enough JSON for benchmark reports: objects, arrays, strings
+ * without escapes beyond \" and \\, numbers, true/false/null.
+ */
+struct JsonValue {
+  enum class Kind { Null, Bool, Number, String, Array, Object } kind = Kind::Null;
+  double number = 0.0;
+  std::string text;
+  std::vector<JsonValue> items;
+  std::vector<std::pair<std::string, JsonValue>> members;
+
+  const JsonValue* member(const std::string& key) const {
+    for (const auto& [name, value] : members) {
+      if (name == key) {
+        return &value;
+      }
+    }
+    return nullptr;
+  }
+};
+
+class JsonParser {
+ public:
+  explicit JsonParser(const std::string& text) : text_(text) {}
+
+  bool parse(JsonValue& out_value) {
+    if (!parse_value(out_value)) {
+      return false;
+    }
+    skip_space();
+    return pos_ == text_.size();
+  }
+
+ private:
+  void skip_space() {
+    while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+      pos_ += 1;
+    }
+  }
+
+  bool consume(char ch) {
+    skip_space();
+    if (pos_ < text_.size() && text_[pos_] == ch) {
+      pos_ += 1;
+      return true;
+    }
+    return false;
+  }
+
+  bool parse_string(std::string& out_text) {
+    if (!consume('"')) {
+      return false;
+    }
+    out_text.clear();
+    while (pos_ < text_.size() && text_[pos_] != '"') {
+      if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) {
+        pos_ += 1;
+      }
+      out_text.push_back(text_[pos_]);
+      pos_ += 1;
+    }
+    return consume('"');
+  }
+
+  bool parse_value(JsonValue& out_value) {
+    skip_space();
+    if (pos_ >= text_.size()) {
+      return false;
+    }
+    char ch = text_[pos_];
+    if (ch == '{') {
+      out_value.kind = JsonValue::Kind::Object;
+      pos_ += 1;
+      if (consume('}')) {
+        return true;
+      }
+      do {
+        std::string key;
+        JsonValue value;
+        if (!parse_string(key) || !consume(':') || !parse_value(value)) {
+          return false;
+        }
+        out_value.members.emplace_back(std::move(key), std::move(value));
+      } while (consume(','));
+      return consume('}');
+    }
+    if (ch == '[') {
+      out_value.kind = JsonValue::Kind::Array;
+      pos_ += 1;
+      if (consume(']')) {
+        return true;
+      }
+      do {
+        JsonValue value;
+        if (!parse_value(value)) {
+          return false;
+        }
+        out_value.items.push_back(std::move(value));
+      } while (consume(','));
+      return consume(']');
+    }
+    if (ch == '"') {
+      out_value.kind = JsonValue::Kind::String;
+      return parse_string(out_value.text);
+    }
+    for (const char* word : {"true", "false", "null"}) {
+      std::string literal(word);
+      if (text_.compare(pos_, literal.size(), literal) == 0) {
+        out_value.kind = (literal == "null") ? JsonValue::Kind::Null : JsonValue::Kind::Bool;
+        out_value.number = (literal == "true") ? 1.0 : 0.0;
+        pos_ += literal.size();
+        return true;
+      }
+    }
+    const char* begin = text_.c_str() + pos_;
+    char* end = nullptr;
+    out_value.number = std::strtod(begin, &end);
+    if (end == begin) {
+      return false;
+    }
+    out_value.kind = JsonValue::Kind::Number;
+    pos_ += static_cast<std::size_t>(end - begin);
+    return true;
+  }
+
+  const std::string& text_;
+  std::size_t pos_ = 0;
+};
+
+}  // namespace
+
+double BenchResult::mean() const {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for (double sample : samples) {
+    sum += sample;
+  }
+  return sum / static_cast<double>(samples.size());
+}
+
+double BenchResult::stddev() const {
+  return (samples.size() < 2) ? 0.0 : std::sqrt(sample_variance(samples, mean()));
+}
+
+/**
+ * @brief Build an untraced VM for @p module on @p engine, as the benchmarks run it.
+ *
+ * The code is verified so the switch engine takes its unchecked path.
+ *
+ * @param module  Assembled program.
+ * @param engine  Engine to run on.
+ * @return The VM, ready to run().
+ */
+VM make_bench_vm(const Module& module, Engine engine) {
+  VM vm(module);
+  std::string error_message;
+  vm.verify(error_message);
+  vm.set_tracing(false);
+  vm.set_engine(engine);
+  return vm;
+}
+
+/**
+ * @brief Run every generated workload on one engine, plus the assembler.
+ *
+ * @param options        Engine, repetitions and loop iterations.
+ * @param out_report     Samples per benchmark and the process's peak RSS.
+ * @param error_message  Set on failure.
+ * @return true on success, false if a workload does not assemble.
+ */
+bool run_bench_suite(const BenchOptions& options, BenchReport& out_report, std::string& error_message) {
+  using Clock = std::chrono::steady_clock;
+  BenchReport report;
+  report.engine = engine_name(options.engine);
+
+  NullBuffer null_buffer;
+  for (Workload workload : {Workload::Arith, Workload::Stream, Workload::Branchy, Workload::Syscall}) {
+    GenOptions gen_options;
+    gen_options.workload = workload;
+    gen_options.seed = BENCH_SEED;
+    gen_options.iterations = options.iterations;
+    gen_options.size = (workload == Workload::Stream) ? BENCH_STREAM_BYTES : 0;
+
+    Assembler assembler;
+    Module module;
+    std::string assembly_error;
+    if (!assembler.assemble_string(generate_program(gen_options), module, assembly_error)) {
+      error_message = std::string("cannot assemble the ") + workload_name(workload) + " workload: " + assembly_error;
+      return false;
+    }
+
+    std::streambuf* saved_out = std::cout.rdbuf(&null_buffer);
+    VM counting_vm = make_bench_vm(module, Engine::Switch);
+    counting_vm.set_stats(true);
+    counting_vm.run();
+    double instructions = static_cast<double>(counting_vm.stats()->counter(ExecStats::INSTRUCTION_SLOT));
+
+    BenchResult result;
+    result.name = std::string("vm/") + workload_name(workload);
+    result.unit = "instrs/s";
+    for (std::uint32_t repetition = 0; repetition < options.repetitions; repetition += 1) {
+      VM vm = make_bench_vm(module, options.engine);
+      Clock::time_point start = Clock::now();
+      vm.run();
+      std::chrono::duration<double> elapsed = Clock::now() - start;
+      result.samples.push_back(instructions / elapsed.count());
+    }
+    std::cout.rdbuf(saved_out);
+    report.results.push_back(std::move(result));
+  }
+
+  GenOptions gen_options;
+  gen_options.workload = Workload::Large;
+  gen_options.seed = BENCH_SEED;
+  gen_options.size = BENCH_LARGE_BLOCKS;
+  std::string source = generate_program(gen_options);
+  BenchResult result;
+  result.name = "asm/large";
+  result.unit = "MB/s";
+  for (std::uint32_t repetition = 0; repetition < options.repetitions; repetition += 1) {
+    Assembler assembler;
+    Module module;
+    std::string assembly_error;
+    Clock::time_point start = Clock::now();
+    bool assembled = assembler.assemble_string(source, module, assembly_error);
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    if (!assembled) {
+      error_message = "cannot assemble the large workload: " + assembly_error;
+      return false;
+    }
+    result.samples.push_back(static_cast<double>(source.size()) / 1e6 / elapsed.count());
+  }
+  report.results.push_back(std::move(result));
+
+  report.peak_rss_kib = peak_rss_kib();
+  out_report = std::move(report);
+  return true;
+}
+
+/**
+ * @brief Write @p report as JSON.
+ *
+ * @param out     Stream to write to.
+ * @param report  Report to write.
+ * @return void
+ */
+void write_bench_json(std::ostream& out, const BenchReport& report) {
+  std::ios_base::fmtflags saved_flags = out.flags();
+  std::streamsize saved_precision = out.precision(std::numeric_limits<double>::max_digits10);
+  out.unsetf(std::ios_base::floatfield);
+
+  out << "{\"version\":1,\"engine\":\"" << report.engine << "\",\"peak_rss_kib\":" << report.peak_rss_kib
+      << ",\"benchmarks\":[\n";
+  for (std::size_t index = 0; index < report.results.size(); index += 1) {
+    const BenchResult& result = report.results[index];
+    double mean = result.mean();
+    out << "  {\"name\":\"" << result.name << "\",\"unit\":\"" << result.unit << "\",\"mean\":" << mean
+        << ",\"stddev\":" << result.stddev();
+    if (result.unit == "instrs/s" && mean > 0.0) {
+      out << ",\"ns_per_instr\":" << 1e9 / mean;
+    }
+    out << ",\"samples\":[";
+    for (std::size_t sample = 0; sample < result.samples.size(); sample += 1) {
+      out << (sample == 0 ? "" : ",") << result.samples[sample];
+    }
+    out << "]}" << (index + 1 < report.results.size() ? "," : "") << "\n";
+  }
+  out << "]}\n";
+
+  out.precision(saved_precision);
+  out.flags(saved_flags);
+}
+
+/**
+ * @brief Parse a report written by write_bench_json().
+ *
+ * @param text           JSON text.
+ * @param out_report     Parsed report on success.
+ * @param error_message  Set on failure.
+ * @return true on success, false if the text is not a benchmark report.
+ */
+bool read_bench_json(const std::string& text, BenchReport& out_report, std::string& error_message) {
+  JsonValue root;
+  if (!JsonParser(text).parse(root) || root.kind != JsonValue::Kind::Object) {
+    error_message = "malformed JSON";
+    return false;
+  }
+  const JsonValue* benchmarks = root.member("benchmarks");
+  if (benchmarks == nullptr || benchmarks->kind != JsonValue::Kind::Array) {
+    error_message = "no \"benchmarks\" array";
+    return false;
+  }
+
+  BenchReport report;
+  if (const JsonValue* engine = root.member("engine")) {
+    report.engine = engine->text;
+  }
+  if (const JsonValue* rss = root.member("peak_rss_kib")) {
+    report.peak_rss_kib = static_cast<std::uint64_t>(rss->number);
+  }
+  for (const JsonValue& entry : benchmarks->items) {
+    const JsonValue* name = entry.member("name");
+    const JsonValue* samples = entry.member("samples");
+    if (name == nullptr || name->kind != JsonValue::Kind::String
+        || samples == nullptr || samples->kind != JsonValue::Kind::Array) {
+      error_message = "benchmark without name or samples";
+      return false;
+    }
+    BenchResult result;
+    result.name = name->text;
+    if (const JsonValue* unit = entry.member("unit")) {
+      result.unit = unit->text;
+    }
+    for (const JsonValue& sample : samples->items) {
+      result.samples.push_back(sample.number);
+    }
+    report.results.push_back(std::move(result));
+  }
+  out_report = std::move(report);
+  return true;
+}
+
+/**
+ * @brief Two-sided p-value of Welch's t-test for equal means.
+ *
+ * @param a  First sample set.
+ * @param b  Second sample set.
+ * @return p-value in [0, 1]; 1 if either set has fewer than two samples.
+ */
+double welch_p_value(const std::vector<double>& a, const std::vector<double>& b) {
+  if (a.size() < 2 || b.size() < 2) {
+    return 1.0;
+  }
+  BenchResult first{"", "", a};
+  BenchResult second{"", "", b};
+  double mean_a = first.mean();
+  double mean_b = second.mean();
+  double error_a = sample_variance(a, mean_a) / static_cast<double>(a.size());
+  double error_b = sample_variance(b, mean_b) / static_cast<double>(b.size());
+  double error = error_a + error_b;
+  if (error == 0.0) {
+    return (mean_a == mean_b) ? 1.0 : 0.0;
+  }
+
+  double t = (mean_a - mean_b) / std::sqrt(error);
+  double df = error * error / (error_a * error_a / static_cast<double>(a.size() - 1)
+                               + error_b * error_b / static_cast<double>(b.size() - 1));
+  return incomplete_beta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+/**
+ * @brief Compare two reports benchmark by benchmark.
+ *
+ * @param base               Reference report.
+ * @param current            Report under test.
+ * @param threshold_percent  Slowdown ignored as noise, in percent.
+ * @param alpha              Significance level.
+ * @return Comparisons in the order of @p current, plus the mismatches.
+ */
+BenchDiff compare_bench(const BenchReport& base,
+                        const BenchReport& current,
+                        double threshold_percent,
+                        double alpha) {
+  auto find_result = [](const BenchReport& report, const std::string& name) -> const BenchResult* {
+    for (const BenchResult& result : report.results) {
+      if (result.name == name) {
+        return &result;
+      }
+    }
+    return nullptr;
+  };
+
+  BenchDiff diff;
+  diff.engine_mismatch = base.engine != current.engine;
+  for (const BenchResult& reference : base.results) {
+    if (find_result(current, reference.name) == nullptr) {
+      diff.missing.push_back(reference.name);
+    }
+  }
+  for (const BenchResult& result : current.results) {
+    const BenchResult* found = find_result(base, result.name);
+    if (found == nullptr) {
+      diff.added.push_back(result.name);
+      continue;
+    }
+    const BenchResult& reference = *found;
+    BenchComparison comparison;
+    comparison.name = result.name;
+    comparison.unit = result.unit;
+    comparison.base_mean = reference.mean();
+    comparison.current_mean = result.mean();
+    comparison.change_percent = (comparison.base_mean == 0.0)
+                              ? 0.0
+                              : 100.0 * (comparison.current_mean - comparison.base_mean) / comparison.base_mean;
+    comparison.p_value = welch_p_value(reference.samples, result.samples);
+    comparison.regression = comparison.change_percent < -threshold_percent && comparison.p_value < alpha;
+    diff.comparisons.push_back(comparison);
+  }
+  return diff;
+}
+
+}  // namespace bc
@@ -3,12 +3,60 @@
 //
 
 #include "bytecraft/bytecode.hpp"
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 
 namespace bc {
 
 static constexpr char MAGIC_BVM[4] = {'B', 'V', 'M', '\0'};
+static constexpr char MAGIC_SYMBOLS[4] = {'B', 'S', 'Y', 'M'};
+static constexpr char MAGIC_DATA_SYMBOLS[4] = {'B', 'D', 'S', 'Y'};
+static constexpr char MAGIC_LINES[4] = {'B', 'L', 'I', 'N'};
+
+/**
+ * @brief Find the last element of @p table whose address is at or below @p address.
+ */
+template <typename ENTRY>
+static const ENTRY* find_covering(const std::vector<ENTRY>& table, std::uint32_t address) {
+  auto after = std::upper_bound(table.begin(), table.end(), address,
+                                [](std::uint32_t value, const ENTRY& entry) {
+                                  return value < entry.address;
+                                });
+  return (after == table.begin()) ? nullptr : &*(after - 1);
+}
+
+/**
+ * @brief Check that @p table is in non-decreasing address order.
+ */
+template <typename ENTRY>
+static bool is_sorted_by_address(const std::vector<ENTRY>& table) {
+  return std::is_sorted(table.begin(), table.end(), [](const ENTRY& left, const ENTRY& right) {
+    return left.address < right.address;
+  });
+}
+
+/**
+ * @brief Find the symbol covering @p address: the last one at or below it.
+ *
+ * @param symbols  Symbols sorted by address.
+ * @param address  Address to look up.
+ * @return The symbol, or nullptr if @p address lies before the first one.
+ */
+const Symbol* find_symbol(const std::vector<Symbol>& symbols, std::uint32_t address) {
+  return find_covering(symbols, address);
+}
+
+/**
+ * @brief Find the line entry of the instruction covering @p address.
+ *
+ * @param lines    Line table sorted by address.
+ * @param address  Address to look up.
+ * @return The entry, or nullptr if @p address lies before the first one.
+ */
+const LineEntry* find_line(const std::vector<LineEntry>& lines, std::uint32_t address) {
+  return find_covering(lines, address);
+}
 
 /**
  * @brief Write a ByteCraft module to disk in BVM format.
@@ -17,11 +65,18 @@ static constexpr char MAGIC_BVM[4] = {'B', 'V', 'M', '\0'};
  *   - Magic bytes: "BVM\0" (4 bytes).
  *   - Header: entry_point (u32), code_section_size (u32), data_section_size (u32).
  *   - Payload: code_section bytes followed by data_section bytes.
+ *   - Optional tables, each only if non-empty. Every table starts with its
+ *     magic (4 bytes) and the byte length of the rest of the table (u32),
+ *     so loaders skip tables they do not know:
+ *       - "BSYM" (code labels) and "BDSY" (data buffers): count (u32), then
+ *         per symbol address (u32), name length (u32) and name bytes;
+ *       - "BLIN": count (u32), then per instruction address (u32) and
+ *         source line (u32).
  *
  * On failure, this function sets @p error_message and returns false.
  *
  * @param path           Filesystem path of the output .bvm file to create.
- * @param module         Module containing entry_point, code_section, and data_section.
+ * @param module         Module to write, including its optional tables.
  * @param error_message  Output parameter populated with a human-readable error on failure.
  * @return true on success, false on failure.
  */
@@ -50,6 +105,43 @@ bool save_bvm(const std::string& path, const Module& module, std::string& error_
     output_file.write(reinterpret_cast<const char*>(module.data_section.data()), data_section_size);
   }
 
+  auto write_symbols = [&](const char* magic, const std::vector<Symbol>& symbols) {
+    if (symbols.empty()) {
+      return;
+    }
+    std::uint32_t table_size = 4;
+    for (const Symbol& symbol : symbols) {
+      table_size += 8 + static_cast<std::uint32_t>(symbol.name.size());
+    }
+    output_file.write(magic, 4);
+    output_file.write(reinterpret_cast<char*>(&table_size), 4);
+    std::uint32_t symbol_count = static_cast<std::uint32_t>(symbols.size());
+    output_file.write(reinterpret_cast<char*>(&symbol_count), 4);
+    for (const Symbol& symbol : symbols) {
+      std::uint32_t address_value = symbol.address;
+      std::uint32_t name_size = static_cast<std::uint32_t>(symbol.name.size());
+      output_file.write(reinterpret_cast<char*>(&address_value), 4);
+      output_file.write(reinterpret_cast<char*>(&name_size), 4);
+      output_file.write(symbol.name.data(), name_size);
+    }
+  };
+  write_symbols(MAGIC_SYMBOLS, module.code_symbols);
+  write_symbols(MAGIC_DATA_SYMBOLS, module.data_symbols);
+
+  if (!module.line_table.empty()) {
+    std::uint32_t line_count = static_cast<std::uint32_t>(module.line_table.size());
+    std::uint32_t table_size = 4 + line_count * 8;
+    output_file.write(MAGIC_LINES, 4);
+    output_file.write(reinterpret_cast<char*>(&table_size), 4);
+    output_file.write(reinterpret_cast<char*>(&line_count), 4);
+    for (const LineEntry& entry : module.line_table) {
+      std::uint32_t address_value = entry.address;
+      std::uint32_t line_value = entry.line;
+      output_file.write(reinterpret_cast<char*>(&address_value), 4);
+      output_file.write(reinterpret_cast<char*>(&line_value), 4);
+    }
+  }
+
   return true;
 }
 
@@ -60,11 +152,13 @@ bool save_bvm(const std::string& path, const Module& module, std::string& error_
  *   - Magic "BVM\0".
  *   - Header (entry_point, code_section_size, data_section_size).
  *   - Code bytes followed by data bytes.
+ *   - Optional "BSYM"/"BDSY" symbol and "BLIN" line tables, which must be
+ *     sorted by address. Tables with any other magic are skipped.
  *
- * On malformed or truncated files, this function sets @p error_message and returns false.
+ * On malformed, truncated or unsorted files, this function sets @p error_message and returns false.
  *
  * @param path           Filesystem path of the input .bvm file to read.
- * @param module         Output parameter populated with entry_point, code_section, and data_section.
+ * @param module         Output parameter populated with the sections and optional tables.
  * @param error_message  Output parameter populated with a human-readable error on failure.
  * @return true on success, false on failure.
  */
@@ -111,6 +205,91 @@ bool load_bvm(const std::string& path, Module& module, std::string& error_messag
     return false;
   }
 
+  std::streamoff table_start = input_file.tellg();
+  input_file.seekg(0, std::ios::end);
+  std::streamoff file_size = input_file.tellg();
+  input_file.seekg(table_start);
+
+  module.code_symbols.clear();
+  module.data_symbols.clear();
+  module.line_table.clear();
+  while (input_file.peek() != std::ifstream::traits_type::eof()) {
+    char table_magic[4];
+    std::uint32_t table_size = 0;
+    input_file.read(table_magic, 4);
+    input_file.read(reinterpret_cast<char*>(&table_size), 4);
+    if (!input_file) {
+      error_message = "truncated table header";
+      return false;
+    }
+    std::streamoff table_end = static_cast<std::streamoff>(input_file.tellg()) + table_size;
+    if (table_end > file_size) {
+      error_message = "truncated table";
+      return false;
+    }
+
+    bool code_table = std::memcmp(table_magic, MAGIC_SYMBOLS, 4) == 0;
+    bool data_table = std::memcmp(table_magic, MAGIC_DATA_SYMBOLS, 4) == 0;
+    bool line_table = std::memcmp(table_magic, MAGIC_LINES, 4) == 0;
+    if (!code_table && !data_table && !line_table) {
+      input_file.seekg(table_end);
+      continue;
+    }
+
+    std::uint32_t entry_count = 0;
+    input_file.read(reinterpret_cast<char*>(&entry_count), 4);
+    if (!input_file) {
+      error_message = "truncated table header";
+      return false;
+    }
+
+    if (code_table || data_table) {
+      std::vector<Symbol>& symbols = code_table ? module.code_symbols : module.data_symbols;
+      for (std::uint32_t index = 0; index < entry_count; index += 1) {
+        Symbol symbol;
+        std::uint32_t name_size = 0;
+        input_file.read(reinterpret_cast<char*>(&symbol.address), 4);
+        input_file.read(reinterpret_cast<char*>(&name_size), 4);
+        if (!input_file || name_size > 4096) {
+          error_message = "truncated symbol table";
+          return false;
+        }
+        symbol.name.resize(name_size);
+        input_file.read(symbol.name.data(), name_size);
+        if (!input_file) {
+          error_message = "truncated symbol table";
+          return false;
+        }
+        symbols.push_back(std::move(symbol));
+      }
+    } else {
+      for (std::uint32_t index = 0; index < entry_count; index += 1) {
+        LineEntry entry;
+        input_file.read(reinterpret_cast<char*>(&entry.address), 4);
+        input_file.read(reinterpret_cast<char*>(&entry.line), 4);
+        if (!input_file) {
+          error_message = "truncated line table";
+          return false;
+        }
+        module.line_table.push_back(entry);
+      }
+    }
+    if (input_file.tellg() != table_end) {
+      error_message = "table size mismatch";
+      return false;
+    }
+  }
+
+  // find_symbol() and find_line() binary-search these tables.
+  if (!is_sorted_by_address(module.code_symbols) || !is_sorted_by_address(module.data_symbols)) {
+    error_message = "unsorted symbol table";
+    return false;
+  }
+  if (!is_sorted_by_address(module.line_table)) {
+    error_message = "unsorted line table";
+    return false;
+  }
+
   return true;
 }
 
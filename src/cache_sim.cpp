@@ -0,0 +1,240 @@
+//  cache_sim.cpp:
+//    Cache hierarchy simulator and its report.
+//
+
+#include "bytecraft/cache_sim.hpp"
+#include "bytecraft/util.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace bc {
+
+namespace {
+
+// Data symbols listed in the report, most L1 misses first.
+constexpr std::size_t REPORT_SYMBOLS = 16;
+
+bool is_power_of_two(std::uint32_t value) {
+  return value != 0u && (value & (value - 1)) == 0u;
+}
+
+bool parse_size(const std::string& text, std::uint32_t& out_value) {
+  if (text.empty()) {
+    return false;
+  }
+  char* end = nullptr;
+  unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+  std::string suffix(end);
+  if (end == text.c_str()) {
+    return false;
+  }
+  if (suffix == "K" || suffix == "k") {
+    value *= 1024ull;
+  } else if (suffix == "M" || suffix == "m") {
+    value *= 1024ull * 1024ull;
+  } else if (!suffix.empty()) {
+    return false;
+  }
+  if (value == 0u || value > 0xFFFFFFFFull) {
+    return false;
+  }
+  out_value = static_cast<std::uint32_t>(value);
+  return true;
+}
+
+}  // namespace
+
+/**
+ * @brief Parse a hierarchy description such as "32K:64:8,256K:64:8".
+ *
+ * @param text           Description to parse.
+ * @param out_levels     Parsed levels on success.
+ * @param error_message  Set on failure.
+ * @return true on success, false if the description is malformed.
+ */
+bool parse_cache_config(const std::string& text,
+                        std::vector<CacheLevelConfig>& out_levels,
+                        std::string& error_message) {
+  std::vector<CacheLevelConfig> levels;
+  std::istringstream level_stream(text);
+  for (std::string level_text; std::getline(level_stream, level_text, ',');) {
+    std::istringstream field_stream(trim(level_text));
+    std::string size_text;
+    std::string line_text;
+    std::string ways_text;
+    std::getline(field_stream, size_text, ':');
+    std::getline(field_stream, line_text, ':');
+    std::getline(field_stream, ways_text, ':');
+
+    CacheLevelConfig config;
+    if (!parse_size(size_text, config.size_bytes)
+        || !parse_size(line_text, config.line_bytes)
+        || !parse_size(ways_text, config.ways)) {
+      error_message = "expected size:line:ways, got '" + level_text + "'";
+      return false;
+    }
+    if (!is_power_of_two(config.line_bytes) || config.line_bytes < 4) {
+      error_message = "line size must be a power of two >= 4 in '" + level_text + "'";
+      return false;
+    }
+    std::uint64_t set_bytes = static_cast<std::uint64_t>(config.line_bytes) * config.ways;
+    if (config.size_bytes % set_bytes != 0u
+        || !is_power_of_two(static_cast<std::uint32_t>(config.size_bytes / set_bytes))) {
+      error_message = "size / (line * ways) must be a power of two in '" + level_text + "'";
+      return false;
+    }
+    levels.push_back(config);
+  }
+  if (levels.empty()) {
+    error_message = "no cache levels";
+    return false;
+  }
+  out_levels = std::move(levels);
+  return true;
+}
+
+CacheSimulator::CacheSimulator(std::vector<CacheLevelConfig> levels) {
+  for (const CacheLevelConfig& config : levels) {
+    Level level;
+    level.config = config;
+    level.set_count = config.size_bytes / (config.line_bytes * config.ways);
+    while ((1u << level.line_shift) < config.line_bytes) {
+      level.line_shift += 1;
+    }
+    level.tags.assign(static_cast<std::size_t>(level.set_count) * config.ways, 0);
+    level.last_use.assign(level.tags.size(), 0);
+    levels_.push_back(std::move(level));
+  }
+}
+
+/**
+ * @brief Look up one line in @p level and allocate it on a miss (LRU victim).
+ *
+ * @param level         Level to search.
+ * @param line_address  Any address inside the line.
+ * @return true on a hit.
+ */
+bool CacheSimulator::lookup(Level& level, std::uint32_t line_address) {
+  std::uint32_t line = line_address >> level.line_shift;
+  std::uint32_t tag = line + 1;
+  std::size_t base = static_cast<std::size_t>(line & (level.set_count - 1)) * level.config.ways;
+
+  std::size_t victim = base;
+  for (std::size_t way = base; way < base + level.config.ways; way += 1) {
+    if (level.tags[way] == tag) {
+      level.last_use[way] = clock_;
+      level.hits += 1;
+      return true;
+    }
+    if (level.last_use[way] < level.last_use[victim]) {
+      victim = way;
+    }
+  }
+  level.tags[victim] = tag;
+  level.last_use[victim] = clock_;
+  level.misses += 1;
+  return false;
+}
+
+/**
+ * @brief Simulate one guest data access.
+ *
+ * @param address  First byte accessed.
+ * @param bytes    Access size.
+ * @param write    true for a store.
+ * @return void
+ */
+void CacheSimulator::access(std::uint32_t address, std::uint32_t bytes, bool write) {
+  if (write) {
+    writes_ += 1;
+  } else {
+    reads_ += 1;
+  }
+  AddressCounts& counts = address_counts_[address];
+  counts.accesses += 1;
+  if (levels_.empty() || bytes == 0u) {
+    return;
+  }
+
+  std::uint32_t l1_shift = levels_[0].line_shift;
+  std::uint64_t first_line = address >> l1_shift;
+  std::uint64_t last_line = (static_cast<std::uint64_t>(address) + bytes - 1) >> l1_shift;
+  for (std::uint64_t line = first_line; line <= last_line; line += 1) {
+    clock_ += 1;
+    std::uint32_t line_address = static_cast<std::uint32_t>(line << l1_shift);
+    for (std::size_t level = 0; level < levels_.size(); level += 1) {
+      if (lookup(levels_[level], line_address)) {
+        break;
+      }
+      if (level == 0) {
+        counts.misses += 1;
+      }
+    }
+  }
+}
+
+std::uint64_t CacheSimulator::hits(std::size_t level) const {
+  return (level < levels_.size()) ? levels_[level].hits : 0;
+}
+
+std::uint64_t CacheSimulator::misses(std::size_t level) const {
+  return (level < levels_.size()) ? levels_[level].misses : 0;
+}
+
+/**
+ * @brief Print hit rates per level and the data symbols with the most L1 misses.
+ *
+ * @param out           Stream to print to.
+ * @param data_symbols  Data symbols of the module, sorted by address.
+ * @param code_size     Size of the code section; accesses below it count as "(code)".
+ * @return void
+ */
+void CacheSimulator::write_report(std::ostream& out,
+                                  const std::vector<Symbol>& data_symbols,
+                                  std::uint32_t code_size) const {
+  std::ios_base::fmtflags saved_flags = out.flags();
+  out << "data accesses: " << (reads_ + writes_) << " (reads " << reads_ << ", writes " << writes_ << ")\n";
+  for (std::size_t index = 0; index < levels_.size(); index += 1) {
+    const Level& level = levels_[index];
+    std::uint64_t lookups = level.hits + level.misses;
+    double rate = (lookups == 0u) ? 0.0 : 100.0 * static_cast<double>(level.hits) / static_cast<double>(lookups);
+    out << "L" << (index + 1) << " " << level.config.size_bytes / 1024 << "K " << level.config.line_bytes << "B "
+        << level.config.ways << "-way: hits " << level.hits << "  misses " << level.misses
+        << "  hit rate " << std::fixed << std::setprecision(2) << rate << "%\n";
+  }
+
+  struct SymbolCounts {
+    std::uint64_t accesses = 0;
+    std::uint64_t misses = 0;
+  };
+  std::map<std::string, SymbolCounts> by_symbol;
+  for (const auto& [address, counts] : address_counts_) {
+    const Symbol* symbol = find_symbol(data_symbols, address);
+    std::string name = (address < code_size) ? "(code)"
+                     : (symbol != nullptr) ? symbol->name
+                     : "(data)";
+    by_symbol[name].accesses += counts.accesses;
+    by_symbol[name].misses += counts.misses;
+  }
+
+  std::vector<std::pair<std::string, SymbolCounts>> ranked(by_symbol.begin(), by_symbol.end());
+  std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+    return (a.second.misses != b.second.misses) ? a.second.misses > b.second.misses
+                                                : a.second.accesses > b.second.accesses;
+  });
+  if (ranked.size() > REPORT_SYMBOLS) {
+    ranked.resize(REPORT_SYMBOLS);
+  }
+  out << "hottest data symbols:\n";
+  for (const auto& [name, counts] : ranked) {
+    out << "  " << std::left << std::setw(20) << name << std::right
+        << "  accesses " << std::setw(12) << counts.accesses
+        << "  L1 misses " << std::setw(12) << counts.misses << "\n";
+  }
+  out.flags(saved_flags);
+}
+
+}  // namespace bc
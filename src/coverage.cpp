@@ -0,0 +1,79 @@
+//  coverage.cpp:
+//    Coverage report with labels and source lines.
+//
+
+#include "bytecraft/coverage.hpp"
+#include "bytecraft/util.hpp"
+#include <iomanip>
+
+namespace bc {
+
+Coverage::Coverage(std::uint32_t code_size)
+    : block_hits_(code_size, 0),
+      edge_map_(MAP_SIZE, 0) {
+}
+
+/**
+ * @brief Times the block starting at @p ip was entered.
+ *
+ * @param ip  Block start address.
+ * @return Hit count, 0 outside the code section.
+ */
+std::uint64_t Coverage::block_hits(std::uint32_t ip) const {
+  return (ip < block_hits_.size()) ? block_hits_[ip] : 0;
+}
+
+/**
+ * @brief Number of non-zero edge slots in the bitmap.
+ *
+ * @return Covered edge count.
+ */
+std::size_t Coverage::edges_covered() const {
+  std::size_t covered = 0;
+  for (std::uint8_t count : edge_map_) {
+    covered += (count != 0u) ? 1 : 0;
+  }
+  return covered;
+}
+
+/**
+ * @brief Print one line per executed block, in address order.
+ *
+ * @param out           Stream to print to.
+ * @param code_symbols  Code labels of the module.
+ * @param line_table    Line table of the module.
+ * @param source_lines  Assembly source lines, or empty.
+ * @return void
+ */
+void Coverage::write_report(std::ostream& out,
+                            const std::vector<Symbol>& code_symbols,
+                            const std::vector<LineEntry>& line_table,
+                            const std::vector<std::string>& source_lines) const {
+  std::size_t blocks = 0;
+  for (std::uint64_t hits : block_hits_) {
+    blocks += (hits != 0u) ? 1 : 0;
+  }
+  out << "blocks: " << blocks << "  edges: " << edges_covered() << "/" << MAP_SIZE << "\n";
+
+  for (std::uint32_t ip = 0; ip < block_hits_.size(); ip += 1) {
+    if (block_hits_[ip] == 0u) {
+      continue;
+    }
+    const Symbol* symbol = find_symbol(code_symbols, ip);
+    const LineEntry* line = find_line(line_table, ip);
+
+    out << "IP:" << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << ip
+        << std::dec << std::nouppercase << std::setfill(' ')
+        << std::setw(14) << block_hits_[ip] << "  "
+        << std::left << std::setw(16) << ((symbol != nullptr) ? symbol->name : std::string("_main")) << std::right;
+    if (line != nullptr) {
+      out << "  line " << std::left << std::setw(6) << line->line << std::right;
+      if (line->line >= 1 && line->line <= source_lines.size()) {
+        out << "  " << trim(source_lines[line->line - 1]);
+      }
+    }
+    out << "\n";
+  }
+}
+
+}  // namespace bc
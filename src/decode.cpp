@@ -0,0 +1,204 @@
+//  decode.cpp:
+//    Decode-once translation of the code section.
+//
+
+#include "bytecraft/decode.hpp"
+#include "bytecraft/util.hpp"
+
+namespace bc {
+
+/**
+ * @brief Check whether an opcode is one of the branch instructions.
+ *
+ * @param op  Opcode to test.
+ * @return true for jmp/jeq/jneq/jla/jle.
+ */
+static bool is_branch(Op op) {
+  return op == OP_JMP || op == OP_JEQ || op == OP_JNEQ || op == OP_JLA || op == OP_JLE;
+}
+
+/**
+ * @brief Decode a single instruction at @p ip.
+ *
+ * Mirrors the checks VM::step() performs while fetching: every byte must lie
+ * inside the code section, register indices must be below REG_COUNT and the
+ * mode byte must name an operand combination the opcode accepts.
+ *
+ * @param code       Pointer to the code section.
+ * @param code_size  Size of the code section in bytes.
+ * @param ip         Offset of the instruction to decode.
+ * @param out        Output record; op/ip/next_ip are filled even on failure.
+ * @return true if the instruction is well-formed, false if executing it would fault.
+ */
+bool decode_instruction(const std::uint8_t* code,
+                        std::uint32_t code_size,
+                        std::uint32_t ip,
+                        DecodedInstr& out) {
+  out = DecodedInstr{};
+  out.ip = ip;
+  out.next_ip = ip + 1;
+
+  std::uint32_t cursor = ip;
+
+  auto take8 = [&](std::uint8_t& value) -> bool {
+    if (cursor >= code_size) {
+      return false;
+    }
+    value = code[cursor];
+    cursor += 1;
+    return true;
+  };
+
+  auto take32 = [&](std::uint32_t& value) -> bool {
+    if (cursor > code_size || code_size - cursor < 4) {
+      return false;
+    }
+    value = read_u32_le(&code[cursor]);
+    cursor += 4;
+    return true;
+  };
+
+  auto take_reg = [&](std::uint8_t& reg) -> bool {
+    return take8(reg) && reg < REG_COUNT;
+  };
+
+  std::uint8_t op_byte = 0;
+  if (!take8(op_byte)) {
+    return false;
+  }
+  out.op = static_cast<Op>(op_byte);
+
+  if (out.op == OP_NOP || out.op == OP_SYSCALL) {
+    out.next_ip = cursor;
+    return true;
+  }
+  if (op_byte > OP_SYSCALL) {
+    return false;
+  }
+
+  if (!take8(out.mode)) {
+    return false;
+  }
+  out.dst_type = static_cast<std::uint8_t>((out.mode >> 4) & 0xF);
+  out.src_type = static_cast<std::uint8_t>(out.mode & 0xF);
+
+  if (is_branch(out.op)) {
+    out.dst_type = OT_NONE;
+    if (out.src_type == OT_IMM) {
+      if (!take32(out.src_value)) {
+        return false;
+      }
+    } else if (out.src_type == OT_REG) {
+      if (!take_reg(out.src_reg)) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+    out.next_ip = cursor;
+    return true;
+  }
+
+  if (out.dst_type == OT_REG) {
+    if (!take_reg(out.dst_reg)) {
+      return false;
+    }
+  } else if (out.dst_type == OT_MEM && out.op == OP_MOV) {
+    if (!take32(out.dst_value)) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  if (out.src_type == OT_REG) {
+    if (!take_reg(out.src_reg)) {
+      return false;
+    }
+  } else if (out.src_type == OT_IMM) {
+    if (!take32(out.src_value)) {
+      return false;
+    }
+  } else if (out.src_type == OT_MEM && out.dst_type == OT_REG) {
+    if (!take32(out.src_value)) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  out.next_ip = cursor;
+  return true;
+}
+
+/**
+ * @brief Check whether a well-formed instruction must be left to VM::step().
+ *
+ * step() advances IP while fetching, so "cmp IP, ..." sees a partially advanced
+ * IP and any IP destination redirects control flow. Register operands naming
+ * rF are rare and need the VM's lazily evaluated condition bits materialized
+ * first, which step() does; keeping them out of the records lets the
+ * specialized handlers touch rF only through compares and branches.
+ *
+ * @param instr  Decoded instruction.
+ * @return true if the instruction must be executed by step().
+ */
+static bool needs_step(const DecodedInstr& instr) {
+  if (instr.op == OP_NOP || instr.op == OP_SYSCALL) {
+    return false;
+  }
+  if (instr.src_type == OT_REG && instr.src_reg == RF) {
+    return true;
+  }
+  if (is_branch(instr.op)) {
+    return false;
+  }
+  return instr.dst_type == OT_REG && (instr.dst_reg == IP || instr.dst_reg == RF);
+}
+
+/**
+ * @brief Translate a whole code section by linear sweep.
+ *
+ * Bytes that do not decode produce a single non-decoded record and the
+ * sweep resumes at the next byte. A sentinel record is appended at IP ==
+ * code size so that falling off the end reaches step() and faults there.
+ *
+ * @param code       Pointer to the code section.
+ * @param code_size  Size of the code section in bytes.
+ * @return The decoded program.
+ */
+DecodedProgram decode_program(const std::uint8_t* code, std::uint32_t code_size) {
+  DecodedProgram program;
+  program.index_of_ip.assign(code_size, NO_INDEX);
+
+  std::uint32_t ip = 0;
+  while (ip < code_size) {
+    DecodedInstr instr;
+    bool ok = decode_instruction(code, code_size, ip, instr);
+    if (ok && !needs_step(instr)) {
+      instr.flags |= DF_DECODED;
+      instr.form = form_of(instr.op, instr.dst_type, instr.src_type);
+    }
+    if (!ok) {
+      instr.next_ip = ip + 1;
+    }
+    program.index_of_ip[ip] = static_cast<std::uint32_t>(program.instrs.size());
+    program.instrs.push_back(instr);
+    ip = instr.next_ip;
+  }
+
+  DecodedInstr sentinel;
+  sentinel.ip = code_size;
+  sentinel.next_ip = code_size;
+  program.instrs.push_back(sentinel);
+
+  for (DecodedInstr& instr : program.instrs) {
+    if ((instr.flags & DF_DECODED) != 0u && is_branch(instr.op) && instr.src_type == OT_IMM) {
+      instr.target_index = program.index_at(instr.src_value);
+    }
+  }
+
+  return program;
+}
+
+}  // namespace bc
@@ -0,0 +1,269 @@
+//  gen.cpp:
+//    Synthetic workload generator.
+//
+
+#include "bytecraft/gen.hpp"
+#include <algorithm>
+
+namespace bc {
+
+namespace {
+
+// Stream workload: one load per line-sized chunk of the streamed region.
+constexpr std::uint32_t STREAM_CHUNK_BYTES = 64;
+// Syscall workload: distinct records written per loop iteration.
+constexpr std::uint32_t RECORDS_PER_ITERATION = 4;
+// Large workload: forward branches skip at most this many blocks.
+constexpr std::uint32_t MAX_BRANCH_DISTANCE = 16;
+
+const char* const ALU_OPS[] = {"add", "sub", "xor"};
+// Scratch registers; r1 is left for the syscall ID and r7 counts iterations.
+const char* const SCRATCH_REGS[] = {"r2", "r3", "r4", "r5", "r6"};
+
+/**
+ * @brief splitmix64: tiny, fast, and defined bit-for-bit on every host,
+ * unlike the std:: distributions.
+ */
+class Rng {
+ public:
+  explicit Rng(std::uint64_t seed) : state_(seed) {}
+
+  std::uint64_t next() {
+    std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  std::uint32_t below(std::uint32_t bound) {
+    return static_cast<std::uint32_t>(next() % bound);
+  }
+
+  template <typename T, std::size_t N>
+  const T& pick(const T (&items)[N]) {
+    return items[below(static_cast<std::uint32_t>(N))];
+  }
+
+ private:
+  std::uint64_t state_;
+};
+
+std::uint32_t default_size(Workload workload) {
+  switch (workload) {
+    case Workload::Arith:
+      return 64;
+    case Workload::Stream:
+      return 64 * 1024;
+    case Workload::Branchy:
+      return 64;
+    case Workload::Syscall:
+      return 64;
+    case Workload::Large:
+      return 20000;
+  }
+  return 64;
+}
+
+// "add r3, r5" or "xor r2, 0x1F3"
+std::string random_alu(Rng& rng) {
+  std::string line = std::string("  ") + rng.pick(ALU_OPS) + " " + rng.pick(SCRATCH_REGS) + ", ";
+  if (rng.below(2) == 0u) {
+    line += rng.pick(SCRATCH_REGS);
+  } else {
+    line += std::to_string(rng.below(0x10000));
+  }
+  return line + "\n";
+}
+
+std::string loop_head() {
+  return "_main:\n"
+         "  mov r7, 0\n"
+         "loop:\n";
+}
+
+std::string loop_tail(std::uint32_t iterations) {
+  return "  add r7, 1\n"
+         "  cmp r7, " + std::to_string(iterations) + "\n"
+         "  jneq loop\n"
+         "  mov r1, 0\n"
+         "  syscall\n";
+}
+
+std::string generate_arith(Rng& rng, std::uint32_t size, std::uint32_t iterations) {
+  std::string source = loop_head();
+  for (std::uint32_t i = 0; i < size; i += 1) {
+    source += random_alu(rng);
+  }
+  return source + loop_tail(iterations);
+}
+
+// Immediate addresses only: the region is a run of chunk-sized DB buffers,
+// which the assembler lays out back to back.
+std::string generate_stream(Rng& rng, std::uint32_t size, std::uint32_t iterations) {
+  std::uint32_t chunks = std::max<std::uint32_t>(1, size / STREAM_CHUNK_BYTES);
+  std::string source = loop_head();
+  for (std::uint32_t chunk = 0; chunk < chunks; chunk += 1) {
+    std::string name = "chunk_" + std::to_string(chunk);
+    source += "  mov r2, [" + name + "]\n"
+              "  add r3, r2\n";
+    if (rng.below(4) == 0u) {
+      source += "  mov [" + name + "], r3\n";
+    }
+  }
+  source += loop_tail(iterations) + "_data:\n";
+  for (std::uint32_t chunk = 0; chunk < chunks; chunk += 1) {
+    source += "  DB chunk_" + std::to_string(chunk) + "[" + std::to_string(STREAM_CHUNK_BYTES) + "]\n";
+  }
+  return source;
+}
+
+// r2 holds the next state's address, r3 the value the states branch on.
+std::string generate_branchy(Rng& rng, std::uint32_t size, std::uint32_t iterations) {
+  std::uint32_t states = std::max<std::uint32_t>(2, size);
+  std::string source = "_main:\n"
+                       "  mov r7, 0\n"
+                       "  mov r2, state_0\n"
+                       "  mov r3, " + std::to_string(rng.below(0x10000)) + "\n"
+                       "step:\n"
+                       "  add r7, 1\n"
+                       "  cmp r7, " + std::to_string(iterations) + "\n"
+                       "  jeq done\n"
+                       "  jmp r2\n";
+  for (std::uint32_t state = 0; state < states; state += 1) {
+    std::string name = "state_" + std::to_string(state);
+    source += name + ":\n"
+              "  add r3, " + std::to_string(rng.next() & 0xFFFFFFFFu) + "\n"
+              "  xor r3, r7\n"
+              "  cmp r3, " + std::to_string(rng.next() & 0xFFFFFFFFu) + "\n"
+              "  jla " + name + "_high\n"
+              "  mov r2, state_" + std::to_string(rng.below(states)) + "\n"
+              "  jmp step\n"
+            + name + "_high:\n"
+              "  mov r2, state_" + std::to_string(rng.below(states)) + "\n"
+              "  jmp step\n";
+  }
+  return source + "done:\n"
+                  "  mov r1, 0\n"
+                  "  syscall\n";
+}
+
+std::string generate_syscall(Rng& rng, std::uint32_t size, std::uint32_t iterations) {
+  std::uint32_t record_bytes = std::max<std::uint32_t>(1, size);
+  std::string source = loop_head();
+  for (std::uint32_t record = 0; record < RECORDS_PER_ITERATION; record += 1) {
+    source += "  mov r1, 1\n"
+              "  mov r2, 1\n"
+              "  mov r3, record_" + std::to_string(record) + "\n"
+              "  mov r4, " + std::to_string(record_bytes) + "\n"
+              "  syscall\n";
+  }
+  source += loop_tail(iterations) + "_data:\n";
+  for (std::uint32_t record = 0; record < RECORDS_PER_ITERATION; record += 1) {
+    std::string text;
+    for (std::uint32_t i = 0; i + 1 < record_bytes; i += 1) {
+      text.push_back(static_cast<char>('a' + rng.below(26)));
+    }
+    text += "\\n";
+    source += "  DB record_" + std::to_string(record) + "[" + std::to_string(record_bytes) + "] = \"" + text + "\"\n";
+  }
+  return source;
+}
+
+std::string generate_large(Rng& rng, std::uint32_t size) {
+  std::uint32_t blocks = std::max<std::uint32_t>(1, size);
+  std::uint32_t buffers = std::max<std::uint32_t>(1, blocks / 4);
+  std::string source = "_main:\n";
+  for (std::uint32_t block = 0; block < blocks; block += 1) {
+    source += "block_" + std::to_string(block) + ":\n";
+    for (std::uint32_t i = 2 + rng.below(4); i > 0; i -= 1) {
+      source += random_alu(rng);
+    }
+    if (rng.below(2) == 0u) {
+      source += std::string("  mov [buf_") + std::to_string(rng.below(buffers)) + "], " + rng.pick(SCRATCH_REGS) + "\n";
+    }
+    std::uint32_t target = block + 1 + rng.below(MAX_BRANCH_DISTANCE);
+    source += std::string("  cmp ") + rng.pick(SCRATCH_REGS) + ", " + std::to_string(rng.below(0x10000)) + "\n"
+            + "  jeq " + (target < blocks ? "block_" + std::to_string(target) : std::string("done")) + "\n";
+  }
+  source += "done:\n"
+            "  mov r1, 0\n"
+            "  syscall\n"
+            "_data:\n";
+  for (std::uint32_t buffer = 0; buffer < buffers; buffer += 1) {
+    source += "  DB buf_" + std::to_string(buffer) + "[" + std::to_string(4 * (1 + rng.below(16))) + "]\n";
+  }
+  return source;
+}
+
+}  // namespace
+
+/**
+ * @brief Parse a workload name as used on the command line.
+ *
+ * @param name          "arith", "stream", "branchy", "syscall" or "large".
+ * @param out_workload  Parsed workload on success.
+ * @return true if @p name is a known workload, false otherwise.
+ */
+bool parse_workload(const std::string& name, Workload& out_workload) {
+  for (Workload workload : {Workload::Arith, Workload::Stream, Workload::Branchy, Workload::Syscall, Workload::Large}) {
+    if (name == workload_name(workload)) {
+      out_workload = workload;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Return the command-line name of a workload.
+ *
+ * @param workload  Workload to name.
+ * @return Workload name, e.g. "stream".
+ */
+const char* workload_name(Workload workload) {
+  switch (workload) {
+    case Workload::Arith:
+      return "arith";
+    case Workload::Stream:
+      return "stream";
+    case Workload::Branchy:
+      return "branchy";
+    case Workload::Syscall:
+      return "syscall";
+    case Workload::Large:
+      return "large";
+  }
+  return "arith";
+}
+
+/**
+ * @brief Generate an assembly program.
+ *
+ * @param options  Workload, seed and size.
+ * @return Assembly source accepted by Assembler::assemble_string().
+ */
+std::string generate_program(const GenOptions& options) {
+  Rng rng(options.seed);
+  std::uint32_t size = (options.size != 0u) ? options.size : default_size(options.workload);
+  std::uint32_t iterations = std::max<std::uint32_t>(1, options.iterations);
+  std::string header = "; bytecraft gen " + std::string(workload_name(options.workload))
+                     + " --seed=" + std::to_string(options.seed)
+                     + " --size=" + std::to_string(size)
+                     + " --iterations=" + std::to_string(iterations) + "\n";
+
+  switch (options.workload) {
+    case Workload::Arith:
+      return header + generate_arith(rng, size, iterations);
+    case Workload::Stream:
+      return header + generate_stream(rng, size, iterations);
+    case Workload::Branchy:
+      return header + generate_branchy(rng, size, iterations);
+    case Workload::Syscall:
+      return header + generate_syscall(rng, size, iterations);
+    case Workload::Large:
+      return header + generate_large(rng, size);
+  }
+  return header;
+}
+
+}  // namespace bc
@@ -0,0 +1,745 @@
+//  host_io.cpp:
+//    Buffered guest output, bulk stdin reads, the guest file table and
+//    file mappings.
+//
+
+#include "bytecraft/host_io.hpp"
+#include "bytecraft/isa.hpp"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__) && defined(SYS_openat2)
+#include <linux/openat2.h>
+#endif
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+namespace bc {
+
+namespace {
+
+/**
+ * @brief writev(2) every byte of @p segments, retrying EINTR and short writes.
+ *
+ * @param host_fd   Host file descriptor.
+ * @param segments  Byte ranges, in order.
+ * @param count     Number of segments.
+ * @return Bytes written; -1 if nothing could be written.
+ */
+std::int64_t write_segments(int host_fd, const iovec* segments, std::size_t count) {
+  std::vector<iovec> pending(segments, segments + count);
+  std::size_t first = 0;
+  std::int64_t total = 0;
+  while (first < pending.size()) {
+    ssize_t written = ::writev(host_fd, &pending[first], static_cast<int>(pending.size() - first));
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written < 0) {
+      return (total == 0) ? -1 : total;
+    }
+    total += written;
+    std::size_t advance = static_cast<std::size_t>(written);
+    while (first < pending.size() && advance >= pending[first].iov_len) {
+      advance -= pending[first].iov_len;
+      first += 1;
+    }
+    if (first < pending.size()) {
+      if (written == 0) {
+        break;
+      }
+      pending[first].iov_base = static_cast<std::uint8_t*>(pending[first].iov_base) + advance;
+      pending[first].iov_len -= advance;
+    }
+  }
+  return total;
+}
+
+/**
+ * @brief readv(2) once, retrying EINTR.
+ *
+ * @return Bytes read, or -1.
+ */
+std::int64_t read_segments(int host_fd, const iovec* segments, std::size_t count) {
+  for (;;) {
+    ssize_t received = ::readv(host_fd, segments, static_cast<int>(count));
+    if (received >= 0 || errno != EINTR) {
+      return received;
+    }
+  }
+}
+
+/**
+ * @brief Open @p relative below directory @p root_fd without following symlinks.
+ *
+ * Walks the path one component at a time with O_NOFOLLOW, so no symlink
+ * and no ".." is ever resolved. Stricter than RESOLVE_BENEATH; used where
+ * openat2(2) is unavailable.
+ *
+ * @return Host fd, or -1.
+ */
+int open_without_symlinks(int root_fd, const std::filesystem::path& relative, int host_flags) {
+  std::vector<std::string> components;
+  for (const std::filesystem::path& component : relative) {
+    if (component == "..") {
+      return -1;
+    }
+    if (!component.empty() && component != ".") {
+      components.push_back(component.string());
+    }
+  }
+  if (components.empty()) {
+    return -1;
+  }
+
+  int directory_fd = root_fd;
+  for (std::size_t i = 0; i + 1 < components.size(); ++i) {
+    int next_fd = ::openat(directory_fd, components[i].c_str(), O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (directory_fd != root_fd) {
+      ::close(directory_fd);
+    }
+    if (next_fd < 0) {
+      return -1;
+    }
+    directory_fd = next_fd;
+  }
+  int host_fd = ::openat(directory_fd, components.back().c_str(), host_flags | O_NOFOLLOW, 0644);
+  if (directory_fd != root_fd) {
+    ::close(directory_fd);
+  }
+  return host_fd;
+}
+
+/**
+ * @brief Open @p relative so that resolution can never leave @p root_fd.
+ *
+ * The kernel resolves the path, symlinks and ".." included, under
+ * RESOLVE_BENEATH in the same call that opens the file, so nothing can
+ * swap a component between a check and the open.
+ *
+ * @return Host fd, or -1.
+ */
+int open_beneath(int root_fd, const std::filesystem::path& relative, int host_flags) {
+#if defined(__linux__) && defined(SYS_openat2)
+  open_how how {};
+  how.flags = static_cast<std::uint64_t>(host_flags);
+  how.mode = ((host_flags & O_CREAT) != 0) ? 0644 : 0;
+  how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+  for (;;) {
+    long host_fd = ::syscall(SYS_openat2, root_fd, relative.c_str(), &how, sizeof(how));
+    if (host_fd >= 0) {
+      return static_cast<int>(host_fd);
+    }
+    if (errno == EINTR || errno == EAGAIN) {
+      continue;
+    }
+    if (errno != ENOSYS) {
+      return -1;
+    }
+    break;
+  }
+#endif
+  return open_without_symlinks(root_fd, relative, host_flags);
+}
+
+}  // namespace
+
+OutputBuffers::~OutputBuffers() {
+  flush_all();
+}
+
+/**
+ * @brief Use write(2) on host fds 1/2 instead of std::cout/std::cerr.
+ *
+ * @param enabled  true for write(2).
+ * @return void
+ */
+void OutputBuffers::set_direct(bool enabled) {
+  flush_all();
+  direct_ = enabled;
+}
+
+/**
+ * @brief Queue @p size bytes at @p data for guest fd @p fd.
+ *
+ * @param fd    Guest file descriptor (2 = stderr, anything else = stdout).
+ * @param data  Bytes to write; only read during the call.
+ * @param size  Number of bytes.
+ * @return void
+ */
+void OutputBuffers::write(std::uint32_t fd, const std::uint8_t* data, std::size_t size) {
+  std::size_t index = buffer_index(fd);
+  std::vector<std::uint8_t>& buffer = buffers_[index];
+  if (buffer.size() + size > FLUSH_THRESHOLD) {
+    flush(fd);
+  }
+  if (size >= FLUSH_THRESHOLD) {
+    emit(index, data, size);
+    return;
+  }
+  if (buffer.capacity() == 0u) {
+    buffer.reserve(FLUSH_THRESHOLD);
+  }
+  buffer.insert(buffer.end(), data, data + size);
+}
+
+/**
+ * @brief Queue @p count segments for guest fd @p fd, in order.
+ *
+ * @param fd        Guest file descriptor.
+ * @param segments  Byte ranges; only read during the call.
+ * @param count     Number of segments.
+ * @return void
+ */
+void OutputBuffers::write(std::uint32_t fd, const iovec* segments, std::size_t count) {
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    total += segments[i].iov_len;
+  }
+  if (total < FLUSH_THRESHOLD) {
+    for (std::size_t i = 0; i < count; ++i) {
+      write(fd, static_cast<const std::uint8_t*>(segments[i].iov_base), segments[i].iov_len);
+    }
+    return;
+  }
+
+  flush(fd);
+  std::size_t index = buffer_index(fd);
+  std::ostream& stream = (index == STDERR_BUFFER) ? std::cerr : std::cout;
+  if (!direct_) {
+    // One flush for the whole call, as one writev(2) would be.
+    for (std::size_t i = 0; i < count; ++i) {
+      stream.write(static_cast<const char*>(segments[i].iov_base),
+                   static_cast<std::streamsize>(segments[i].iov_len));
+    }
+    stream.flush();
+    return;
+  }
+  stream.flush();
+  write_segments((index == STDERR_BUFFER) ? STDERR_FILENO : STDOUT_FILENO, segments, count);
+}
+
+/**
+ * @brief Hand the buffer of guest fd @p fd to the host.
+ *
+ * @param fd  Guest file descriptor.
+ * @return void
+ */
+void OutputBuffers::flush(std::uint32_t fd) {
+  std::size_t index = buffer_index(fd);
+  std::vector<std::uint8_t>& buffer = buffers_[index];
+  if (!buffer.empty()) {
+    emit(index, buffer.data(), buffer.size());
+    buffer.clear();
+  }
+}
+
+/**
+ * @brief Flush stdout, then stderr.
+ *
+ * @return void
+ */
+void OutputBuffers::flush_all() {
+  flush(1);
+  flush(2);
+}
+
+/**
+ * @brief Write bytes to the host stream or descriptor behind buffer @p index.
+ *
+ * Direct writes retry on EINTR and short writes; other errors drop the
+ * rest, as a closed stdout would with std::cout.
+ *
+ * @param index  STDOUT_BUFFER or STDERR_BUFFER.
+ * @param data   Bytes to write.
+ * @param size   Number of bytes.
+ * @return void
+ */
+void OutputBuffers::emit(std::size_t index, const std::uint8_t* data, std::size_t size) {
+  std::ostream& stream = (index == STDERR_BUFFER) ? std::cerr : std::cout;
+  if (!direct_) {
+    stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    stream.flush();
+    return;
+  }
+
+  // Keep host diagnostics printed through the stream ahead of guest bytes.
+  stream.flush();
+  int host_fd = (index == STDERR_BUFFER) ? STDERR_FILENO : STDOUT_FILENO;
+  while (size > 0u) {
+    ssize_t written = ::write(host_fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+/**
+ * @brief Read guest stdin straight into guest memory.
+ *
+ * @param data    Destination in guest memory.
+ * @param size    Maximum number of bytes.
+ * @param direct  true for read(2) instead of std::cin.
+ * @return Bytes read; 0 at end of input or on error.
+ */
+std::size_t read_stdin(std::uint8_t* data, std::size_t size, bool direct) {
+  if (size == 0u) {
+    return 0;
+  }
+  if (!direct) {
+    std::cin.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+    return static_cast<std::size_t>(std::cin.gcount());
+  }
+  for (;;) {
+    ssize_t received = ::read(STDIN_FILENO, data, size);
+    if (received >= 0) {
+      return static_cast<std::size_t>(received);
+    }
+    if (errno != EINTR) {
+      return 0;
+    }
+  }
+}
+
+HostMapping::HostMapping(HostMapping&& other) noexcept
+    : address_(other.address_),
+      size_(other.size_),
+      writable_(other.writable_),
+      file_fd_(other.file_fd_) {
+  other.address_ = nullptr;
+  other.size_ = 0;
+  other.file_fd_ = -1;
+}
+
+HostMapping& HostMapping::operator=(HostMapping&& other) noexcept {
+  if (this != &other) {
+    reset();
+    address_ = other.address_;
+    size_ = other.size_;
+    writable_ = other.writable_;
+    file_fd_ = other.file_fd_;
+    other.address_ = nullptr;
+    other.size_ = 0;
+    other.file_fd_ = -1;
+  }
+  return *this;
+}
+
+HostMapping::~HostMapping() {
+  reset();
+}
+
+void HostMapping::reset() {
+  if (address_ != nullptr) {
+    ::munmap(address_, size_);
+  }
+  if (file_fd_ >= 0) {
+    ::close(file_fd_);
+  }
+  address_ = nullptr;
+  size_ = 0;
+  file_fd_ = -1;
+}
+
+/**
+ * @brief Bytes from the start of the mapping that are safe to touch now.
+ *
+ * @return size() for snapshots; for file mappings, size() capped at the
+ *         file's current size, or 0 if that cannot be read.
+ */
+std::size_t HostMapping::accessible() const {
+  if (file_fd_ < 0) {
+    return size_;
+  }
+  struct stat status {};
+  if (::fstat(file_fd_, &status) != 0 || status.st_size < 0) {
+    return 0;
+  }
+  return std::min(size_, static_cast<std::size_t>(status.st_size));
+}
+
+/**
+ * @brief Map a private anonymous copy of @p size bytes at @p data.
+ *
+ * @param data      Bytes to copy.
+ * @param size      Number of bytes; 0 fails.
+ * @param writable  false to make the copy read-only.
+ * @return The mapping; empty on failure.
+ */
+HostMapping HostMapping::copy_of(const std::uint8_t* data, std::size_t size, bool writable) {
+  if (size == 0u) {
+    return HostMapping();
+  }
+  HostMapping mapping = allocate(size, writable);
+  if (mapping.empty()) {
+    return mapping;
+  }
+  std::memcpy(mapping.data(), data, size);
+  return mapping.seal() ? std::move(mapping) : HostMapping();
+}
+
+/**
+ * @brief Map @p size zeroed, writable anonymous bytes.
+ *
+ * @param size      Number of bytes, non-zero.
+ * @param writable  Access the guest gets once seal() is called.
+ * @return The mapping; empty on failure.
+ */
+HostMapping HostMapping::allocate(std::size_t size, bool writable) {
+  void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return (address == MAP_FAILED) ? HostMapping() : HostMapping(address, size, writable);
+}
+
+/**
+ * @brief Drop host write access from a filled mapping that is not writable().
+ *
+ * @return true on success.
+ */
+bool HostMapping::seal() {
+  return writable_ || ::mprotect(address_, size_, PROT_READ) == 0;
+}
+
+/**
+ * @brief Read guest stdin into several ranges of guest memory.
+ *
+ * @param segments  Destination ranges in guest memory.
+ * @param count     Number of segments.
+ * @param direct    true for readv(2) instead of std::cin.
+ * @return Total bytes read; 0 at end of input or on error.
+ */
+std::size_t read_stdin(const iovec* segments, std::size_t count, bool direct) {
+  if (direct) {
+    std::int64_t received = read_segments(STDIN_FILENO, segments, count);
+    return (received > 0) ? static_cast<std::size_t>(received) : 0u;
+  }
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    std::size_t received = read_stdin(static_cast<std::uint8_t*>(segments[i].iov_base), segments[i].iov_len, false);
+    total += received;
+    if (received < segments[i].iov_len) {
+      break;
+    }
+  }
+  return total;
+}
+
+/**
+ * @brief Whether read_stdin() of @p size bytes would return without blocking.
+ *
+ * @param size    Bytes the read asks for.
+ * @param direct  true for read(2) instead of std::cin.
+ * @return true if the read can go ahead now.
+ */
+bool stdin_ready(std::size_t size, bool direct) {
+  if (size == 0u) {
+    return true;
+  }
+  if (!direct) {
+    if (!std::cin.good()) {
+      return true;
+    }
+    std::streamsize available = std::cin.rdbuf()->in_avail();
+    return available < 0 || static_cast<std::size_t>(available) >= size;
+  }
+  // POLLHUP and POLLERR also end up in revents: the read returns at once.
+  pollfd descriptor{STDIN_FILENO, POLLIN, 0};
+  return ::poll(&descriptor, 1, 0) > 0;
+}
+
+FileTable::FileTable(FileTable&& other) noexcept
+    : root_fd_(other.root_fd_),
+      host_fds_(std::move(other.host_fds_)) {
+  other.root_fd_ = -1;
+  other.host_fds_.clear();
+}
+
+FileTable& FileTable::operator=(FileTable&& other) noexcept {
+  if (this != &other) {
+    close_all();
+    root_fd_ = other.root_fd_;
+    host_fds_ = std::move(other.host_fds_);
+    other.root_fd_ = -1;
+    other.host_fds_.clear();
+  }
+  return *this;
+}
+
+FileTable::~FileTable() {
+  close_all();
+}
+
+void FileTable::close_all() {
+  for (int host_fd : host_fds_) {
+    if (host_fd >= 0) {
+      ::close(host_fd);
+    }
+  }
+  host_fds_.clear();
+  if (root_fd_ >= 0) {
+    ::close(root_fd_);
+  }
+  root_fd_ = -1;
+}
+
+/**
+ * @brief Allow opens below @p directory.
+ *
+ * @param directory      Existing host directory.
+ * @param error_message  Set on failure.
+ * @return true on success, false if @p directory is not a directory.
+ */
+bool FileTable::set_root(const std::string& directory, std::string& error_message) {
+  int root_fd = ::open(directory.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+  if (root_fd < 0) {
+    error_message = "sandbox root is not a directory: " + directory;
+    return false;
+  }
+  if (root_fd_ >= 0) {
+    ::close(root_fd_);
+  }
+  root_fd_ = root_fd;
+  return true;
+}
+
+/**
+ * @brief Open a file for the guest.
+ *
+ * The path is resolved relative to the root directory fd by the kernel
+ * itself (see open_beneath()), so a symlink planted after any check
+ * cannot redirect the open, or an O_CREAT/O_TRUNC, outside the root.
+ *
+ * @param guest_path  Path relative to the root.
+ * @param flags       OPEN_* bits from isa.hpp.
+ * @return Guest fd, or -1.
+ */
+std::int64_t FileTable::open(const std::string& guest_path, std::uint32_t flags) {
+  std::filesystem::path relative = std::filesystem::path(guest_path).relative_path();
+  std::filesystem::path normal = relative.lexically_normal();
+  if (root_fd_ < 0 || normal.empty() || normal == ".") {
+    return -1;
+  }
+
+  int host_flags = 0;
+  bool readable = (flags & OPEN_READ) != 0u;
+  bool writable = (flags & (OPEN_WRITE | OPEN_APPEND)) != 0u;
+  if (readable && writable) {
+    host_flags = O_RDWR;
+  } else if (writable) {
+    host_flags = O_WRONLY;
+  } else if (readable) {
+    host_flags = O_RDONLY;
+  } else {
+    return -1;
+  }
+  host_flags |= ((flags & OPEN_CREATE) != 0u) ? O_CREAT : 0;
+  host_flags |= ((flags & OPEN_TRUNCATE) != 0u) ? O_TRUNC : 0;
+  host_flags |= ((flags & OPEN_APPEND) != 0u) ? O_APPEND : 0;
+
+  std::size_t slot = 0;
+  while (slot < host_fds_.size() && host_fds_[slot] >= 0) {
+    slot += 1;
+  }
+  if (slot >= MAX_FILES) {
+    return -1;
+  }
+
+  int host_fd = open_beneath(root_fd_, relative, host_flags | O_CLOEXEC);
+  if (host_fd < 0) {
+    return -1;
+  }
+  if (slot == host_fds_.size()) {
+    host_fds_.push_back(host_fd);
+  } else {
+    host_fds_[slot] = host_fd;
+  }
+  return static_cast<std::int64_t>(FIRST_FD + slot);
+}
+
+int FileTable::host_fd(std::uint32_t fd) const {
+  if (fd < FIRST_FD || fd - FIRST_FD >= host_fds_.size()) {
+    return -1;
+  }
+  return host_fds_[fd - FIRST_FD];
+}
+
+/**
+ * @brief Close guest fd @p fd.
+ *
+ * @return 0, or -1.
+ */
+std::int64_t FileTable::close(std::uint32_t fd) {
+  int host = host_fd(fd);
+  if (host < 0) {
+    return -1;
+  }
+  host_fds_[fd - FIRST_FD] = -1;
+  return (::close(host) == 0) ? 0 : -1;
+}
+
+/**
+ * @brief read(2) on the file behind @p fd.
+ *
+ * @return Bytes read (0 at end of file), or -1.
+ */
+std::int64_t FileTable::read(std::uint32_t fd, std::uint8_t* data, std::size_t size) {
+  int host = host_fd(fd);
+  if (host < 0) {
+    return -1;
+  }
+  for (;;) {
+    ssize_t received = ::read(host, data, size);
+    if (received >= 0 || errno != EINTR) {
+      return received;
+    }
+  }
+}
+
+/**
+ * @brief write(2) the whole range to the file behind @p fd.
+ *
+ * @return Bytes written, or -1.
+ */
+std::int64_t FileTable::write(std::uint32_t fd, const std::uint8_t* data, std::size_t size) {
+  int host = host_fd(fd);
+  if (host < 0) {
+    return -1;
+  }
+  std::size_t total = 0;
+  while (total < size) {
+    ssize_t written = ::write(host, data + total, size - total);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return (total == 0u) ? -1 : static_cast<std::int64_t>(total);
+    }
+    total += static_cast<std::size_t>(written);
+  }
+  return static_cast<std::int64_t>(total);
+}
+
+/**
+ * @brief readv(2) on the file behind @p fd.
+ *
+ * @return Bytes read (0 at end of file), or -1.
+ */
+std::int64_t FileTable::readv(std::uint32_t fd, const iovec* segments, std::size_t count) {
+  int host = host_fd(fd);
+  return (host < 0) ? -1 : read_segments(host, segments, count);
+}
+
+/**
+ * @brief writev(2) all segments to the file behind @p fd.
+ *
+ * @return Bytes written, or -1.
+ */
+std::int64_t FileTable::writev(std::uint32_t fd, const iovec* segments, std::size_t count) {
+  int host = host_fd(fd);
+  return (host < 0) ? -1 : write_segments(host, segments, count);
+}
+
+/**
+ * @brief lseek(2) on the file behind @p fd.
+ *
+ * @param offset  Signed offset.
+ * @param whence  SEEK_FROM_* value from isa.hpp.
+ * @return New position, or -1.
+ */
+std::int64_t FileTable::seek(std::uint32_t fd, std::int64_t offset, std::uint32_t whence) {
+  int host = host_fd(fd);
+  if (host < 0) {
+    return -1;
+  }
+  int host_whence = 0;
+  switch (whence) {
+    case SEEK_FROM_START:
+      host_whence = SEEK_SET;
+      break;
+    case SEEK_FROM_CURRENT:
+      host_whence = SEEK_CUR;
+      break;
+    case SEEK_FROM_END:
+      host_whence = SEEK_END;
+      break;
+    default:
+      return -1;
+  }
+  off_t position = ::lseek(host, static_cast<off_t>(offset), host_whence);
+  return (position < 0) ? -1 : static_cast<std::int64_t>(position);
+}
+
+/**
+ * @brief mmap(2) the whole file behind @p fd, or map a snapshot of it.
+ *
+ * @param copy_on_write  true for a private writable mapping, false for read-only.
+ * @param snapshot       true to read the file once into anonymous memory.
+ * @param out_mapping    The mapping on success.
+ * @return Mapped size in bytes, or -1.
+ */
+std::int64_t FileTable::map(std::uint32_t fd, bool copy_on_write, bool snapshot, HostMapping& out_mapping) {
+  int host = host_fd(fd);
+  struct stat status {};
+  if (host < 0 || ::fstat(host, &status) != 0 || !S_ISREG(status.st_mode)) {
+    return -1;
+  }
+  if (status.st_size <= 0 || static_cast<std::uint64_t>(status.st_size) >= 0xFFFFFFFFull) {
+    return -1;
+  }
+
+  std::size_t size = static_cast<std::size_t>(status.st_size);
+  if (!snapshot) {
+    // The mapping outlives the guest fd, and accessible() needs the file.
+    int file_fd = ::fcntl(host, F_DUPFD_CLOEXEC, 0);
+    if (file_fd < 0) {
+      return -1;
+    }
+    int protection = copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    int sharing = copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+    void* address = ::mmap(nullptr, size, protection, sharing, host, 0);
+    if (address == MAP_FAILED) {
+      ::close(file_fd);
+      return -1;
+    }
+    out_mapping = HostMapping(address, size, copy_on_write, file_fd);
+    return static_cast<std::int64_t>(size);
+  }
+
+  HostMapping mapping = HostMapping::allocate(size, copy_on_write);
+  if (mapping.empty()) {
+    return -1;
+  }
+  std::size_t total = 0;
+  while (total < size) {
+    ssize_t received = ::pread(host, mapping.data() + total, size - total, static_cast<off_t>(total));
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received < 0) {
+      return -1;
+    }
+    if (received == 0) {
+      break;  // shrank since fstat(); the rest stays zero
+    }
+    total += static_cast<std::size_t>(received);
+  }
+  if (!mapping.seal()) {
+    return -1;
+  }
+  out_mapping = std::move(mapping);
+  return static_cast<std::int64_t>(size);
+}
+
+}  // namespace bc
@@ -0,0 +1,697 @@
+//  jit_x86_64.cpp:
+//    Baseline x86-64 code generator for decoded BVM basic blocks.
+//
+
+#include "bytecraft/jit.hpp"
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__FreeBSD__))
+#define BYTECRAFT_JIT_X86_64 1
+#include <sys/mman.h>
+#else
+#define BYTECRAFT_JIT_X86_64 0
+#endif
+
+namespace bc {
+
+#if BYTECRAFT_JIT_X86_64
+
+namespace {
+
+/**
+ * @brief Host register numbers as used in ModRM/REX encoding.
+ */
+enum HostReg : std::uint8_t {
+  RAX = 0,
+  RCX = 1,
+  RDX = 2,
+  RBX = 3,
+  RSP = 4,
+  RBP = 5,
+  RSI = 6,
+  RDI = 7,
+  R12 = 12,
+  R13 = 13,
+  R14 = 14,
+  R15 = 15
+};
+
+/**
+ * @brief Condition-code nibbles for jcc/cmovcc.
+ */
+enum Cond : std::uint8_t {
+  CC_B  = 0x2,
+  CC_E  = 0x4,
+  CC_NE = 0x5,
+  CC_A  = 0x7,
+  CC_L  = 0xC,
+  CC_G  = 0xF
+};
+
+// Calling convention of a block (System V): rdi = register file, rsi = memory image,
+// rdx = instruction budget. rdx is a compare scratch, so the budget pointer moves to rbp.
+constexpr std::uint8_t REGS_BASE = RDI;
+constexpr std::uint8_t MEMORY_BASE = RSI;
+constexpr std::uint8_t BUDGET_BASE = RBP;
+
+constexpr std::size_t MAX_BLOCK_INSTRS = 64;
+constexpr std::size_t CHUNK_SIZE = 256 * 1024;
+
+/**
+ * @brief Host register holding guest register r1..r8 (r8d..r15d).
+ */
+constexpr std::uint8_t host_reg(std::uint8_t guest_reg) {
+  return static_cast<std::uint8_t>(8 + guest_reg);
+}
+
+/**
+ * @brief Byte offset of a guest register inside the register file.
+ */
+constexpr std::int32_t reg_offset(std::uint8_t guest_reg) {
+  return static_cast<std::int32_t>(guest_reg) * 4;
+}
+
+/**
+ * @brief Minimal x86-64 encoder for the 32-bit forms the translator needs.
+ */
+class Emitter {
+ public:
+  std::vector<std::uint8_t> bytes;
+
+  void u8(std::uint8_t value) {
+    bytes.push_back(value);
+  }
+
+  void u32(std::uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      bytes.push_back(static_cast<std::uint8_t>((value >> shift) & 0xFF));
+    }
+  }
+
+  // op r/m32, r32 with r/m a register (e.g. 0x89 mov, 0x01 add, 0x39 cmp).
+  void op_rr(std::uint8_t opcode, std::uint8_t rm, std::uint8_t reg) {
+    rex(reg, rm);
+    u8(opcode);
+    modrm_reg(reg, rm);
+  }
+
+  // op with a [base + disp] memory operand (e.g. 0x8B load, 0x89 store, 0x03 add).
+  void op_mem(std::uint8_t opcode, std::uint8_t reg, std::uint8_t base, std::int32_t disp) {
+    rex(reg, base);
+    u8(opcode);
+    modrm_mem(reg, base, disp);
+  }
+
+  // 0x81 /ext r/m32, imm32 with r/m a register.
+  void op_ri(std::uint8_t ext, std::uint8_t rm, std::uint32_t imm) {
+    rex(0, rm);
+    u8(0x81);
+    modrm_reg(ext, rm);
+    u32(imm);
+  }
+
+  // 0x81 /ext [base + disp], imm32.
+  void op_mi(std::uint8_t ext, std::uint8_t base, std::int32_t disp, std::uint32_t imm) {
+    rex(0, base);
+    u8(0x81);
+    modrm_mem(ext, base, disp);
+    u32(imm);
+  }
+
+  void mov_ri(std::uint8_t reg, std::uint32_t imm) {
+    rex(0, reg);
+    u8(static_cast<std::uint8_t>(0xB8 + (reg & 7)));
+    u32(imm);
+  }
+
+  void mov_mi(std::uint8_t base, std::int32_t disp, std::uint32_t imm) {
+    rex(0, base);
+    u8(0xC7);
+    modrm_mem(0, base, disp);
+    u32(imm);
+  }
+
+  // mov r64, r64.
+  void mov_rr64(std::uint8_t dst, std::uint8_t src) {
+    rex_w(src, dst);
+    u8(0x89);
+    modrm_reg(src, dst);
+  }
+
+  // sub qword [base + disp], imm32 (sign-extended).
+  void sub_m64i(std::uint8_t base, std::int32_t disp, std::uint32_t imm) {
+    rex_w(0, base);
+    u8(0x81);
+    modrm_mem(5, base, disp);
+    u32(imm);
+  }
+
+  void test_m8i(std::uint8_t base, std::int32_t disp, std::uint8_t imm) {
+    rex(0, base);
+    u8(0xF6);
+    modrm_mem(0, base, disp);
+    u8(imm);
+  }
+
+  void test_mi(std::uint8_t base, std::int32_t disp, std::uint32_t imm) {
+    rex(0, base);
+    u8(0xF7);
+    modrm_mem(0, base, disp);
+    u32(imm);
+  }
+
+  void cmov(std::uint8_t cond, std::uint8_t reg, std::uint8_t rm) {
+    rex(reg, rm);
+    u8(0x0F);
+    u8(static_cast<std::uint8_t>(0x40 | cond));
+    modrm_reg(reg, rm);
+  }
+
+  std::size_t jcc(std::uint8_t cond) {
+    u8(0x0F);
+    u8(static_cast<std::uint8_t>(0x80 | cond));
+    u32(0);
+    return bytes.size() - 4;
+  }
+
+  std::size_t jmp() {
+    u8(0xE9);
+    u32(0);
+    return bytes.size() - 4;
+  }
+
+  void patch(std::size_t at, std::size_t target) {
+    std::int32_t rel = static_cast<std::int32_t>(static_cast<std::int64_t>(target) - static_cast<std::int64_t>(at + 4));
+    std::uint32_t raw = static_cast<std::uint32_t>(rel);
+    std::memcpy(&bytes[at], &raw, 4);
+  }
+
+  void bind(std::size_t at) {
+    patch(at, bytes.size());
+  }
+
+  void push(std::uint8_t reg) {
+    if ((reg & 8) != 0) {
+      u8(0x41);
+    }
+    u8(static_cast<std::uint8_t>(0x50 + (reg & 7)));
+  }
+
+  void pop(std::uint8_t reg) {
+    if ((reg & 8) != 0) {
+      u8(0x41);
+    }
+    u8(static_cast<std::uint8_t>(0x58 + (reg & 7)));
+  }
+
+  void ret() {
+    u8(0xC3);
+  }
+
+ private:
+  void rex_w(std::uint8_t reg, std::uint8_t rm) {
+    u8(static_cast<std::uint8_t>(0x48 | ((reg & 8) ? 0x4 : 0) | ((rm & 8) ? 0x1 : 0)));
+  }
+
+  void rex(std::uint8_t reg, std::uint8_t rm) {
+    std::uint8_t value = static_cast<std::uint8_t>(0x40 | ((reg & 8) ? 0x4 : 0) | ((rm & 8) ? 0x1 : 0));
+    if (value != 0x40) {
+      u8(value);
+    }
+  }
+
+  void modrm_reg(std::uint8_t reg, std::uint8_t rm) {
+    u8(static_cast<std::uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+  }
+
+  void modrm_mem(std::uint8_t reg, std::uint8_t base, std::int32_t disp) {
+    if (disp >= -128 && disp <= 127) {
+      u8(static_cast<std::uint8_t>(0x40 | ((reg & 7) << 3) | (base & 7)));
+      u8(static_cast<std::uint8_t>(disp & 0xFF));
+    } else {
+      u8(static_cast<std::uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+      u32(static_cast<std::uint32_t>(disp));
+    }
+  }
+};
+
+/**
+ * @brief Check whether a register operand can live in a host register.
+ */
+bool is_general(std::uint8_t reg) {
+  return reg <= R8;
+}
+
+/**
+ * @brief Check whether a 4-byte guest access at @p address is in bounds and encodable as disp32.
+ */
+bool mem_ok(std::uint32_t address, std::size_t memory_size) {
+  return address <= 0x7FFFFFFFu && static_cast<std::uint64_t>(address) + 4 <= memory_size;
+}
+
+/**
+ * @brief Decide whether a decoded record can be translated.
+ *
+ * @param instr        Decoded record.
+ * @param memory_size  Size of the VM memory image.
+ * @param code_size    Size of the code region.
+ * @return true if the translator handles this instruction.
+ */
+bool translatable(const DecodedInstr& instr, std::size_t memory_size, std::uint32_t code_size) {
+  if ((instr.flags & DF_DECODED) == 0u) {
+    return false;
+  }
+  switch (instr.op) {
+    case OP_NOP:
+      return true;
+    case OP_JMP:
+    case OP_JEQ:
+    case OP_JNEQ:
+    case OP_JLA:
+    case OP_JLE:
+      return instr.src_type == OT_IMM || is_general(instr.src_reg);
+    case OP_MOV:
+    case OP_ADD:
+    case OP_SUB:
+    case OP_XOR:
+    case OP_CMP:
+      break;
+    default:
+      return false;
+  }
+
+  if (instr.dst_type == OT_REG && !is_general(instr.dst_reg)) {
+    return false;
+  }
+  if (instr.dst_type == OT_MEM) {
+    if (!mem_ok(instr.dst_value, memory_size) || instr.dst_value < code_size) {
+      return false;
+    }
+  }
+  if (instr.src_type == OT_REG && !is_general(instr.src_reg)) {
+    return false;
+  }
+  if (instr.src_type == OT_MEM && !mem_ok(instr.src_value, memory_size)) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Emit rF = (rF & ~(EQ|GT|LT)) | compare(lhs, rhs), honoring rS at run time.
+ */
+void emit_compare(Emitter& out, std::uint8_t lhs, const DecodedInstr& instr) {
+  std::uint8_t rhs = RBX;
+  if (instr.src_type == OT_REG) {
+    rhs = host_reg(instr.src_reg);
+  } else if (instr.src_type == OT_MEM) {
+    out.op_mem(0x8B, RBX, MEMORY_BASE, static_cast<std::int32_t>(instr.src_value));
+  }
+
+  auto emit_cmp = [&]() {
+    if (instr.src_type == OT_IMM) {
+      out.op_ri(7, lhs, instr.src_value);
+    } else {
+      out.op_rr(0x39, lhs, rhs);
+    }
+  };
+
+  auto emit_select = [&](std::uint8_t greater_cond) {
+    out.mov_ri(RCX, F_LT);
+    out.mov_ri(RDX, F_GT);
+    out.cmov(greater_cond, RCX, RDX);
+    out.mov_ri(RDX, F_EQ);
+    out.cmov(CC_E, RCX, RDX);
+  };
+
+  out.op_mem(0x8B, RAX, REGS_BASE, reg_offset(RF));
+  out.op_ri(4, RAX, ~static_cast<std::uint32_t>(F_EQ | F_GT | F_LT));
+  out.test_m8i(REGS_BASE, reg_offset(RS), 1);
+  std::size_t to_signed = out.jcc(CC_NE);
+
+  emit_cmp();
+  emit_select(CC_A);
+  std::size_t to_done = out.jmp();
+
+  out.bind(to_signed);
+  emit_cmp();
+  emit_select(CC_G);
+
+  out.bind(to_done);
+  out.op_rr(0x09, RAX, RCX);
+  out.op_mem(0x89, RAX, REGS_BASE, reg_offset(RF));
+}
+
+/**
+ * @brief Emit an ALU operation (add/sub/xor) into a host register.
+ */
+void emit_alu(Emitter& out, const DecodedInstr& instr) {
+  std::uint8_t opcode_rr = 0x01;
+  std::uint8_t opcode_rm = 0x03;
+  std::uint8_t ext = 0;
+  if (instr.op == OP_SUB) {
+    opcode_rr = 0x29;
+    opcode_rm = 0x2B;
+    ext = 5;
+  } else if (instr.op == OP_XOR) {
+    opcode_rr = 0x31;
+    opcode_rm = 0x33;
+    ext = 6;
+  }
+
+  std::uint8_t dst = host_reg(instr.dst_reg);
+  if (instr.src_type == OT_REG) {
+    out.op_rr(opcode_rr, dst, host_reg(instr.src_reg));
+  } else if (instr.src_type == OT_IMM) {
+    out.op_ri(ext, dst, instr.src_value);
+  } else {
+    out.op_mem(opcode_rm, dst, MEMORY_BASE, static_cast<std::int32_t>(instr.src_value));
+  }
+}
+
+/**
+ * @brief Emit a mov in any of its translatable forms.
+ */
+void emit_mov(Emitter& out, const DecodedInstr& instr) {
+  if (instr.dst_type == OT_MEM) {
+    std::int32_t disp = static_cast<std::int32_t>(instr.dst_value);
+    if (instr.src_type == OT_REG) {
+      out.op_mem(0x89, host_reg(instr.src_reg), MEMORY_BASE, disp);
+    } else {
+      out.mov_mi(MEMORY_BASE, disp, instr.src_value);
+    }
+    return;
+  }
+
+  std::uint8_t dst = host_reg(instr.dst_reg);
+  if (instr.src_type == OT_REG) {
+    out.op_rr(0x89, dst, host_reg(instr.src_reg));
+  } else if (instr.src_type == OT_IMM) {
+    out.mov_ri(dst, instr.src_value);
+  } else {
+    out.op_mem(0x8B, dst, MEMORY_BASE, static_cast<std::int32_t>(instr.src_value));
+  }
+}
+
+/**
+ * @brief Translate the block starting at record @p first into machine code.
+ *
+ * @return Encoded function, or an empty vector if nothing could be translated.
+ */
+std::vector<std::uint8_t> translate_block(const DecodedProgram& program,
+                                          std::uint32_t first,
+                                          std::size_t memory_size,
+                                          std::uint32_t code_size) {
+  std::vector<const DecodedInstr*> body;
+  for (std::uint32_t index = first; index < program.instrs.size() && body.size() < MAX_BLOCK_INSTRS; index += 1) {
+    const DecodedInstr& instr = program.instrs[index];
+    if (!translatable(instr, memory_size, code_size)) {
+      break;
+    }
+    body.push_back(&instr);
+    if (instr.op >= OP_JMP && instr.op <= OP_JLE) {
+      break;
+    }
+  }
+  if (body.empty()) {
+    return {};
+  }
+
+  std::uint32_t used = 0;
+  for (const DecodedInstr* instr : body) {
+    if (instr->dst_type == OT_REG) {
+      used |= 1u << instr->dst_reg;
+    }
+    if (instr->src_type == OT_REG) {
+      used |= 1u << instr->src_reg;
+    }
+  }
+
+  Emitter out;
+  static constexpr std::uint8_t saved[] = {RBX, RBP, R12, R13, R14, R15};
+  for (std::uint8_t reg : saved) {
+    out.push(reg);
+  }
+  out.mov_rr64(BUDGET_BASE, RDX);
+  for (std::uint8_t reg = R1; reg <= R8; reg += 1) {
+    if ((used & (1u << reg)) != 0u) {
+      out.op_mem(0x8B, host_reg(reg), REGS_BASE, reg_offset(reg));
+    }
+  }
+
+  std::size_t loop_head = out.bytes.size();
+  std::uint32_t entry_ip = body.front()->ip;
+  std::uint32_t length = static_cast<std::uint32_t>(body.size());
+  std::vector<std::size_t> exits;
+  std::vector<std::size_t> charged_exits;
+  bool ends_in_branch = false;
+
+  for (const DecodedInstr* instr : body) {
+    switch (instr->op) {
+      case OP_NOP:
+        break;
+      case OP_MOV:
+        emit_mov(out, *instr);
+        break;
+      case OP_ADD:
+      case OP_SUB:
+      case OP_XOR:
+        emit_alu(out, *instr);
+        break;
+      case OP_CMP:
+        emit_compare(out, host_reg(instr->dst_reg), *instr);
+        break;
+      default: {
+        ends_in_branch = true;
+        std::size_t not_taken = 0;
+        bool conditional = instr->op != OP_JMP;
+        if (conditional) {
+          std::uint32_t mask = F_EQ;
+          std::uint8_t skip_cond = CC_E;
+          if (instr->op == OP_JNEQ) {
+            skip_cond = CC_NE;
+          } else if (instr->op == OP_JLA) {
+            mask = F_GT;
+          } else if (instr->op == OP_JLE) {
+            mask = F_LT | F_EQ;
+          }
+          out.test_mi(REGS_BASE, reg_offset(RF), mask);
+          not_taken = out.jcc(skip_cond);
+        }
+
+        out.op_mi(1, REGS_BASE, reg_offset(RF), F_TEST_TRUE);
+        if (instr->src_type == OT_IMM && instr->src_value == entry_ip) {
+          out.sub_m64i(BUDGET_BASE, 0, length);
+          out.patch(out.jcc(CC_G), loop_head);
+          out.mov_mi(REGS_BASE, reg_offset(IP), entry_ip);
+          charged_exits.push_back(out.jmp());
+        } else {
+          if (instr->src_type == OT_IMM) {
+            out.mov_mi(REGS_BASE, reg_offset(IP), instr->src_value);
+          } else {
+            out.op_mem(0x89, host_reg(instr->src_reg), REGS_BASE, reg_offset(IP));
+          }
+          exits.push_back(out.jmp());
+        }
+
+        if (conditional) {
+          out.bind(not_taken);
+          out.op_mi(4, REGS_BASE, reg_offset(RF), ~static_cast<std::uint32_t>(F_TEST_TRUE));
+          out.mov_mi(REGS_BASE, reg_offset(IP), instr->next_ip);
+        }
+        break;
+      }
+    }
+  }
+
+  if (!ends_in_branch) {
+    out.mov_mi(REGS_BASE, reg_offset(IP), body.back()->next_ip);
+  }
+
+  for (std::size_t at : exits) {
+    out.bind(at);
+  }
+  out.sub_m64i(BUDGET_BASE, 0, length);
+  for (std::size_t at : charged_exits) {
+    out.bind(at);
+  }
+  for (std::uint8_t reg = R1; reg <= R8; reg += 1) {
+    if ((used & (1u << reg)) != 0u) {
+      out.op_mem(0x89, host_reg(reg), REGS_BASE, reg_offset(reg));
+    }
+  }
+  for (std::size_t i = sizeof(saved); i > 0; i -= 1) {
+    out.pop(saved[i - 1]);
+  }
+  out.ret();
+
+  return std::move(out.bytes);
+}
+
+}  // namespace
+
+/**
+ * @brief Report whether this build can generate native code.
+ *
+ * @return true.
+ */
+bool jit_available() {
+  return true;
+}
+
+/**
+ * @brief Copy encoded code into executable memory.
+ *
+ * Chunks are mapped read/write, filled, then flipped to read/execute, so no
+ * page is ever writable and executable at the same time.
+ *
+ * @param code  Encoded machine code.
+ * @return Entry point of the installed code, or nullptr if mapping failed.
+ */
+JitBlockFn JitCache::install(const std::vector<std::uint8_t>& code) {
+  Chunk* chunk = nullptr;
+  for (Chunk& candidate : chunks_) {
+    if (candidate.size - candidate.used >= code.size()) {
+      chunk = &candidate;
+      break;
+    }
+  }
+  if (chunk == nullptr) {
+    std::size_t size = (code.size() > CHUNK_SIZE) ? ((code.size() + 4095) & ~static_cast<std::size_t>(4095)) : CHUNK_SIZE;
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      return nullptr;
+    }
+    chunks_.push_back({static_cast<std::uint8_t*>(base), size, 0});
+    chunk = &chunks_.back();
+  } else if (mprotect(chunk->base, chunk->size, PROT_READ | PROT_WRITE) != 0) {
+    return nullptr;
+  }
+
+  std::uint8_t* entry = chunk->base + chunk->used;
+  std::memcpy(entry, code.data(), code.size());
+  chunk->used += (code.size() + 15) & ~static_cast<std::size_t>(15);
+  if (chunk->used > chunk->size) {
+    chunk->used = chunk->size;
+  }
+
+  if (mprotect(chunk->base, chunk->size, PROT_READ | PROT_EXEC) != 0) {
+    return nullptr;
+  }
+  return reinterpret_cast<JitBlockFn>(entry);
+}
+
+/**
+ * @brief Unmap all executable chunks.
+ *
+ * @return void
+ */
+void JitCache::release() {
+  for (Chunk& chunk : chunks_) {
+    munmap(chunk.base, chunk.size);
+  }
+  chunks_.clear();
+}
+
+/**
+ * @brief Return the translated block starting at @p ip, translating it on first use.
+ *
+ * Failed translations are remembered so the interpreter is not slowed down
+ * by retrying them.
+ *
+ * @param program      Decoded code section.
+ * @param ip           Entry IP of the block.
+ * @param memory_size  Size of the VM memory image.
+ * @param code_size    Size of the code region.
+ * @return Native entry point, or nullptr if the first instruction cannot be translated.
+ */
+JitBlockFn JitCache::block_at(const DecodedProgram& program,
+                              std::uint32_t ip,
+                              std::size_t memory_size,
+                              std::uint32_t code_size) {
+  if (blocks_.size() != program.index_of_ip.size()) {
+    blocks_.assign(program.index_of_ip.size(), nullptr);
+    translated_.assign(program.index_of_ip.size(), 0);
+  }
+  if (ip >= blocks_.size()) {
+    return nullptr;
+  }
+  if (translated_[ip] != 0u) {
+    return blocks_[ip];
+  }
+
+  translated_[ip] = 1;
+  std::uint32_t index = program.index_at(ip);
+  if (index == NO_INDEX) {
+    return nullptr;
+  }
+  std::vector<std::uint8_t> code = translate_block(program, index, memory_size, code_size);
+  if (!code.empty()) {
+    blocks_[ip] = install(code);
+  }
+  return blocks_[ip];
+}
+
+#else
+
+bool jit_available() {
+  return false;
+}
+
+JitBlockFn JitCache::install(const std::vector<std::uint8_t>& code) {
+  (void)code;
+  return nullptr;
+}
+
+void JitCache::release() {
+  chunks_.clear();
+}
+
+JitBlockFn JitCache::block_at(const DecodedProgram& program,
+                              std::uint32_t ip,
+                              std::size_t memory_size,
+                              std::uint32_t code_size) {
+  (void)program;
+  (void)ip;
+  (void)memory_size;
+  (void)code_size;
+  return nullptr;
+}
+
+#endif
+
+JitCache::~JitCache() {
+  release();
+}
+
+JitCache::JitCache(JitCache&& other) noexcept
+  : chunks_(std::exchange(other.chunks_, {})),
+    blocks_(std::exchange(other.blocks_, {})),
+    translated_(std::exchange(other.translated_, {})) {
+}
+
+JitCache& JitCache::operator=(JitCache&& other) noexcept {
+  if (this != &other) {
+    release();
+    chunks_ = std::exchange(other.chunks_, {});
+    blocks_ = std::exchange(other.blocks_, {});
+    translated_ = std::exchange(other.translated_, {});
+  }
+  return *this;
+}
+
+/**
+ * @brief Drop every translated block; executable chunks are kept for reuse.
+ *
+ * @return void
+ */
+void JitCache::clear() {
+  blocks_.clear();
+  translated_.clear();
+  for (Chunk& chunk : chunks_) {
+    chunk.used = 0;
+  }
+}
+
+}  // namespace bc
@@ -34,21 +34,52 @@
 // Usage:
 //   bytecraft asm input.asm -o output.bvm
 //   bytecraft run program.bvm
+//   bytecraft run --engine=switch|predecoded|threaded|cached|jit|tiered program.bvm
+//   bytecraft run --trace=trace.bin program.bvm
+//   bytecraft run --stats[=json] program.bvm
+//   bytecraft run --profile=out.folded [--profile-interval=N] program.bvm
+//   bytecraft run --cache-sim[=32K:64:8,256K:64:8] program.bvm
+//   bytecraft run --coverage=report.txt [--coverage-map=edges.bin] [--source=program.asm] program.bvm
+//   bytecraft run --record=session.log program.bvm
+//   bytecraft run --replay=session.log program.bvm
+//   bytecraft run --direct-io program.bvm
+//   bytecraft run --sandbox=data/ program.bvm
+//   bytecraft trace-dump trace.bin
+//   bytecraft bench [--engine=jit] [--repetitions=N] [--iterations=N] [-o results.json]
+//   bytecraft bench --compare base.json current.json [--threshold=PCT] [--alpha=P]
+//   bytecraft gen arith|stream|branchy|syscall|large [--seed=N] [--size=N] [--iterations=N] [-o out.asm]
 
 //
 // NOTE: This is a compact implementation meant to be extended.
 
 #include "bytecraft/asm.hpp"
+#include "bytecraft/bench.hpp"
 #include "bytecraft/bytecode.hpp"
+#include "bytecraft/gen.hpp"
+#include "bytecraft/profile.hpp"
+#include "bytecraft/trace.hpp"
 #include "bytecraft/vm.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <vector>
 
 static void print_usage() {
   std::cerr << "Usage:\n"
             << "  bytecraft asm <input.asm> -o <output.bvm>\n"
-            << "  bytecraft run [--quiet] <program.bvm>\n";
+            << "  bytecraft run [--quiet] [--engine=tiered|switch|predecoded|threaded|cached|jit] [--trace=<file>] [--stats[=json]]\n"
+            << "                [--profile=<file.folded>] [--profile-interval=<n>]\n"
+            << "                [--coverage=<report>] [--coverage-map=<file>] [--source=<input.asm>]\n"
+            << "                [--cache-sim[=<size>:<line>:<ways>,...]] [--record=<log> | --replay=<log>]\n"
+            << "                [--direct-io] [--sandbox=<dir>] <program.bvm>\n"
+            << "  bytecraft trace-dump <file>\n"
+            << "  bytecraft bench [--engine=<engine>] [--repetitions=<n>] [--iterations=<n>] [-o <results.json>]\n"
+            << "  bytecraft bench --compare <base.json> <current.json> [--threshold=<percent>] [--alpha=<p>]\n"
+            << "  bytecraft gen <arith|stream|branchy|syscall|large> [--seed=<n>] [--size=<n>] [--iterations=<n>]\n"
+            << "                [-o <output.asm>]\n";
 }
 
 
@@ -108,9 +139,199 @@ int main(int argc, char** argv) {
     return 0;
   }
 
+  if (command == "bench") {
+    bc::BenchOptions options;
+    std::string output_path;
+    std::vector<std::string> compare_paths;
+    bool compare = false;
+    double threshold_percent = 2.0;
+    double alpha = 0.05;
+
+    for (int i = 2; i < argc; i += 1) {
+      std::string arg = argv[i];
+      if (arg == "-o" && (i + 1) < argc) {
+        output_path = argv[i + 1];
+        i += 1;
+        continue;
+      }
+      if (arg == "--compare") {
+        compare = true;
+        continue;
+      }
+      if (arg.rfind("--engine=", 0) == 0 && bc::parse_engine(arg.substr(9), options.engine)) {
+        continue;
+      }
+      if (arg.rfind("--repetitions=", 0) == 0) {
+        options.repetitions = static_cast<std::uint32_t>(std::strtoul(arg.c_str() + 14, nullptr, 0));
+        continue;
+      }
+      if (arg.rfind("--iterations=", 0) == 0) {
+        options.iterations = static_cast<std::uint32_t>(std::strtoul(arg.c_str() + 13, nullptr, 0));
+        continue;
+      }
+      if (arg.rfind("--threshold=", 0) == 0) {
+        threshold_percent = std::strtod(arg.c_str() + 12, nullptr);
+        continue;
+      }
+      if (arg.rfind("--alpha=", 0) == 0) {
+        alpha = std::strtod(arg.c_str() + 8, nullptr);
+        continue;
+      }
+      if (compare && !arg.empty() && arg[0] != '-') {
+        compare_paths.push_back(arg);
+        continue;
+      }
+      std::cerr << "error: bad argument '" << arg << "' for 'bench'\n";
+      return 1;
+    }
+
+    if (!compare) {
+      if (options.repetitions == 0u || options.iterations == 0u) {
+        std::cerr << "error: repetitions and iterations must be positive\n";
+        return 1;
+      }
+      bc::BenchReport report;
+      std::string error_message;
+      if (!bc::run_bench_suite(options, report, error_message)) {
+        std::cerr << "Bench failed: " << error_message << "\n";
+        return 1;
+      }
+      if (output_path.empty()) {
+        bc::write_bench_json(std::cout, report);
+        return 0;
+      }
+      std::ofstream output_file(output_path);
+      bc::write_bench_json(output_file, report);
+      if (!output_file) {
+        std::cerr << "Bench failed: cannot write " << output_path << "\n";
+        return 1;
+      }
+      return 0;
+    }
+
+    if (compare_paths.size() != 2) {
+      std::cerr << "error: --compare needs a base and a current results file\n";
+      return 1;
+    }
+    bc::BenchReport reports[2];
+    for (int index = 0; index < 2; index += 1) {
+      std::ifstream input_file(compare_paths[index]);
+      std::string text((std::istreambuf_iterator<char>(input_file)), std::istreambuf_iterator<char>());
+      std::string error_message;
+      if (!input_file || !bc::read_bench_json(text, reports[index], error_message)) {
+        std::cerr << "Compare failed: " << compare_paths[index] << ": "
+                  << (input_file ? error_message : "cannot read file") << "\n";
+        return 1;
+      }
+    }
+
+    bool regressed = false;
+    std::cout << std::left << std::setw(14) << "benchmark" << std::right << std::setw(14) << "base"
+              << std::setw(14) << "current" << std::setw(10) << "change" << std::setw(10) << "p" << "\n";
+    bc::BenchDiff diff = bc::compare_bench(reports[0], reports[1], threshold_percent, alpha);
+    for (const bc::BenchComparison& comparison : diff.comparisons) {
+      std::cout << std::left << std::setw(14) << comparison.name << std::right << std::fixed
+                << std::setprecision(2) << std::setw(14) << comparison.base_mean
+                << std::setw(14) << comparison.current_mean
+                << std::showpos << std::setw(9) << comparison.change_percent << "%" << std::noshowpos
+                << std::setprecision(4) << std::setw(10) << comparison.p_value
+                << "  " << comparison.unit << (comparison.regression ? "  REGRESSION" : "") << "\n";
+      regressed = regressed || comparison.regression;
+    }
+    std::cout << "peak RSS: " << reports[0].peak_rss_kib << " KiB -> " << reports[1].peak_rss_kib << " KiB\n";
+
+    // Reports that do not line up cannot gate a change either way.
+    if (diff.engine_mismatch) {
+      std::cerr << "Compare failed: engines differ (base " << reports[0].engine
+                << ", current " << reports[1].engine << ")\n";
+    }
+    for (const std::string& name : diff.missing) {
+      std::cerr << "Compare failed: " << name << " is missing from " << compare_paths[1] << "\n";
+    }
+    for (const std::string& name : diff.added) {
+      std::cerr << "Compare failed: " << name << " is not in " << compare_paths[0] << "\n";
+    }
+    if (diff.mismatched()) {
+      return 1;
+    }
+    return regressed ? 2 : 0;
+  }
+
+  if (command == "gen") {
+    if (argc < 3) {
+      std::cerr << "error: missing workload for 'gen'\n";
+      print_usage();
+      return 1;
+    }
+
+    bc::GenOptions options;
+    std::string output_path;
+    if (!bc::parse_workload(argv[2], options.workload)) {
+      std::cerr << "error: unknown workload '" << argv[2] << "'\n";
+      print_usage();
+      return 1;
+    }
+
+    auto parse_number = [](const std::string& text, std::uint64_t limit, std::uint64_t& out_value) {
+      char* end = nullptr;
+      out_value = std::strtoull(text.c_str(), &end, 0);
+      return !text.empty() && *end == '\0' && out_value <= limit;
+    };
+
+    for (int i = 3; i < argc; i += 1) {
+      std::string arg = argv[i];
+      std::uint64_t value = 0;
+      if (arg == "-o" && (i + 1) < argc) {
+        output_path = argv[i + 1];
+        i += 1;
+        continue;
+      }
+      if (arg.rfind("--seed=", 0) == 0 && parse_number(arg.substr(7), UINT64_MAX, value)) {
+        options.seed = value;
+        continue;
+      }
+      if (arg.rfind("--size=", 0) == 0 && parse_number(arg.substr(7), UINT32_MAX, value)) {
+        options.size = static_cast<std::uint32_t>(value);
+        continue;
+      }
+      if (arg.rfind("--iterations=", 0) == 0 && parse_number(arg.substr(13), UINT32_MAX, value) && value != 0u) {
+        options.iterations = static_cast<std::uint32_t>(value);
+        continue;
+      }
+      std::cerr << "error: bad argument '" << arg << "' for 'gen'\n";
+      return 1;
+    }
+
+    std::string source = bc::generate_program(options);
+    if (output_path.empty()) {
+      std::cout << source;
+      return 0;
+    }
+    std::ofstream output_file(output_path);
+    output_file << source;
+    if (!output_file) {
+      std::cerr << "Gen failed: cannot write " << output_path << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
   if (command == "run") {
     bool quiet = false;
+    bool direct_io = false;
+    bc::Engine engine = bc::Engine::Tiered;
     std::string program_path;
+    std::string trace_path;
+    std::string stats_format;
+    std::string profile_path;
+    std::uint64_t profile_interval = 10000;
+    std::string coverage_path;
+    std::string coverage_map_path;
+    std::string source_path;
+    std::vector<bc::CacheLevelConfig> cache_levels;
+    std::string record_path;
+    std::string replay_path;
+    std::string sandbox_path;
 
     for (int i = 2; i < argc; i += 1) {
       std::string arg = argv[i];
@@ -118,6 +339,72 @@ int main(int argc, char** argv) {
         quiet = true;
         continue;
       }
+      if (arg == "--direct-io") {
+        direct_io = true;
+        continue;
+      }
+      if (arg.rfind("--trace=", 0) == 0) {
+        trace_path = arg.substr(8);
+        continue;
+      }
+      if (arg == "--stats" || arg == "--stats=json") {
+        stats_format = (arg == "--stats") ? "text" : "json";
+        continue;
+      }
+      if (arg.rfind("--profile=", 0) == 0) {
+        profile_path = arg.substr(10);
+        continue;
+      }
+      if (arg.rfind("--profile-interval=", 0) == 0) {
+        profile_interval = std::strtoull(arg.c_str() + 19, nullptr, 0);
+        if (profile_interval == 0) {
+          std::cerr << "error: bad profile interval '" << arg.substr(19) << "'\n";
+          return 1;
+        }
+        continue;
+      }
+      if (arg.rfind("--coverage=", 0) == 0) {
+        coverage_path = arg.substr(11);
+        continue;
+      }
+      if (arg.rfind("--coverage-map=", 0) == 0) {
+        coverage_map_path = arg.substr(15);
+        continue;
+      }
+      if (arg.rfind("--source=", 0) == 0) {
+        source_path = arg.substr(9);
+        continue;
+      }
+      if (arg == "--cache-sim" || arg.rfind("--cache-sim=", 0) == 0) {
+        std::string levels_text = (arg == "--cache-sim") ? "32K:64:8,256K:64:8" : arg.substr(12);
+        std::string error_message;
+        if (!bc::parse_cache_config(levels_text, cache_levels, error_message)) {
+          std::cerr << "error: bad cache configuration: " << error_message << "\n";
+          return 1;
+        }
+        continue;
+      }
+      if (arg.rfind("--sandbox=", 0) == 0) {
+        sandbox_path = arg.substr(10);
+        continue;
+      }
+      if (arg.rfind("--record=", 0) == 0) {
+        record_path = arg.substr(9);
+        continue;
+      }
+      if (arg.rfind("--replay=", 0) == 0) {
+        replay_path = arg.substr(9);
+        continue;
+      }
+      if (arg.rfind("--engine=", 0) == 0) {
+        std::string engine_name = arg.substr(9);
+        if (!bc::parse_engine(engine_name, engine)) {
+          std::cerr << "error: unknown engine '" << engine_name << "'\n";
+          print_usage();
+          return 1;
+        }
+        continue;
+      }
       if (program_path.empty() && !arg.empty() && arg[0] != '-') {
         program_path = arg;
         continue;
@@ -129,6 +416,10 @@ int main(int argc, char** argv) {
       print_usage();
       return 1;
     }
+    if (!record_path.empty() && !replay_path.empty()) {
+      std::cerr << "error: --record and --replay are mutually exclusive\n";
+      return 1;
+    }
 
     bc::Module module;
     std::string error_message;
@@ -139,21 +430,114 @@ int main(int argc, char** argv) {
       return 1;
     }
 
-    std::vector<std::uint8_t> memory_image;
-    memory_image.reserve(module.code_section.size() + module.data_section.size());
-    memory_image.insert(memory_image.end(), module.code_section.begin(), module.code_section.end());
-    memory_image.insert(memory_image.end(), module.data_section.begin(), module.data_section.end());
+    bc::VM vm(module);
 
-    bc::VM vm(std::move(memory_image),
-              module.entry_point,
-              static_cast<std::uint32_t>(module.code_section.size()),
-              static_cast<std::uint32_t>(module.data_section.size()));
+    bool ok_verify = vm.verify(error_message);
+    if (!ok_verify && !quiet) {
+      std::cerr << "Verify: " << error_message << " (running with run-time checks)\n";
+    }
 
     if (quiet) {
       vm.set_tracing(false);
     }
+    if (!trace_path.empty() && !vm.set_trace_file(trace_path, error_message)) {
+      std::cerr << "Trace failed: " << error_message << "\n";
+      return 1;
+    }
+    vm.set_engine(engine);
+    if (!stats_format.empty()) {
+      vm.set_stats(true);
+    }
+    if (!coverage_path.empty() || !coverage_map_path.empty()) {
+      vm.set_coverage(true);
+    }
+    vm.set_cache_simulation(cache_levels);
+    vm.set_direct_io(direct_io);
+    if (!sandbox_path.empty() && !vm.set_file_root(sandbox_path, error_message)) {
+      std::cerr << "Sandbox failed: " << error_message << "\n";
+      return 1;
+    }
+    if (!record_path.empty() && !vm.set_syscall_record(record_path, error_message)) {
+      std::cerr << "Record failed: " << error_message << "\n";
+      return 1;
+    }
+    if (!replay_path.empty() && !vm.set_syscall_replay(replay_path, error_message)) {
+      std::cerr << "Replay failed: " << error_message << "\n";
+      return 1;
+    }
+
+    if (profile_path.empty()) {
+      vm.run();
+    } else {
+      std::ofstream profile_file(profile_path);
+      if (!profile_file) {
+        std::cerr << "Profile failed: cannot open profile file\n";
+        return 1;
+      }
+      bc::SamplingProfiler profiler(module.code_symbols);
+      profiler.run(vm, profile_interval);
+      profiler.write_folded(profile_file);
+    }
+
+    if (!vm.close_trace_file(error_message)) {
+      std::cerr << "Trace failed: " << error_message << "\n";
+      return 1;
+    }
+
+    if (!coverage_path.empty()) {
+      std::vector<std::string> source_lines;
+      if (!source_path.empty()) {
+        std::ifstream source_file(source_path);
+        for (std::string line; std::getline(source_file, line);) {
+          source_lines.push_back(line);
+        }
+      }
+      std::ofstream report_file(coverage_path);
+      if (!report_file) {
+        std::cerr << "Coverage failed: cannot open report file\n";
+        return 1;
+      }
+      vm.coverage()->write_report(report_file, module.code_symbols, module.line_table, source_lines);
+    }
+    if (!coverage_map_path.empty()) {
+      std::ofstream map_file(coverage_map_path, std::ios::binary);
+      const std::vector<std::uint8_t>& edge_map = vm.coverage()->edge_map();
+      map_file.write(reinterpret_cast<const char*>(edge_map.data()), static_cast<std::streamsize>(edge_map.size()));
+      if (!map_file) {
+        std::cerr << "Coverage failed: cannot write coverage map\n";
+        return 1;
+      }
+    }
+
+    if (vm.syscall_log() != nullptr && vm.syscall_log()->diverged()) {
+      std::cerr << "Replay diverged: program made a syscall the log does not have\n";
+      return 1;
+    }
+    if (vm.cache_simulation() != nullptr) {
+      vm.cache_simulation()->write_report(std::cerr, module.data_symbols,
+                                          static_cast<std::uint32_t>(module.code_section.size()));
+    }
+    if (stats_format == "text") {
+      vm.stats()->write_summary(std::cerr);
+    } else if (stats_format == "json") {
+      vm.stats()->write_json(std::cerr);
+    }
+    return 0;
+  }
 
-    vm.run();
+  if (command == "trace-dump") {
+    if (argc < 3) {
+      std::cerr << "error: missing trace file for 'trace-dump'\n";
+      print_usage();
+      return 1;
+    }
+
+    std::string error_message;
+    bool ok_dump = bc::dump_trace(argv[2], std::cout, error_message);
+    if (!ok_dump) {
+      std::cerr << "Dump failed: " << error_message << "\n";
+      return 1;
+    }
     return 0;
   }
 
@@ -0,0 +1,82 @@
+//  profile.cpp:
+//    Guest sampling profiler and folded-stack output.
+//
+
+#include "bytecraft/profile.hpp"
+#include <algorithm>
+#include <map>
+#include <string>
+
+namespace bc {
+
+SamplingProfiler::SamplingProfiler(std::vector<Symbol> code_symbols)
+    : code_symbols_(std::move(code_symbols)),
+      samples_(code_symbols_.size() + 1, 0) {
+}
+
+/**
+ * @brief Run @p vm to completion, sampling every @p interval instructions.
+ *
+ * @param vm        VM to run.
+ * @param interval  Instructions per sample (at least 1).
+ * @return Halted or Faulted, as reported by the last slice.
+ */
+RunStatus SamplingProfiler::run(VM& vm, std::uint64_t interval) {
+  interval = std::max<std::uint64_t>(interval, 1);
+  for (;;) {
+    RunStatus status = vm.run_for(interval);
+    if (status == RunStatus::BudgetExhausted) {
+      sample(vm.get_register(IP));
+    } else if (status != RunStatus::BlockedOnSyscall) {
+      return status;
+    }
+  }
+}
+
+/**
+ * @brief Record one sample at guest address @p ip.
+ *
+ * @param ip  Sampled IP.
+ * @return void
+ */
+void SamplingProfiler::sample(std::uint32_t ip) {
+  const Symbol* symbol = find_symbol(code_symbols_, ip);
+  std::size_t index = (symbol == nullptr)
+      ? code_symbols_.size()
+      : static_cast<std::size_t>(symbol - code_symbols_.data());
+  samples_[index] += 1;
+}
+
+/**
+ * @brief Total number of samples taken.
+ *
+ * @return Sample count.
+ */
+std::uint64_t SamplingProfiler::sample_count() const {
+  std::uint64_t total = 0;
+  for (std::uint64_t count : samples_) {
+    total += count;
+  }
+  return total;
+}
+
+/**
+ * @brief Print samples in folded-stack format ("frame count" per line).
+ *
+ * @param out  Stream to print to.
+ * @return void
+ */
+void SamplingProfiler::write_folded(std::ostream& out) const {
+  std::map<std::string, std::uint64_t> frames;
+  for (std::size_t index = 0; index < samples_.size(); index += 1) {
+    if (samples_[index] != 0u) {
+      const std::string& name = (index < code_symbols_.size()) ? code_symbols_[index].name : "_main";
+      frames[name] += samples_[index];
+    }
+  }
+  for (const auto& [name, count] : frames) {
+    out << name << " " << count << "\n";
+  }
+}
+
+}  // namespace bc
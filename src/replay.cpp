@@ -0,0 +1,138 @@
+//  replay.cpp:
+//    Syscall log reading and writing.
+//
+
+#include "bytecraft/replay.hpp"
+#include "bytecraft/util.hpp"
+#include <cstring>
+
+namespace bc {
+
+static constexpr char MAGIC_REPLAY[4] = {'B', 'C', 'R', 'L'};
+static constexpr std::uint32_t REPLAY_VERSION = 1;
+
+/**
+ * @brief Create @p path and start recording into it.
+ *
+ * @param path           Output log file.
+ * @param error_message  Set on failure.
+ * @return true on success, false if the file cannot be created.
+ */
+bool SyscallLog::open_record(const std::string& path, std::string& error_message) {
+  output_.open(path, std::ios::binary | std::ios::trunc);
+  if (!output_) {
+    error_message = "cannot open record file";
+    return false;
+  }
+
+  std::uint8_t header[8];
+  std::memcpy(header, MAGIC_REPLAY, 4);
+  write_u32_le(&header[4], REPLAY_VERSION);
+  output_.write(reinterpret_cast<const char*>(header), sizeof(header));
+  recording_ = true;
+  replaying_ = false;
+  return true;
+}
+
+/**
+ * @brief Load @p path for replay.
+ *
+ * @param path           Log written by a recording run.
+ * @param error_message  Set on failure.
+ * @return true on success, false if the file is missing or malformed.
+ */
+bool SyscallLog::open_replay(const std::string& path, std::string& error_message) {
+  std::ifstream input_file(path, std::ios::binary);
+  if (!input_file) {
+    error_message = "cannot open replay file";
+    return false;
+  }
+
+  std::uint8_t header[8];
+  if (!input_file.read(reinterpret_cast<char*>(header), sizeof(header))
+      || std::memcmp(header, MAGIC_REPLAY, 4) != 0) {
+    error_message = "not a syscall log";
+    return false;
+  }
+  if (read_u32_le(&header[4]) != REPLAY_VERSION) {
+    error_message = "unsupported syscall log version";
+    return false;
+  }
+
+  // Sizes data buffers against what the file actually holds, so a corrupt
+  // length field is reported instead of allocating up to 4 GiB.
+  std::streamoff position = input_file.tellg();
+  input_file.seekg(0, std::ios::end);
+  std::streamoff file_size = input_file.tellg();
+  input_file.seekg(position);
+
+  entries_.clear();
+  std::uint8_t fields[12];
+  while (input_file.read(reinterpret_cast<char*>(fields), sizeof(fields))) {
+    Entry entry;
+    entry.syscall_id = read_u32_le(&fields[0]);
+    entry.result = read_u32_le(&fields[4]);
+    std::uint32_t data_size = read_u32_le(&fields[8]);
+    if (static_cast<std::streamoff>(data_size) > file_size - input_file.tellg()) {
+      error_message = "truncated syscall log";
+      return false;
+    }
+    entry.data.resize(data_size);
+    if (!input_file.read(reinterpret_cast<char*>(entry.data.data()), static_cast<std::streamsize>(entry.data.size()))) {
+      error_message = "truncated syscall log";
+      return false;
+    }
+    entries_.push_back(std::move(entry));
+  }
+  if (input_file.gcount() != 0) {
+    error_message = "truncated syscall log";
+    return false;
+  }
+
+  next_entry_ = 0;
+  diverged_ = false;
+  recording_ = false;
+  replaying_ = true;
+  return true;
+}
+
+/**
+ * @brief Append one host call (record mode).
+ *
+ * @param syscall_id  Syscall that made the call.
+ * @param result      Value returned to the guest in r1.
+ * @param data        Bytes produced for guest memory, or nullptr.
+ * @param size        Number of bytes at @p data.
+ * @return void
+ */
+void SyscallLog::record(std::uint32_t syscall_id, std::uint32_t result, const std::uint8_t* data, std::uint32_t size) {
+  std::uint8_t fields[12];
+  write_u32_le(&fields[0], syscall_id);
+  write_u32_le(&fields[4], result);
+  write_u32_le(&fields[8], size);
+  output_.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+  if (size != 0u) {
+    output_.write(reinterpret_cast<const char*>(data), size);
+  }
+}
+
+/**
+ * @brief Take the next host call (replay mode).
+ *
+ * @param syscall_id  Syscall asking for its result.
+ * @param out_result  Recorded r1 value.
+ * @param out_data    Recorded bytes for guest memory.
+ * @return true on success, false if the replay diverged.
+ */
+bool SyscallLog::next(std::uint32_t syscall_id, std::uint32_t& out_result, std::vector<std::uint8_t>& out_data) {
+  if (diverged_ || next_entry_ >= entries_.size() || entries_[next_entry_].syscall_id != syscall_id) {
+    diverged_ = true;
+    return false;
+  }
+  out_result = entries_[next_entry_].result;
+  out_data = entries_[next_entry_].data;
+  next_entry_ += 1;
+  return true;
+}
+
+}  // namespace bc
@@ -0,0 +1,190 @@
+//  stats.cpp:
+//    Execution statistics reports.
+//
+
+#include "bytecraft/stats.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+namespace bc {
+
+namespace {
+
+// Branch sites listed in the text summary, most executed first.
+constexpr std::size_t SUMMARY_BRANCH_SITES = 16;
+
+std::string_view syscall_name(std::size_t syscall_id) {
+  switch (syscall_id) {
+    case SC_EXIT:
+      return "exit";
+    case SC_WRITE:
+      return "write";
+    case SC_READ:
+      return "read";
+    case SC_OPEN:
+      return "open";
+    case SC_FLUSH:
+      return "flush";
+    case SC_CLOSE:
+      return "close";
+    case SC_SEEK:
+      return "seek";
+    case SC_MMAP:
+      return "mmap";
+    case SC_WRITEV:
+      return "writev";
+    case SC_READV:
+      return "readv";
+    default:
+      return "";
+  }
+}
+
+struct BranchSite {
+  std::uint32_t ip;
+  std::uint64_t not_taken;
+  std::uint64_t taken;
+};
+
+std::vector<BranchSite> branch_sites(const std::vector<std::uint64_t>& branches) {
+  std::vector<BranchSite> sites;
+  for (std::size_t ip = 0; 2 * ip < branches.size(); ip += 1) {
+    if (branches[2 * ip] != 0u || branches[2 * ip + 1] != 0u) {
+      sites.push_back({static_cast<std::uint32_t>(ip), branches[2 * ip], branches[2 * ip + 1]});
+    }
+  }
+  return sites;
+}
+
+}  // namespace
+
+ExecStats::ExecStats(std::uint32_t code_size)
+    : counters_(SLOT_COUNT, 0),
+      branches_(2 * static_cast<std::size_t>(code_size), 0) {
+}
+
+/**
+ * @brief Executions of the branch at @p site that were (not) taken.
+ *
+ * @param site   Code address of the branch instruction.
+ * @param taken  Which outcome to return.
+ * @return Count for that outcome, 0 for addresses outside the code section.
+ */
+std::uint64_t ExecStats::branch_count(std::uint32_t site, bool taken) const {
+  std::size_t index = 2 * static_cast<std::size_t>(site) + (taken ? 1 : 0);
+  return (index < branches_.size()) ? branches_[index] : 0;
+}
+
+/**
+ * @brief Print a human-readable summary (non-zero counters only).
+ *
+ * @param out  Stream to print to.
+ * @return void
+ */
+void ExecStats::write_summary(std::ostream& out) const {
+  std::ios_base::fmtflags saved_flags = out.flags();
+  std::uint64_t instructions = counters_[INSTRUCTION_SLOT];
+  auto percent = [&](std::uint64_t count) {
+    return (instructions == 0u) ? 0.0 : 100.0 * static_cast<double>(count) / static_cast<double>(instructions);
+  };
+
+  out << "instructions: " << instructions << "\n";
+  out << "loads: " << counters_[LOAD_SLOT] << "  stores: " << counters_[STORE_SLOT] << "\n";
+
+  out << "opcodes:\n";
+  for (std::size_t opcode = 0; opcode < 256; opcode += 1) {
+    std::uint64_t count = counters_[OPCODE_SLOTS + opcode];
+    if (count == 0u) {
+      continue;
+    }
+    out << "  " << std::left << std::setw(8) << opcode_name(static_cast<std::uint8_t>(opcode)) << std::right
+        << std::setw(14) << count << "  " << std::fixed << std::setprecision(1) << std::setw(5)
+        << percent(count) << "%\n";
+  }
+
+  out << "modes:\n";
+  for (std::size_t mode = 0; mode < 256; mode += 1) {
+    std::uint64_t count = counters_[MODE_SLOTS + mode];
+    if (count == 0u) {
+      continue;
+    }
+    out << "  0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(2) << mode
+        << std::dec << std::nouppercase << std::setfill(' ') << "    " << std::setw(14) << count << "\n";
+  }
+
+  out << "syscalls:\n";
+  for (std::size_t syscall_id = 0; syscall_id < 256; syscall_id += 1) {
+    std::uint64_t count = counters_[SYSCALL_SLOTS + syscall_id];
+    if (count == 0u) {
+      continue;
+    }
+    out << "  " << std::left << std::setw(8)
+        << (syscall_id == 255 ? std::string(">=255") : std::to_string(syscall_id))
+        << std::setw(6) << syscall_name(syscall_id) << std::right << std::setw(8) << count << "\n";
+  }
+
+  std::vector<BranchSite> sites = branch_sites(branches_);
+  std::sort(sites.begin(), sites.end(), [](const BranchSite& a, const BranchSite& b) {
+    return (a.taken + a.not_taken) > (b.taken + b.not_taken);
+  });
+  if (sites.size() > SUMMARY_BRANCH_SITES) {
+    sites.resize(SUMMARY_BRANCH_SITES);
+  }
+  out << "branch sites:\n";
+  for (const BranchSite& site : sites) {
+    out << "  IP:" << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << site.ip
+        << std::dec << std::nouppercase << std::setfill(' ')
+        << "  taken " << std::setw(12) << site.taken << "  not taken " << std::setw(12) << site.not_taken << "\n";
+  }
+  out.flags(saved_flags);
+}
+
+/**
+ * @brief Print all non-zero counters as a single JSON object.
+ *
+ * @param out  Stream to print to.
+ * @return void
+ */
+void ExecStats::write_json(std::ostream& out) const {
+  auto write_map = [&](const char* key, std::size_t base, auto&& name_of) {
+    out << "\"" << key << "\":{";
+    bool first = true;
+    for (std::size_t index = 0; index < 256; index += 1) {
+      std::uint64_t count = counters_[base + index];
+      if (count == 0u) {
+        continue;
+      }
+      out << (first ? "" : ",") << "\"" << name_of(index) << "\":" << count;
+      first = false;
+    }
+    out << "}";
+  };
+
+  out << "{\"instructions\":" << counters_[INSTRUCTION_SLOT]
+      << ",\"loads\":" << counters_[LOAD_SLOT]
+      << ",\"stores\":" << counters_[STORE_SLOT] << ",";
+  write_map("opcodes", OPCODE_SLOTS, [](std::size_t opcode) {
+    return (opcode <= OP_SYSCALL) ? std::string(opcode_name(static_cast<std::uint8_t>(opcode)))
+                                  : std::to_string(opcode);
+  });
+  out << ",";
+  write_map("modes", MODE_SLOTS, [](std::size_t mode) {
+    return std::to_string(mode);
+  });
+  out << ",";
+  write_map("syscalls", SYSCALL_SLOTS, [](std::size_t syscall_id) {
+    return std::to_string(syscall_id);
+  });
+
+  out << ",\"branches\":[";
+  bool first = true;
+  for (const BranchSite& site : branch_sites(branches_)) {
+    out << (first ? "" : ",") << "{\"ip\":" << site.ip << ",\"taken\":" << site.taken
+        << ",\"not_taken\":" << site.not_taken << "}";
+    first = false;
+  }
+  out << "]}\n";
+}
+
+}  // namespace bc
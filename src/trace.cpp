@@ -0,0 +1,255 @@
+//  trace.cpp:
+//    Binary trace writer and the shared human-readable trace format.
+//
+
+#include "bytecraft/trace.hpp"
+#include "bytecraft/util.hpp"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace bc {
+
+static constexpr char MAGIC_TRACE[4] = {'B', 'C', 'T', 'R'};
+static constexpr std::uint32_t TRACE_VERSION = 1;
+
+/**
+ * @brief Print one trace line in the human-readable format of VM tracing.
+ *
+ * @param out        Stream to print to.
+ * @param ip_before  IP of the traced instruction.
+ * @param opcode     Opcode byte of the traced instruction.
+ * @param registers  Register file after the instruction (REG_COUNT values).
+ * @return void
+ */
+void write_trace_line(std::ostream& out,
+                      std::uint32_t ip_before,
+                      std::uint8_t opcode,
+                      const std::uint32_t* registers) {
+  std::uint32_t flags_value = registers[RF];
+
+  out << std::hex << std::uppercase << std::setfill('0');
+  out << "IP:" << std::setw(8) << ip_before << " OP:" << std::setw(2) << static_cast<unsigned>(opcode) << " | ";
+
+  for (int reg_index = R1; reg_index <= R8; reg_index += 1) {
+    out << register_name(static_cast<std::uint8_t>(reg_index)) << ":" << std::setw(8) << registers[reg_index] << " ";
+  }
+
+  out << "IP:" << std::setw(8) << registers[IP] << " ";
+  out << "rF:" << std::setw(8) << registers[RF] << " ";
+  out << "rS:" << (registers[RS] & 1u) << " ";
+
+  out << "["
+      << ((flags_value & F_EQ) ? "EQ " : "")
+      << ((flags_value & F_GT) ? "GT " : "")
+      << ((flags_value & F_LT) ? "LT " : "")
+      << ((flags_value & F_TEST_TRUE) ? "TEST " : "")
+      << ((flags_value & F_BAD_INSTR) ? "BAD " : "")
+      << ((flags_value & F_IP_OOB) ? "IP_OOB " : "")
+      << ((flags_value & F_READ_OOB) ? "R_OOB " : "")
+      << ((flags_value & F_WRITE_OOB) ? "W_OOB " : "")
+      << "]\n";
+
+  out << std::dec << std::nouppercase;
+}
+
+/**
+ * @brief Render a binary trace file in the human-readable format.
+ *
+ * @param path           Trace file written by TraceWriter.
+ * @param out            Stream to print to.
+ * @param error_message  Set on failure.
+ * @return true on success, false if the file is missing or malformed.
+ */
+bool dump_trace(const std::string& path, std::ostream& out, std::string& error_message) {
+  std::ifstream input_file(path, std::ios::binary);
+  if (!input_file) {
+    error_message = "cannot open trace file";
+    return false;
+  }
+
+  std::uint8_t header[12];
+  if (!input_file.read(reinterpret_cast<char*>(header), sizeof(header))
+      || std::memcmp(header, MAGIC_TRACE, 4) != 0) {
+    error_message = "not a trace file";
+    return false;
+  }
+  if (read_u32_le(&header[4]) != TRACE_VERSION || read_u32_le(&header[8]) != TRACE_RECORD_BYTES) {
+    error_message = "unsupported trace version";
+    return false;
+  }
+
+  std::uint8_t bytes[TRACE_RECORD_BYTES];
+  std::uint32_t registers[REG_COUNT];
+  while (input_file.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+    for (std::uint8_t reg = 0; reg < REG_COUNT; reg += 1) {
+      registers[reg] = read_u32_le(&bytes[8 + 4 * reg]);
+    }
+    write_trace_line(out, read_u32_le(&bytes[0]), bytes[4], registers);
+  }
+  if (input_file.gcount() != 0) {
+    error_message = "truncated trace record";
+    return false;
+  }
+  return true;
+}
+
+TraceWriter::~TraceWriter() {
+  close();
+}
+
+/**
+ * @brief Create @p path, write the file header and start the writer thread.
+ *
+ * @param path           Output trace file.
+ * @param error_message  Set on failure.
+ * @return true on success, false if the file cannot be created.
+ */
+bool TraceWriter::open(const std::string& path, std::string& error_message) {
+  close();
+  file_ = std::fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    error_message = "cannot open trace file";
+    return false;
+  }
+
+  std::uint8_t header[12];
+  std::memcpy(header, MAGIC_TRACE, 4);
+  write_u32_le(&header[4], TRACE_VERSION);
+  write_u32_le(&header[8], TRACE_RECORD_BYTES);
+  if (std::fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+    std::fclose(file_);
+    file_ = nullptr;
+    error_message = "cannot write trace file";
+    return false;
+  }
+
+  write_failed_.store(false, std::memory_order_relaxed);
+  head_.store(0, std::memory_order_relaxed);
+  tail_.store(0, std::memory_order_relaxed);
+  stopping_.store(false, std::memory_order_relaxed);
+  has_last_ = false;
+  writer_ = std::thread(&TraceWriter::drain, this);
+  return true;
+}
+
+/**
+ * @brief Append a record for one executed instruction.
+ *
+ * Only the producer (VM) thread calls this. Spins with yield while the
+ * ring is full.
+ *
+ * @param ip_before  IP of the instruction.
+ * @param opcode     Opcode byte of the instruction.
+ * @param registers  Register file after the instruction (REG_COUNT values).
+ * @return void
+ */
+void TraceWriter::record(std::uint32_t ip_before, std::uint8_t opcode, const std::uint32_t* registers) {
+  std::size_t head = head_.load(std::memory_order_relaxed);
+  while (head - tail_.load(std::memory_order_acquire) == RING_CAPACITY) {
+    std::this_thread::yield();
+  }
+
+  TraceRecord& slot = ring_[head & (RING_CAPACITY - 1)];
+  slot.ip_before = ip_before;
+  slot.opcode = opcode;
+  slot.changed = 0;
+  for (std::uint8_t reg = 0; reg < REG_COUNT; reg += 1) {
+    if (!has_last_ || registers[reg] != last_registers_[reg]) {
+      slot.changed = static_cast<std::uint16_t>(slot.changed | (1u << reg));
+    }
+  }
+  std::memcpy(slot.registers, registers, sizeof(slot.registers));
+  std::memcpy(last_registers_, registers, sizeof(last_registers_));
+  has_last_ = true;
+
+  head_.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Drain the ring, stop the writer thread and close the file.
+ *
+ * @param error_message  Set if any part of the trace could not be written.
+ * @return true if the whole trace reached the file, false otherwise.
+ */
+bool TraceWriter::close(std::string& error_message) {
+  if (writer_.joinable()) {
+    stopping_.store(true, std::memory_order_release);
+    writer_.join();
+  }
+  if (file_ != nullptr) {
+    if (std::fclose(file_) != 0) {
+      write_failed_.store(true, std::memory_order_relaxed);
+    }
+    file_ = nullptr;
+  }
+  if (write_failed_.exchange(false, std::memory_order_relaxed)) {
+    error_message = "cannot write trace file (trace is incomplete)";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief close() for callers with nowhere to report a write error.
+ *
+ * @return void
+ */
+void TraceWriter::close() {
+  std::string unused;
+  close(unused);
+}
+
+/**
+ * @brief Writer thread: serialize published records and write them in batches.
+ *
+ * Sleeps briefly while the ring is empty and exits once close() was
+ * requested and everything published has been written. The first failed
+ * write is remembered for close().
+ *
+ * @return void
+ */
+void TraceWriter::drain() {
+  std::vector<std::uint8_t> batch;
+  for (;;) {
+    bool stopping = stopping_.load(std::memory_order_acquire);
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t head = head_.load(std::memory_order_acquire);
+
+    if (tail == head) {
+      if (stopping) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      continue;
+    }
+
+    batch.resize((head - tail) * TRACE_RECORD_BYTES);
+    std::uint8_t* cursor = batch.data();
+    for (std::size_t position = tail; position != head; position += 1) {
+      const TraceRecord& slot = ring_[position & (RING_CAPACITY - 1)];
+      write_u32_le(cursor, slot.ip_before);
+      cursor[4] = slot.opcode;
+      cursor[5] = 0;
+      cursor[6] = static_cast<std::uint8_t>(slot.changed & 0xFF);
+      cursor[7] = static_cast<std::uint8_t>(slot.changed >> 8);
+      for (std::uint8_t reg = 0; reg < REG_COUNT; reg += 1) {
+        write_u32_le(cursor + 8 + 4 * reg, slot.registers[reg]);
+      }
+      cursor += TRACE_RECORD_BYTES;
+    }
+    tail_.store(head, std::memory_order_release);
+    // After the first failure keep draining so record() never stalls, but
+    // stop writing: the file is already incomplete.
+    if (!write_failed_.load(std::memory_order_relaxed)
+        && std::fwrite(batch.data(), 1, batch.size(), file_) != batch.size()) {
+      write_failed_.store(true, std::memory_order_relaxed);
+    }
+  }
+  if (std::fflush(file_) != 0) {
+    write_failed_.store(true, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace bc
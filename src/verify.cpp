@@ -0,0 +1,74 @@
+//  verify.cpp:
+//    Load-time bytecode verifier.
+//
+
+#include "bytecraft/verify.hpp"
+
+#include <sstream>
+
+#include "bytecraft/decode.hpp"
+
+namespace bc {
+
+/**
+ * @brief Format a code offset for verifier messages.
+ *
+ * @param offset  Code offset.
+ * @return Offset as "0x..." hex.
+ */
+static std::string hex_offset(std::uint32_t offset) {
+  std::ostringstream out;
+  out << "0x" << std::hex << std::uppercase << offset;
+  return out.str();
+}
+
+/**
+ * @brief Prove that a code section can run without per-fetch checks.
+ *
+ * The first pass decodes by linear sweep and records instruction starts, the
+ * second checks immediate branch targets against them. A linear sweep is
+ * sufficient because every verified instruction falls through to the next
+ * one and every immediate target is one of the swept starts.
+ *
+ * @param code            Pointer to the code section.
+ * @param code_size       Size of the code section in bytes.
+ * @param out_boundaries  One byte per code offset, nonzero where an instruction starts.
+ * @param error_message   Set to the first problem found on failure.
+ * @return true if the section verified, false otherwise.
+ */
+bool verify_code(const std::uint8_t* code,
+                 std::uint32_t code_size,
+                 std::vector<std::uint8_t>& out_boundaries,
+                 std::string& error_message) {
+  out_boundaries.assign(code_size, 0);
+
+  std::vector<DecodedInstr> branches;
+  std::uint32_t ip = 0;
+  while (ip < code_size) {
+    DecodedInstr instr;
+    if (!decode_instruction(code, code_size, ip, instr)) {
+      error_message = "invalid instruction at offset " + hex_offset(ip);
+      out_boundaries.clear();
+      return false;
+    }
+    out_boundaries[ip] = 1;
+    if (instr.op >= OP_JMP && instr.op <= OP_JLE && instr.src_type == OT_IMM) {
+      branches.push_back(instr);
+    }
+    ip = instr.next_ip;
+  }
+
+  for (const DecodedInstr& branch : branches) {
+    std::uint32_t target = branch.src_value;
+    if (target >= code_size || out_boundaries[target] == 0) {
+      error_message = "branch at offset " + hex_offset(branch.ip)
+          + " targets " + hex_offset(target) + ", which is not an instruction boundary";
+      out_boundaries.clear();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace bc
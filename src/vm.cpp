@@ -4,10 +4,88 @@
 
 #include "bytecraft/vm.hpp"
 #include "bytecraft/util.hpp"
+#include "bytecraft/verify.hpp"
+#include "vm_exec.hpp"
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <limits>
+#include <utility>
 
 namespace bc {
 
+namespace {
+
+// Flat memory image of a module: code section followed by data section.
+std::vector<std::uint8_t> concat_sections(const Module& module) {
+  std::vector<std::uint8_t> memory_image;
+  memory_image.reserve(module.code_section.size() + module.data_section.size());
+  memory_image.insert(memory_image.end(), module.code_section.begin(), module.code_section.end());
+  memory_image.insert(memory_image.end(), module.data_section.begin(), module.data_section.end());
+  return memory_image;
+}
+
+}  // namespace
+
+/**
+ * @brief Parse an engine name as used on the command line.
+ *
+ * @param name        "switch", "predecoded", "threaded", "cached", "jit" or "tiered".
+ * @param out_engine  Parsed engine on success.
+ * @return true if @p name is a known engine, false otherwise.
+ */
+bool parse_engine(const std::string& name, Engine& out_engine) {
+  if (name == "switch") {
+    out_engine = Engine::Switch;
+    return true;
+  }
+  if (name == "predecoded") {
+    out_engine = Engine::Predecoded;
+    return true;
+  }
+  if (name == "threaded") {
+    out_engine = Engine::Threaded;
+    return true;
+  }
+  if (name == "cached") {
+    out_engine = Engine::Cached;
+    return true;
+  }
+  if (name == "jit") {
+    out_engine = Engine::Jit;
+    return true;
+  }
+  if (name == "tiered") {
+    out_engine = Engine::Tiered;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Return the command-line name of an engine.
+ *
+ * @param engine  Engine to name.
+ * @return Engine name, e.g. "predecoded".
+ */
+const char* engine_name(Engine engine) {
+  switch (engine) {
+    case Engine::Switch:
+      return "switch";
+    case Engine::Predecoded:
+      return "predecoded";
+    case Engine::Threaded:
+      return "threaded";
+    case Engine::Cached:
+      return "cached";
+    case Engine::Jit:
+      return "jit";
+    case Engine::Tiered:
+      return "tiered";
+  }
+  return "??";
+}
+
 /**
  * @brief Construct a VM instance with a memory image and layout metadata.
  *
@@ -30,54 +108,117 @@ VM::VM(std::vector<std::uint8_t> memory,
 }
 
 /**
- * @brief Check for out-of-bounds read access over a byte range.
+ * @brief Construct a VM over the [code][data] image of @p module.
  *
- * Sets READ_OOB flag and stops the VM when an OOB read is detected.
+ * @param module  Assembled or loaded program.
+ * @return void
+ */
+VM::VM(const Module& module)
+  : VM(concat_sections(module),
+       module.entry_point,
+       static_cast<std::uint32_t>(module.code_section.size()),
+       static_cast<std::uint32_t>(module.data_section.size())) {}
+
+/**
+ * @brief Raise fault flag @p flag in rF and stop the VM.
+ *
+ * The fault is also remembered outside rF, which the guest can write, so
+ * run_for() reports Faulted only for faults the VM raised.
+ *
+ * @param flag  F_BAD_INSTR, F_IP_OOB, F_READ_OOB or F_WRITE_OOB.
+ * @return void
+ */
+void VM::fault(std::uint32_t flag) {
+  registers_[RF] |= flag;
+  is_running_ = false;
+  faulted_ = true;
+}
+
+/**
+ * @brief Locate a guest byte range in host memory.
+ *
+ * The range must lie entirely inside the memory image or inside one
+ * SC_MMAP mapping; @p write additionally rejects read-only mappings.
+ * Ranges in a file mapping must also lie inside the file as it is now,
+ * since the host gets SIGBUS for pages a truncation cut off. Does not
+ * touch the flags.
+ *
+ * @param address  Starting address in the VM memory space.
+ * @param count    Number of bytes.
+ * @param write    true if the bytes are going to be written.
+ * @return Host pointer to the first byte, or nullptr.
+ */
+std::uint8_t* VM::guest_bytes(std::uint32_t address, std::size_t count, bool write) {
+  std::size_t memory_size = memory_image_.size();
+  if (address <= memory_size && count <= memory_size - address) {
+    return memory_image_.data() + address;
+  }
+  for (GuestMapping& mapping : mappings_) {
+    if (address < mapping.base) {
+      break;
+    }
+    std::size_t offset = address - mapping.base;
+    std::size_t size = mapping.host.size();
+    if (offset > size || count > size - offset) {
+      continue;
+    }
+    size = mapping.host.accessible();
+    if (offset > size || count > size - offset || (write && !mapping.host.writable())) {
+      return nullptr;
+    }
+    return mapping.host.data() + offset;
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Bounds-check a guest byte range for reading.
+ *
+ * Sets READ_OOB flag and stops the VM when the range is out of bounds.
  *
  * @param address  Starting address in the VM memory space.
  * @param count    Number of bytes intended to be read.
- * @return true if the range is out-of-bounds, false otherwise.
+ * @return Host pointer to the range, or nullptr if it is out-of-bounds.
  */
-bool VM::oob_read(std::uint32_t address, std::size_t count) {
-  std::uint32_t memory_size = static_cast<std::uint32_t>(memory_image_.size());
-  bool is_out_of_bounds = (address > memory_size) || (count > memory_size) || (address + count > memory_size);
-  if (is_out_of_bounds) {
-    registers_[RF] |= F_READ_OOB;
-    is_running_ = false;
+const std::uint8_t* VM::read_range(std::uint32_t address, std::size_t count) {
+  const std::uint8_t* bytes = guest_bytes(address, count, false);
+  if (bytes == nullptr) {
+    fault(F_READ_OOB);
   }
-  return is_out_of_bounds;
+  return bytes;
 }
 
 /**
- * @brief Check for out-of-bounds write access over a byte range.
+ * @brief Bounds-check a guest byte range for writing.
  *
- * Sets WRITE_OOB flag and stops the VM when an OOB write is detected.
+ * Sets WRITE_OOB flag and stops the VM when the range is out of bounds or
+ * in a read-only mapping.
  *
  * @param address  Starting address in the VM memory space.
  * @param count    Number of bytes intended to be written.
- * @return true if the range is out-of-bounds, false otherwise.
+ * @return Host pointer to the range, or nullptr if it is out-of-bounds.
  */
-bool VM::oob_write(std::uint32_t address, std::size_t count) {
-  std::uint32_t memory_size = static_cast<std::uint32_t>(memory_image_.size());
-  bool is_out_of_bounds = (address > memory_size) || (count > memory_size) || (address + count > memory_size);
-  if (is_out_of_bounds) {
-    registers_[RF] |= F_WRITE_OOB;
-    is_running_ = false;
+std::uint8_t* VM::write_range(std::uint32_t address, std::size_t count) {
+  std::uint8_t* bytes = guest_bytes(address, count, true);
+  if (bytes == nullptr) {
+    fault(F_WRITE_OOB);
   }
-  return is_out_of_bounds;
+  return bytes;
 }
 
 /**
  * @brief Fetch a single byte from the code stream at IP and advance IP.
  *
  * Sets IP_OOB flag and stops the VM if IP is outside the code region.
+ * The unchecked form is only used on verified code, where the verifier has
+ * proven that every instruction byte lies inside the code region.
  *
  * @return The fetched byte, or 0 if out-of-bounds.
  */
+template <bool CHECKED>
 std::uint8_t VM::fetch8() {
-  if (registers_[IP] >= code_size_bytes_) {
-    registers_[RF] |= F_IP_OOB;
-    is_running_ = false;
+  if (CHECKED && registers_[IP] >= code_size_bytes_) {
+    fault(F_IP_OOB);
     return 0;
   }
   std::uint8_t value = memory_image_[registers_[IP]];
@@ -88,14 +229,15 @@ std::uint8_t VM::fetch8() {
 /**
  * @brief Fetch a 32-bit little-endian value from the code stream and advance IP by 4.
  *
- * Sets IP_OOB flag and stops the VM if there are not enough bytes remaining in code.
+ * Sets IP_OOB flag and stops the VM if there are not enough bytes remaining
+ * in code. Unchecked on verified code, like fetch8().
  *
  * @return The fetched 32-bit value, or 0 if out-of-bounds.
  */
+template <bool CHECKED>
 std::uint32_t VM::fetch32() {
-  if (registers_[IP] + 4 > code_size_bytes_) {
-    registers_[RF] |= F_IP_OOB;
-    is_running_ = false;
+  if (CHECKED && registers_[IP] + 4 > code_size_bytes_) {
+    fault(F_IP_OOB);
     return 0;
   }
   std::uint32_t value = read_u32_le(&memory_image_[registers_[IP]]);
@@ -106,118 +248,176 @@ std::uint32_t VM::fetch32() {
 /**
  * @brief Read a 32-bit little-endian value from absolute memory.
  *
- * Performs bounds checking and sets READ_OOB on failure.
+ * Performs bounds checking and sets READ_OOB on failure. Addresses above
+ * the memory image read SC_MMAP mappings.
  *
  * @param address  Absolute address inside the VM memory space.
  * @return The 32-bit value read, or 0 if out-of-bounds.
  */
 std::uint32_t VM::load32(std::uint32_t address) {
-  if (oob_read(address, 4)) {
-    return 0;
-  }
-  return read_u32_le(&memory_image_[address]);
+  const std::uint8_t* bytes = read_range(address, 4);
+  return (bytes != nullptr) ? read_u32_le(bytes) : 0u;
 }
 
 /**
  * @brief Write a 32-bit value to absolute memory in little-endian order.
  *
- * Performs bounds checking and sets WRITE_OOB on failure.
+ * Performs bounds checking and sets WRITE_OOB on failure, including for
+ * read-only mappings.
  *
  * @param address  Absolute address inside the VM memory space.
  * @param value    The 32-bit value to write.
  * @return void
  */
 void VM::store32(std::uint32_t address, std::uint32_t value) {
-  if (oob_write(address, 4)) {
+  std::uint8_t* bytes = write_range(address, 4);
+  if (bytes == nullptr) {
     return;
   }
-  write_u32_le(&memory_image_[address], value);
+  write_u32_le(bytes, value);
+  note_code_write(address, 4);
 }
 
 /**
- * @brief Update comparison flags (EQ, GT, LT) based on rS signedness.
+ * @brief Record that guest memory overlapping the code region was written.
  *
- * If rS bit0 is set, values are compared as signed int32.
- * Otherwise, values are compared as unsigned.
+ * Invalidates the decoded instruction stream so that self-modifying code
+ * is re-decoded before it runs again, and drops the switch engine back to
+ * its checked path since the verifier's proof no longer holds.
  *
- * @param lhs  Left-hand value.
- * @param rhs  Right-hand value.
+ * @param address  Starting address of the write.
+ * @param count    Number of bytes written.
  * @return void
  */
-void VM::set_compare_flags(std::uint32_t lhs, std::uint32_t rhs) {
-  registers_[RF] &= ~static_cast<std::uint32_t>(F_EQ | F_GT | F_LT);
-  bool signed_mode = (registers_[RS] & 1u) != 0u;
-  if (signed_mode) {
-    std::int32_t a = static_cast<std::int32_t>(lhs);
-    std::int32_t b = static_cast<std::int32_t>(rhs);
-    if (a == b) {
-      registers_[RF] |= F_EQ;
-    } else if (a > b) {
-      registers_[RF] |= F_GT;
-    } else {
-      registers_[RF] |= F_LT;
-    }
-  } else {
-    if (lhs == rhs) {
-      registers_[RF] |= F_EQ;
-    } else if (lhs > rhs) {
-      registers_[RF] |= F_GT;
-    } else {
-      registers_[RF] |= F_LT;
-    }
+void VM::note_code_write(std::uint32_t address, std::size_t count) {
+  if (count > 0 && address < code_size_bytes_) {
+    decoded_valid_ = false;
+    code_verified_ = false;
   }
 }
 
 /**
- * @brief Print a single-step diagnostic line with registers and flags.
+ * @brief Record a single-step diagnostic line with registers and flags.
  *
  * Intended for tracing program execution after each instruction.
+ * Materializes pending condition flags so the recorded rF is exact. With a
+ * trace file attached the state goes into its ring buffer as a binary
+ * record; otherwise buffered guest output is flushed and the line is
+ * printed to stdout, so the two stay in program order.
  *
  * @param ip_before  The IP value before executing the current instruction.
  * @param opcode     The opcode that was executed.
  * @return void
  */
 void VM::dump_registers(std::uint32_t ip_before, Op opcode) {
-  std::uint32_t flags_value = registers_[RF];
+  materialize_flags();
+  if (trace_writer_ != nullptr) {
+    trace_writer_->record(ip_before, opcode, registers_);
+    return;
+  }
+  // Guest output of this instruction belongs ahead of its trace line.
+  output_.flush_all();
+  write_trace_line(std::cout, ip_before, opcode, registers_);
+}
 
-  std::cout << std::hex << std::uppercase << std::setfill('0');
-  std::cout << "IP:" << std::setw(8) << ip_before << " OP:" << std::setw(2) << static_cast<unsigned>(opcode) << " | ";
+/**
+ * @brief Convert a host call result to the value returned in r1.
+ *
+ * @param result  Non-negative result, or -1 for an error.
+ * @return @p result, or 0xFFFFFFFF for errors and values that do not fit.
+ */
+std::uint32_t VM::guest_result(std::int64_t result) {
+  return (result < 0 || result >= 0xFFFFFFFF) ? 0xFFFFFFFFu : static_cast<std::uint32_t>(result);
+}
 
-  for (int reg_index = R1; reg_index <= R8; reg_index += 1) {
-    std::cout << register_name(static_cast<std::uint8_t>(reg_index)) << ":" << std::setw(8) << registers_[reg_index] << " ";
+/**
+ * @brief Pick the guest address of a new SC_MMAP mapping.
+ *
+ * A @p requested address of 0 takes the first aligned address above the
+ * memory image and every existing mapping. Otherwise it must be aligned to
+ * MMAP_ALIGNMENT, lie above the memory image and not overlap a mapping.
+ *
+ * @param requested  Guest address asked for in r4, or 0.
+ * @param size       Mapping size in bytes.
+ * @return The address, or 0xFFFFFFFF if the mapping cannot be placed.
+ */
+std::uint32_t VM::mapping_address(std::uint32_t requested, std::size_t size) const {
+  auto align_up = [](std::uint64_t value) {
+    return (value + MMAP_ALIGNMENT - 1) / MMAP_ALIGNMENT * MMAP_ALIGNMENT;
+  };
+  std::uint64_t lowest = align_up(memory_image_.size());
+  std::uint64_t base = requested;
+  if (requested == 0u) {
+    base = lowest;
+    if (!mappings_.empty()) {
+      base = align_up(mappings_.back().base + static_cast<std::uint64_t>(mappings_.back().host.size()));
+    }
   }
+  std::uint64_t end = base + align_up(size);
+  if (base % MMAP_ALIGNMENT != 0u || base < lowest || end > 0xFFFFF000ull) {
+    return 0xFFFFFFFFu;
+  }
+  for (const GuestMapping& mapping : mappings_) {
+    std::uint64_t mapping_end = mapping.base + align_up(mapping.host.size());
+    if (base < mapping_end && mapping.base < end) {
+      return 0xFFFFFFFFu;
+    }
+  }
+  return static_cast<std::uint32_t>(base);
+}
 
-  std::cout << "IP:" << std::setw(8) << registers_[IP] << " ";
-  std::cout << "rF:" << std::setw(8) << registers_[RF] << " ";
-  std::cout << "rS:" << (registers_[RS] & 1u) << " ";
-
-  std::cout << "["
-            << ((flags_value & F_EQ) ? "EQ " : "")
-            << ((flags_value & F_GT) ? "GT " : "")
-            << ((flags_value & F_LT) ? "LT " : "")
-            << ((flags_value & F_TEST_TRUE) ? "TEST " : "")
-            << ((flags_value & F_BAD_INSTR) ? "BAD " : "")
-            << ((flags_value & F_IP_OOB) ? "IP_OOB " : "")
-            << ((flags_value & F_READ_OOB) ? "R_OOB " : "")
-            << ((flags_value & F_WRITE_OOB) ? "W_OOB " : "")
-            << "]\n";
+/**
+ * @brief Make @p host visible to the guest at @p base.
+ *
+ * @param base  Address from mapping_address().
+ * @param host  Mapping that backs it.
+ * @return void
+ */
+void VM::add_mapping(std::uint32_t base, HostMapping host) {
+  auto position = mappings_.begin();
+  while (position != mappings_.end() && position->base < base) {
+    ++position;
+  }
+  mappings_.insert(position, GuestMapping{base, std::move(host)});
+}
 
-  std::cout << std::dec << std::nouppercase;
+/**
+ * @brief Take the result of the current syscall from the replay log.
+ *
+ * Sets r1 to the recorded result. On divergence the VM stops with
+ * F_BAD_INSTR, since the guest no longer does what was recorded.
+ *
+ * @param syscall_id  Syscall being replayed.
+ * @param out_data    Recorded bytes for guest memory.
+ * @return true on success, false if the replay diverged.
+ */
+bool VM::replay_host_call(std::uint32_t syscall_id, std::vector<std::uint8_t>& out_data) {
+  std::uint32_t result = 0;
+  if (!syscall_log_->next(syscall_id, result, out_data)) {
+    fault(F_BAD_INSTR);
+    return false;
+  }
+  registers_[R1] = result;
+  return true;
 }
 
 /**
  * @brief Handle the SYSCALL instruction.
  *
  * Interprets syscall ID in r1 and parameters in r2+.
- * Sets return values in r1 when applicable.
+ * Sets return values in r1 when applicable. Pending condition flags are
+ * materialized first, so rF is exact across the host boundary.
  *
  * @return void
  */
 void VM::handle_syscall() {
+  materialize_flags();
   std::uint32_t syscall_id = registers_[R1];
+  bool replaying = syscall_log_ && syscall_log_->replaying();
 
   switch (syscall_id) {
     case SC_EXIT: {
+      output_.flush_all();
       is_running_ = false;
       break;
     }
@@ -226,20 +426,26 @@ void VM::handle_syscall() {
       std::uint32_t buffer_address = registers_[R3];
       std::uint32_t byte_count = registers_[R4];
 
-      if (oob_read(buffer_address, byte_count)) {
+      const std::uint8_t* buffer = read_range(buffer_address, byte_count);
+      if (buffer == nullptr) {
         break;
       }
 
-      std::string text(byte_count, '\0');
-      std::memcpy(text.data(), &memory_image_[buffer_address], byte_count);
+      if (replaying) {
+        std::vector<std::uint8_t> unused;
+        replay_host_call(SC_WRITE, unused);
+        break;
+      }
 
-      if (file_descriptor == 2) {
-        std::cerr << text << std::flush;
+      if (file_descriptor < FileTable::FIRST_FD) {
+        output_.write(file_descriptor, buffer, byte_count);
+        registers_[R1] = byte_count;
       } else {
-        std::cout << text << std::flush;
+        registers_[R1] = guest_result(files_.write(file_descriptor, buffer, byte_count));
+      }
+      if (syscall_log_) {
+        syscall_log_->record(SC_WRITE, registers_[R1], nullptr, 0);
       }
-
-      registers_[R1] = byte_count;
       break;
     }
     case SC_READ: {
@@ -247,59 +453,386 @@ void VM::handle_syscall() {
       std::uint32_t buffer_address = registers_[R3];
       std::uint32_t byte_count = registers_[R4];
 
-      if (oob_write(buffer_address, byte_count)) {
+      if (file_descriptor == 0 && !replaying) {
+        // A prompt written before the read must be visible while it blocks.
+        output_.flush_all();
+      }
+      if (file_descriptor == 0 && yield_on_blocking_ && !blocking_syscall_ready_ && !replaying
+          && !stdin_ready(byte_count, direct_io_)) {
+        // syscall is a single opcode byte; rewind so the next slice re-executes it.
+        registers_[IP] -= 1;
+        yield(RunStatus::BlockedOnSyscall);
         break;
       }
+      blocking_syscall_ready_ = false;
 
-      std::string input_text;
+      std::uint8_t* buffer = write_range(buffer_address, byte_count);
+      if (buffer == nullptr) {
+        break;
+      }
 
-      if (file_descriptor == 0) {
-        input_text.reserve(byte_count);
-        for (std::uint32_t i = 0; i < byte_count; i += 1) {
-          int ch = std::cin.get();
-          if (ch == EOF) {
-            break;
-          }
-          input_text.push_back(static_cast<char>(ch));
+      if (replaying) {
+        std::vector<std::uint8_t> input_bytes;
+        if (!replay_host_call(SC_READ, input_bytes)) {
+          break;
         }
+        if (input_bytes.size() > byte_count) {
+          fault(F_BAD_INSTR);
+          break;
+        }
+        std::memcpy(buffer, input_bytes.data(), input_bytes.size());
+        note_code_write(buffer_address, input_bytes.size());
+        break;
       }
 
-      std::memcpy(&memory_image_[buffer_address], input_text.data(), input_text.size());
-      registers_[R1] = static_cast<std::uint32_t>(input_text.size());
+      std::int64_t received = 0;
+      if (file_descriptor == 0) {
+        received = static_cast<std::int64_t>(read_stdin(buffer, byte_count, direct_io_));
+      } else if (file_descriptor >= FileTable::FIRST_FD) {
+        received = files_.read(file_descriptor, buffer, byte_count);
+      }
+      std::uint32_t received_bytes = (received > 0) ? static_cast<std::uint32_t>(received) : 0u;
+      note_code_write(buffer_address, received_bytes);
+      registers_[R1] = guest_result(received);
+      if (syscall_log_) {
+        syscall_log_->record(SC_READ, registers_[R1], buffer, received_bytes);
+      }
+      break;
+    }
+    case SC_FLUSH: {
+      output_.flush(registers_[R2]);
+      registers_[R1] = 0;
       break;
     }
     case SC_OPEN: {
-      registers_[R1] = 0xFFFFFFFFu;
+      std::uint32_t path_address = registers_[R2];
+      std::uint32_t flags = registers_[R3];
+
+      std::uint32_t memory_size = static_cast<std::uint32_t>(memory_image_.size());
+      std::uint32_t path_length = 0;
+      while (path_address < memory_size && path_length < memory_size - path_address
+             && memory_image_[path_address + path_length] != 0u) {
+        path_length += 1;
+      }
+      // Faults unless a NUL terminator was found inside guest memory.
+      const std::uint8_t* path_bytes = read_range(path_address, static_cast<std::size_t>(path_length) + 1);
+      if (path_bytes == nullptr) {
+        break;
+      }
+
+      if (replaying) {
+        std::vector<std::uint8_t> unused;
+        replay_host_call(SC_OPEN, unused);
+        break;
+      }
+      std::string path(reinterpret_cast<const char*>(path_bytes), path_length);
+      registers_[R1] = guest_result(files_.open(path, flags));
+      if (syscall_log_) {
+        syscall_log_->record(SC_OPEN, registers_[R1], nullptr, 0);
+      }
+      break;
+    }
+    case SC_CLOSE:
+    case SC_SEEK: {
+      if (replaying) {
+        std::vector<std::uint8_t> unused;
+        replay_host_call(syscall_id, unused);
+        break;
+      }
+      std::uint32_t file_descriptor = registers_[R2];
+      std::int64_t result = (syscall_id == SC_CLOSE)
+                          ? files_.close(file_descriptor)
+                          : files_.seek(file_descriptor,
+                                        static_cast<std::int32_t>(registers_[R3]),
+                                        registers_[R4]);
+      registers_[R1] = guest_result(result);
+      if (syscall_log_) {
+        syscall_log_->record(syscall_id, registers_[R1], nullptr, 0);
+      }
+      break;
+    }
+    case SC_MMAP: {
+      std::uint32_t file_descriptor = registers_[R2];
+      bool copy_on_write = (registers_[R3] & MMAP_COPY_ON_WRITE) != 0u;
+      bool snapshot = (registers_[R3] & MMAP_SNAPSHOT) != 0u;
+      std::uint32_t requested = registers_[R4];
+
+      if (replaying) {
+        // The log carries the file contents; map a private copy of them.
+        std::vector<std::uint8_t> contents;
+        if (!replay_host_call(SC_MMAP, contents) || registers_[R1] == 0xFFFFFFFFu) {
+          break;
+        }
+        HostMapping host = HostMapping::copy_of(contents.data(), contents.size(), copy_on_write);
+        if (host.empty() || mapping_address(registers_[R1], host.size()) != registers_[R1]) {
+          fault(F_BAD_INSTR);
+          break;
+        }
+        add_mapping(registers_[R1], std::move(host));
+        break;
+      }
+
+      // Recording snapshots the file, as a replay of the log can only map
+      // the logged contents and never sees the file change.
+      HostMapping host;
+      std::uint32_t base = 0xFFFFFFFFu;
+      if (files_.map(file_descriptor, copy_on_write, snapshot || syscall_log_ != nullptr, host) > 0) {
+        base = mapping_address(requested, host.size());
+      }
+      registers_[R1] = base;
+      if (syscall_log_) {
+        const std::uint8_t* contents = (base != 0xFFFFFFFFu) ? host.data() : nullptr;
+        syscall_log_->record(SC_MMAP, base, contents, (contents != nullptr) ? host.size() : 0u);
+      }
+      if (base != 0xFFFFFFFFu) {
+        add_mapping(base, std::move(host));
+      }
+      break;
+    }
+    case SC_WRITEV:
+    case SC_READV: {
+      handle_vectored_io(syscall_id, replaying);
       break;
     }
     default: {
-      registers_[RF] |= F_BAD_INSTR;
-      is_running_ = false;
+      fault(F_BAD_INSTR);
       break;
     }
   }
 }
 
+/**
+ * @brief Resolve a guest array of (address, length) pairs into io_segments_.
+ *
+ * Each pair is two little-endian u32 words. The array and every range are
+ * bounds-checked in this one pass, before any I/O happens, so a bad entry
+ * faults the syscall as a whole.
+ *
+ * @param array_address  Guest address of the first pair.
+ * @param count          Number of pairs, at most IOVEC_MAX.
+ * @param write          true if the ranges are going to be written (SC_READV).
+ * @param out_total      Sum of the lengths.
+ * @return true on success, false after a READ_OOB/WRITE_OOB fault.
+ */
+bool VM::gather_io_segments(std::uint32_t array_address,
+                            std::uint32_t count,
+                            bool write,
+                            std::size_t& out_total) {
+  io_segments_.clear();
+  out_total = 0;
+  const std::uint8_t* pairs = read_range(array_address, static_cast<std::size_t>(count) * 8u);
+  if (pairs == nullptr) {
+    return false;
+  }
+  for (std::uint32_t i = 0; i < count; ++i) {
+    std::uint32_t address = read_u32_le(pairs + 8u * i);
+    std::uint32_t length = read_u32_le(pairs + 8u * i + 4u);
+    std::uint8_t* bytes = write ? write_range(address, length)
+                                : const_cast<std::uint8_t*>(read_range(address, length));
+    if (bytes == nullptr) {
+      return false;
+    }
+    io_segments_.push_back(iovec{bytes, length});
+    out_total += length;
+  }
+  return true;
+}
+
+/**
+ * @brief Invalidate decoded code under the first @p byte_count bytes of io_segments_.
+ *
+ * @param byte_count  Bytes the host put into the segments, in order.
+ * @return void
+ */
+void VM::note_segment_writes(std::size_t byte_count) {
+  const std::uint8_t* image = memory_image_.data();
+  for (const iovec& segment : io_segments_) {
+    if (byte_count == 0u) {
+      break;
+    }
+    std::size_t landed = std::min(byte_count, segment.iov_len);
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(segment.iov_base);
+    if (bytes >= image && bytes < image + memory_image_.size()) {
+      note_code_write(static_cast<std::uint32_t>(bytes - image), landed);
+    }
+    byte_count -= landed;
+  }
+}
+
+/**
+ * @brief Handle SC_WRITEV and SC_READV.
+ *
+ * r2 = fd, r3 = address of the (address, length) array, r4 = number of
+ * pairs. The whole transfer is one host call: a buffered append or a
+ * writev(2) for output, one read of stdin or readv(2) for input. Returns
+ * the byte count in r1, or 0xFFFFFFFF for more than IOVEC_MAX pairs, a
+ * total that does not fit in r1 and host errors.
+ *
+ * @param syscall_id  SC_WRITEV or SC_READV.
+ * @param replaying   true if results come from the replay log.
+ * @return void
+ */
+void VM::handle_vectored_io(std::uint32_t syscall_id, bool replaying) {
+  std::uint32_t file_descriptor = registers_[R2];
+  std::uint32_t array_address = registers_[R3];
+  std::uint32_t count = registers_[R4];
+  bool reading = (syscall_id == SC_READV);
+
+  bool resumed_read = blocking_syscall_ready_;
+  blocking_syscall_ready_ = false;
+
+  std::size_t total = 0;
+  if (count > IOVEC_MAX) {
+    registers_[R1] = 0xFFFFFFFFu;
+    return;
+  }
+  if (!gather_io_segments(array_address, count, reading, total)) {
+    return;
+  }
+  if (total >= 0xFFFFFFFFu) {
+    registers_[R1] = 0xFFFFFFFFu;
+    return;
+  }
+
+  if (reading && file_descriptor == 0 && !replaying) {
+    output_.flush_all();
+    if (yield_on_blocking_ && !resumed_read && !stdin_ready(total, direct_io_)) {
+      registers_[IP] -= 1;
+      yield(RunStatus::BlockedOnSyscall);
+      return;
+    }
+  }
+
+  if (replaying) {
+    std::vector<std::uint8_t> input_bytes;
+    if (!replay_host_call(syscall_id, input_bytes) || !reading) {
+      return;
+    }
+    if (input_bytes.size() > total) {
+      fault(F_BAD_INSTR);
+      return;
+    }
+    std::size_t offset = 0;
+    for (const iovec& segment : io_segments_) {
+      std::size_t landed = std::min(input_bytes.size() - offset, segment.iov_len);
+      std::memcpy(segment.iov_base, input_bytes.data() + offset, landed);
+      offset += landed;
+    }
+    note_segment_writes(input_bytes.size());
+    return;
+  }
+
+  std::int64_t result = 0;
+  if (!reading && file_descriptor < FileTable::FIRST_FD) {
+    output_.write(file_descriptor, io_segments_.data(), io_segments_.size());
+    result = static_cast<std::int64_t>(total);
+  } else if (!reading) {
+    result = files_.writev(file_descriptor, io_segments_.data(), io_segments_.size());
+  } else if (file_descriptor == 0) {
+    result = static_cast<std::int64_t>(read_stdin(io_segments_.data(), io_segments_.size(), direct_io_));
+  } else if (file_descriptor >= FileTable::FIRST_FD) {
+    result = files_.readv(file_descriptor, io_segments_.data(), io_segments_.size());
+  }
+  registers_[R1] = guest_result(result);
+
+  std::size_t received = (reading && result > 0) ? static_cast<std::size_t>(result) : 0u;
+  note_segment_writes(received);
+  if (!syscall_log_) {
+    return;
+  }
+  std::vector<std::uint8_t> input_bytes;
+  for (const iovec& segment : io_segments_) {
+    std::size_t landed = std::min(received - input_bytes.size(), segment.iov_len);
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(segment.iov_base);
+    input_bytes.insert(input_bytes.end(), bytes, bytes + landed);
+  }
+  syscall_log_->record(syscall_id, registers_[R1], input_bytes.data(), input_bytes.size());
+}
+
 /**
  * @brief Execute a single instruction at IP and update machine state.
  *
  * Handles fetch/decode/execute for the implemented instruction set.
  * On error or OOB conditions, sets flags and transitions VM to a stopped state.
+ * Checks the tracing flag on every call, so the engines only use it on
+ * their slow paths and call step_impl() directly in hot loops.
  *
  * @return void
  */
 void VM::step() {
+  if (tracing_enabled_) {
+    step_impl<true, true>();
+  } else {
+    step_impl<true, false>();
+  }
+}
+
+/**
+ * @brief Fetch, decode and execute one instruction.
+ *
+ * CHECKED = false is the verified fast path: the caller guarantees IP sits on
+ * an instruction boundary of verified code, so code fetches and register
+ * indices are not re-checked. Instructions that can move IP somewhere the
+ * verifier has not proven (register-indirect jumps, IP destinations) set
+ * ip_check_pending_ so run() checks the new IP before the next fast step.
+ *
+ * TRACE is the tracing policy: the untraced instantiation contains no trace
+ * code at all. PROBES likewise adds the execution counters of stats_, the
+ * block coverage of coverage_ and the data accesses fed to cache_sim_.
+ *
+ * @return void
+ */
+template <bool CHECKED, bool TRACE, bool PROBES>
+void VM::step_impl() {
   if (registers_[IP] >= code_size_bytes_) {
-    registers_[RF] |= F_IP_OOB;
-    is_running_ = false;
+    fault(F_IP_OOB);
     return;
   }
 
   std::uint32_t ip_before = registers_[IP];
-  Op opcode = static_cast<Op>(fetch8());
+  [[maybe_unused]] bool block_end = false;
+  Op opcode = static_cast<Op>(fetch8<CHECKED>());
 
   auto read_mode = [&]() -> std::uint8_t {
-    return fetch8();
+    std::uint8_t mode = fetch8<CHECKED>();
+    if constexpr (PROBES) {
+      if (stats_) {
+        stats_->count(ExecStats::MODE_SLOTS + mode);
+      }
+    }
+    return mode;
+  };
+
+  auto load = [&](std::uint32_t address) -> std::uint32_t {
+    if constexpr (PROBES) {
+      if (stats_) {
+        stats_->count(ExecStats::LOAD_SLOT);
+      }
+      if (cache_sim_) {
+        cache_sim_->access(address, 4, false);
+      }
+    }
+    return load32(address);
+  };
+
+  auto store = [&](std::uint32_t address, std::uint32_t value) {
+    if constexpr (PROBES) {
+      if (stats_) {
+        stats_->count(ExecStats::STORE_SLOT);
+      }
+      if (cache_sim_) {
+        cache_sim_->access(address, 4, true);
+      }
+    }
+    store32(address, value);
+  };
+
+  auto read_register_index = [&]() -> std::uint8_t {
+    std::uint8_t reg = fetch8<CHECKED>();
+    if (reg == RF) {
+      materialize_flags();
+    }
+    return reg;
   };
 
   auto dst_type_of = [](std::uint8_t mode) -> std::uint8_t {
@@ -321,32 +854,29 @@ void VM::step() {
       std::uint8_t src_type = src_type_of(mode_byte);
 
       if (dst_type == OT_REG) {
-        std::uint8_t dst_reg = fetch8();
-        if (dst_reg >= REG_COUNT) {
-          registers_[RF] |= F_BAD_INSTR;
-          is_running_ = false;
+        std::uint8_t dst_reg = read_register_index();
+        if (CHECKED && dst_reg >= REG_COUNT) {
+          fault(F_BAD_INSTR);
           break;
         }
         std::uint32_t value = 0;
         if (src_type == OT_REG) {
-          std::uint8_t src_reg = fetch8();
-          if (src_reg >= REG_COUNT) {
-            registers_[RF] |= F_BAD_INSTR;
-            is_running_ = false;
+          std::uint8_t src_reg = read_register_index();
+          if (CHECKED && src_reg >= REG_COUNT) {
+            fault(F_BAD_INSTR);
             break;
           }
           value = registers_[src_reg];
         } else if (src_type == OT_IMM) {
-          value = fetch32();
+          value = fetch32<CHECKED>();
         } else if (src_type == OT_MEM) {
-          std::uint32_t addr = fetch32();
-          value = load32(addr);
+          std::uint32_t addr = fetch32<CHECKED>();
+          value = load(addr);
           if (!is_running_) {
             break;
           }
         } else {
-          registers_[RF] |= F_BAD_INSTR;
-          is_running_ = false;
+          fault(F_BAD_INSTR);
           break;
         }
 
@@ -355,28 +885,32 @@ void VM::step() {
         } else {
           registers_[dst_reg] = value;
         }
+        if (dst_reg == IP) {
+          if (!CHECKED) {
+            ip_check_pending_ = true;
+          }
+          charge_branch(ip_before, registers_[IP]);
+          block_end = true;
+        }
       } else if (dst_type == OT_MEM) {
-        std::uint32_t addr = fetch32();
+        std::uint32_t addr = fetch32<CHECKED>();
         std::uint32_t value = 0;
         if (src_type == OT_REG) {
-          std::uint8_t src_reg = fetch8();
-          if (src_reg >= REG_COUNT) {
-            registers_[RF] |= F_BAD_INSTR;
-            is_running_ = false;
+          std::uint8_t src_reg = read_register_index();
+          if (CHECKED && src_reg >= REG_COUNT) {
+            fault(F_BAD_INSTR);
             break;
           }
           value = registers_[src_reg];
         } else if (src_type == OT_IMM) {
-          value = fetch32();
+          value = fetch32<CHECKED>();
         } else {
-          registers_[RF] |= F_BAD_INSTR;
-          is_running_ = false;
+          fault(F_BAD_INSTR);
           break;
         }
-        store32(addr, value);
+        store(addr, value);
       } else {
-        registers_[RF] |= F_BAD_INSTR;
-        is_running_ = false;
+        fault(F_BAD_INSTR);
       }
       break;
     }
@@ -389,38 +923,34 @@ void VM::step() {
       std::uint8_t src_type = src_type_of(mode_byte);
 
       if (dst_type != OT_REG) {
-        registers_[RF] |= F_BAD_INSTR;
-        is_running_ = false;
+        fault(F_BAD_INSTR);
         break;
       }
 
-      std::uint8_t dst_reg = fetch8();
-      if (dst_reg >= REG_COUNT) {
-        registers_[RF] |= F_BAD_INSTR;
-        is_running_ = false;
+      std::uint8_t dst_reg = read_register_index();
+      if (CHECKED && dst_reg >= REG_COUNT) {
+        fault(F_BAD_INSTR);
         break;
       }
 
       std::uint32_t rhs = 0;
       if (src_type == OT_REG) {
-        std::uint8_t src_reg = fetch8();
-        if (src_reg >= REG_COUNT) {
-          registers_[RF] |= F_BAD_INSTR;
-          is_running_ = false;
+        std::uint8_t src_reg = read_register_index();
+        if (CHECKED && src_reg >= REG_COUNT) {
+          fault(F_BAD_INSTR);
           break;
         }
         rhs = registers_[src_reg];
       } else if (src_type == OT_IMM) {
-        rhs = fetch32();
+        rhs = fetch32<CHECKED>();
       } else if (src_type == OT_MEM) {
-        std::uint32_t addr = fetch32();
-        rhs = load32(addr);
+        std::uint32_t addr = fetch32<CHECKED>();
+        rhs = load(addr);
         if (!is_running_) {
           break;
         }
       } else {
-        registers_[RF] |= F_BAD_INSTR;
-        is_running_ = false;
+        fault(F_BAD_INSTR);
         break;
       }
 
@@ -431,6 +961,13 @@ void VM::step() {
       } else {
         registers_[dst_reg] = registers_[dst_reg] ^ rhs;
       }
+      if (dst_reg == IP) {
+        if (!CHECKED) {
+          ip_check_pending_ = true;
+        }
+        charge_branch(ip_before, registers_[IP]);
+        block_end = true;
+      }
       break;
     }
 
@@ -440,15 +977,13 @@ void VM::step() {
       std::uint8_t src_type = src_type_of(mode_byte);
 
       if (dst_type != OT_REG) {
-        registers_[RF] |= F_BAD_INSTR;
-        is_running_ = false;
+        fault(F_BAD_INSTR);
         break;
       }
 
-      std::uint8_t lhs_reg = fetch8();
-      if (lhs_reg >= REG_COUNT) {
-        registers_[RF] |= F_BAD_INSTR;
-        is_running_ = false;
+      std::uint8_t lhs_reg = read_register_index();
+      if (CHECKED && lhs_reg >= REG_COUNT) {
+        fault(F_BAD_INSTR);
         break;
       }
 
@@ -456,28 +991,26 @@ void VM::step() {
       std::uint32_t rhs = 0;
 
       if (src_type == OT_REG) {
-        std::uint8_t src_reg = fetch8();
-        if (src_reg >= REG_COUNT) {
-          registers_[RF] |= F_BAD_INSTR;
-          is_running_ = false;
+        std::uint8_t src_reg = read_register_index();
+        if (CHECKED && src_reg >= REG_COUNT) {
+          fault(F_BAD_INSTR);
           break;
         }
         rhs = registers_[src_reg];
       } else if (src_type == OT_IMM) {
-        rhs = fetch32();
+        rhs = fetch32<CHECKED>();
       } else if (src_type == OT_MEM) {
-        std::uint32_t addr = fetch32();
-        rhs = load32(addr);
+        std::uint32_t addr = fetch32<CHECKED>();
+        rhs = load(addr);
         if (!is_running_) {
           break;
         }
       } else {
-        registers_[RF] |= F_BAD_INSTR;
-        is_running_ = false;
+        fault(F_BAD_INSTR);
         break;
       }
 
-      set_compare_flags(lhs, rhs);
+      record_compare(lhs, rhs);
       break;
     }
 
@@ -491,37 +1024,46 @@ void VM::step() {
 
       std::uint32_t target = 0;
       if (src_type == OT_IMM) {
-        target = fetch32();
+        target = fetch32<CHECKED>();
       } else if (src_type == OT_REG) {
-        std::uint8_t r = fetch8();
-        if (r >= REG_COUNT) {
-          registers_[RF] |= F_BAD_INSTR;
-          is_running_ = false;
+        std::uint8_t r = read_register_index();
+        if (CHECKED && r >= REG_COUNT) {
+          fault(F_BAD_INSTR);
           break;
         }
         target = registers_[r];
       } else {
-        registers_[RF] |= F_BAD_INSTR;
-        is_running_ = false;
+        fault(F_BAD_INSTR);
         break;
       }
 
+      std::uint32_t flags = current_flags();
       bool take = false;
       if (opcode == OP_JMP) {
         take = true;
       } else if (opcode == OP_JEQ) {
-        take = (registers_[RF] & F_EQ) != 0u;
+        take = (flags & F_EQ) != 0u;
       } else if (opcode == OP_JNEQ) {
-        take = (registers_[RF] & F_EQ) == 0u;
+        take = (flags & F_EQ) == 0u;
       } else if (opcode == OP_JLA) {
-        take = (registers_[RF] & F_GT) != 0u;
+        take = (flags & F_GT) != 0u;
       } else if (opcode == OP_JLE) {
-        take = (registers_[RF] & (F_LT | F_EQ)) != 0u;
+        take = (flags & (F_LT | F_EQ)) != 0u;
       }
+      if constexpr (PROBES) {
+        if (stats_) {
+          stats_->count_branch(ip_before, take);
+        }
+      }
+      block_end = true;
 
       if (take) {
         registers_[RF] |= F_TEST_TRUE;
         registers_[IP] = target;
+        if (!CHECKED && src_type == OT_REG) {
+          ip_check_pending_ = true;
+        }
+        charge_branch(ip_before, target);
       } else {
         registers_[RF] &= ~static_cast<std::uint32_t>(F_TEST_TRUE);
       }
@@ -529,42 +1071,396 @@ void VM::step() {
     }
 
     case OP_SYSCALL: {
+      std::uint32_t syscall_id = registers_[R1];
       handle_syscall();
+      if constexpr (PROBES) {
+        if (stats_ && (!yielded_ || yield_status_ != RunStatus::BlockedOnSyscall)) {
+          stats_->count_syscall(syscall_id);
+        }
+      }
       break;
     }
 
     default: {
-      registers_[RF] |= F_BAD_INSTR;
-      is_running_ = false;
+      fault(F_BAD_INSTR);
       break;
     }
   }
 
-  if (tracing_enabled_) {
+  if constexpr (PROBES) {
+    // A read that stopped in front of stdin runs again in the next slice; count it there.
+    if (stats_ && (!yielded_ || yield_status_ != RunStatus::BlockedOnSyscall)) {
+      stats_->count(ExecStats::INSTRUCTION_SLOT);
+      stats_->count(ExecStats::OPCODE_SLOTS + opcode);
+    }
+    // Faults end the run; a budget yield still enters the next block.
+    if (coverage_ && block_end && (is_running_ || yielded_)) {
+      coverage_->enter_block(registers_[IP]);
+    }
+  }
+  if constexpr (TRACE) {
     dump_registers(ip_before, opcode);
   }
 }
 
+template void VM::step_impl<true, false>();
+template void VM::step_impl<true, true>();
+
 /**
  * @brief Run the VM until it halts or an error condition occurs.
  *
- * Repeatedly calls step() while the VM is in a running state.
+ * Resumes a VM that a run_for() slice left stopped.
  *
  * @return void
  */
 void VM::run() {
+  run_slice(std::numeric_limits<std::int64_t>::max(), false);
+}
+
+/**
+ * @brief Run for roughly @p max_instructions instructions, then return control to the host.
+ *
+ * The switch engine and tier 0 of the tiered engine size straight-line runs
+ * with the decoded index map, so it is built here even though they do not
+ * dispatch over it.
+ *
+ * @param max_instructions  Instruction budget of this slice.
+ * @return Why the slice ended.
+ */
+RunStatus VM::run_for(std::uint64_t max_instructions) {
+  if (engine_ == Engine::Switch || engine_ == Engine::Tiered || probing()) {
+    ensure_decoded();
+  }
+  std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+  return run_slice(static_cast<std::int64_t>(std::min(max_instructions, limit)), true);
+}
+
+/**
+ * @brief Stop the VM so that the next run()/run_for() resumes it.
+ *
+ * @param status  Reported by run_for() for this stop.
+ * @return void
+ */
+void VM::yield(RunStatus status) {
+  yield_status_ = status;
+  yielded_ = true;
+  is_running_ = false;
+}
+
+/**
+ * @brief Run the selected engine with an instruction budget.
+ *
+ * A VM stopped by yield() is restarted first; when the stop was in front of
+ * a read from stdin, that read is allowed through this time.
+ *
+ * @param budget             Instructions to run before yielding.
+ * @param yield_on_blocking  Stop in front of reads from stdin.
+ * @return Why the slice ended.
+ */
+RunStatus VM::run_slice(std::int64_t budget, bool yield_on_blocking) {
+  if (yielded_) {
+    blocking_syscall_ready_ = (yield_status_ == RunStatus::BlockedOnSyscall);
+    yielded_ = false;
+    is_running_ = true;
+  }
+  budget_ = budget;
+  yield_on_blocking_ = yield_on_blocking;
+  block_entry_ip_ = registers_[IP];
+  if (is_running_ && budget_ <= 0) {
+    yield(RunStatus::BudgetExhausted);
+  }
+
+  if (tracing_enabled_) {
+    run_engine<true>();
+  } else {
+    run_engine<false>();
+  }
+  output_.flush_all();
+
+  if (yielded_) {
+    return yield_status_;
+  }
+  return faulted_ ? RunStatus::Faulted : RunStatus::Halted;
+}
+
+/**
+ * @brief Run the selected engine under a tracing policy.
+ *
+ * Tracing is decided once per run()/run_for() instead of once per
+ * instruction: every engine loop is instantiated with and without trace
+ * code. The cached and JIT engines need the VM state after every
+ * instruction to trace, so a traced run uses the predecoded loop for them.
+ * Statistics, coverage and cache simulation need operand modes, memory
+ * accesses and every branch outcome, which only the byte interpreter sees,
+ * so any engine runs the probed switch loop while one of them is enabled.
+ *
+ * @return void
+ */
+template <bool TRACE>
+void VM::run_engine() {
+  if (probing()) {
+    run_switch<TRACE, true>();
+  } else if (engine_ == Engine::Predecoded) {
+    run_predecoded<TRACE>();
+  } else if (engine_ == Engine::Threaded) {
+    run_threaded<TRACE>();
+  } else if (engine_ == Engine::Cached || engine_ == Engine::Jit) {
+    if constexpr (TRACE) {
+      run_predecoded<TRACE>();
+    } else if (engine_ == Engine::Cached) {
+      run_cached();
+    } else {
+      run_jit();
+    }
+  } else if (engine_ == Engine::Tiered) {
+    run_tiered<TRACE>();
+  } else {
+    run_switch<TRACE>();
+  }
+}
+
+/**
+ * @brief Run the byte-at-a-time switch engine.
+ *
+ * Repeatedly calls step() while the VM is in a running state. On verified
+ * code the switch engine takes the unchecked step whenever IP is known to
+ * sit on an instruction boundary; after a jump or write it cannot prove,
+ * IP is looked up in the boundary map once, and steps from a non-boundary
+ * IP (or past the end of code) run fully checked.
+ *
+ * @return void
+ */
+template <bool TRACE, bool PROBES>
+void VM::run_switch() {
+  ip_check_pending_ = true;
+  while (is_running_) {
+    if (code_verified_) {
+      std::uint32_t ip = registers_[IP];
+      ip_check_pending_ = (ip >= code_boundaries_.size()) || (code_boundaries_[ip] == 0);
+    }
+    if (!code_verified_ || ip_check_pending_) {
+      step_impl<true, TRACE, PROBES>();
+      continue;
+    }
+    do {
+      step_impl<false, TRACE, PROBES>();
+    } while (is_running_ && code_verified_ && !ip_check_pending_);
+  }
+}
+
+/**
+ * @brief Decode the code section into decoded_ if it is missing or stale.
+ *
+ * Binds every record to its (opcode, mode)-specialized handler; records that
+ * did not decode are bound to exec_step. Native blocks translated from the
+ * previous stream are dropped.
+ *
+ * @return void
+ */
+void VM::ensure_decoded() {
+  if (decoded_valid_) {
+    return;
+  }
+  std::uint32_t decodable = static_cast<std::uint32_t>(
+      std::min<std::size_t>(code_size_bytes_, memory_image_.size()));
+  decoded_ = decode_program(memory_image_.data(), decodable);
+  for (DecodedInstr& instr : decoded_.instrs) {
+    bool runnable = (instr.flags & DF_DECODED) != 0u;
+    instr.handler = runnable ? handler_for(instr.op, instr.mode) : &VM::exec_step;
+  }
+  if (!tracing_enabled_) {
+    fuse_superinstructions();
+  }
+  decoded_valid_ = true;
+  decoded_threaded_ = false;
+  jit_.clear();
+}
+
+/**
+ * @brief Look up the specialized handler for an (opcode, mode) pair.
+ *
+ * The table is generated at compile time with one slot per opcode byte and
+ * mode byte; invalid forms map to exec_step.
+ *
+ * @param op_byte  Raw opcode byte.
+ * @param mode     Raw mode byte.
+ * @return Handler to bind to a record of that form.
+ */
+ExecHandler VM::handler_for(std::uint8_t op_byte, std::uint8_t mode) {
+  static constexpr std::size_t table_rows = static_cast<std::size_t>(OP_SYSCALL) + 1;
+  static constexpr auto table = []<std::size_t... SLOTS>(std::index_sequence<SLOTS...>) {
+    return std::array<ExecHandler, sizeof...(SLOTS)>{
+      {select_handler<static_cast<std::uint8_t>(SLOTS / 256), static_cast<std::uint8_t>(SLOTS % 256)>()...}
+    };
+  }(std::make_index_sequence<table_rows * 256>{});
+
+  if (op_byte >= table_rows) {
+    return &VM::exec_step;
+  }
+  return table[static_cast<std::size_t>(op_byte) * 256 + mode];
+}
+
+/**
+ * @brief Replace the handlers of hot adjacent instruction sequences with superinstructions.
+ *
+ * Recognized sequences (all operands register or immediate, branch targets immediate):
+ *   cmp + jeq/jneq/jla/jle
+ *   add/sub + cmp + jeq/jneq/jla/jle   (loop tails)
+ *   mov reg, imm + syscall
+ *
+ * Only the head record changes; the others keep their own handlers so jumps
+ * into the middle of a sequence still work. Skipped while tracing, since
+ * the trace needs one line per instruction.
+ *
+ * @return void
+ */
+void VM::fuse_superinstructions() {
+  auto is_form = [](const DecodedInstr& instr, Op op) {
+    return (instr.flags & DF_DECODED) != 0u && instr.op == op
+        && (instr.mode == 0x11 || instr.mode == 0x12);
+  };
+  auto is_cond_branch = [](const DecodedInstr& instr) {
+    return (instr.flags & DF_DECODED) != 0u && instr.src_type == OT_IMM
+        && (instr.op == OP_JEQ || instr.op == OP_JNEQ || instr.op == OP_JLA || instr.op == OP_JLE);
+  };
+  auto with_mode = [](std::uint8_t mode, auto&& make) {
+    return (mode == 0x11) ? make(std::integral_constant<std::uint8_t, 0x11>{})
+                          : make(std::integral_constant<std::uint8_t, 0x12>{});
+  };
+
+  std::vector<DecodedInstr>& instrs = decoded_.instrs;
+  for (std::size_t i = 0; i + 1 < instrs.size(); i += 1) {
+    DecodedInstr& head = instrs[i];
+    ExecHandler fused = nullptr;
+
+    if (i + 2 < instrs.size()
+        && (is_form(head, OP_ADD) || is_form(head, OP_SUB))
+        && is_form(instrs[i + 1], OP_CMP) && is_cond_branch(instrs[i + 2])) {
+      Op branch_op = instrs[i + 2].op;
+      fused = with_mode(head.mode, [&](auto alu_mode) {
+        return with_mode(instrs[i + 1].mode, [&](auto cmp_mode) {
+          constexpr std::uint8_t am = decltype(alu_mode)::value;
+          constexpr std::uint8_t cm = decltype(cmp_mode)::value;
+          return (head.op == OP_ADD)
+              ? fuse_with_branch<&VM::exec<OP_ADD, am>, &VM::exec<OP_CMP, cm>>(branch_op)
+              : fuse_with_branch<&VM::exec<OP_SUB, am>, &VM::exec<OP_CMP, cm>>(branch_op);
+        });
+      });
+    } else if (is_form(head, OP_CMP) && is_cond_branch(instrs[i + 1])) {
+      Op branch_op = instrs[i + 1].op;
+      fused = with_mode(head.mode, [&](auto cmp_mode) {
+        constexpr std::uint8_t cm = decltype(cmp_mode)::value;
+        return fuse_with_branch<&VM::exec<OP_CMP, cm>>(branch_op);
+      });
+    } else if ((head.flags & DF_DECODED) != 0u && head.op == OP_MOV && head.mode == 0x12
+               && (instrs[i + 1].flags & DF_DECODED) != 0u && instrs[i + 1].op == OP_SYSCALL) {
+      fused = &VM::exec_fused<&VM::exec<OP_MOV, 0x12>, &VM::exec<OP_SYSCALL, 0x00>>;
+    }
+
+    if (fused != nullptr) {
+      head.handler = fused;
+      head.flags |= DF_FUSED;
+    }
+  }
+}
+
+/**
+ * @brief Fallback handler: execute the record's instruction through step().
+ *
+ * @param vm     VM to execute on.
+ * @param instr  Record at the current IP (unused; step() re-fetches).
+ * @return nullptr, so the caller resyncs from IP.
+ */
+const DecodedInstr* VM::exec_step(VM& vm, const DecodedInstr& instr) {
+  (void)instr;
+  vm.step();
+  return nullptr;
+}
+
+/**
+ * @brief Run the VM by dispatching over the decoded instruction stream.
+ *
+ * Each record is executed by its bound handler, which returns the next
+ * record directly. When a handler returns nullptr (VM stopped, stream
+ * invalidated by a write into the code region, or a jump to an IP that is
+ * not a decoded boundary) the loop resyncs from IP.
+ *
+ * @return void
+ */
+template <bool TRACE>
+void VM::run_predecoded() {
+  while (is_running_) {
+    ensure_decoded();
+    const DecodedInstr* instr = decoded_at(registers_[IP]);
+    if (instr == nullptr) {
+      step_impl<true, TRACE>();
+      continue;
+    }
+
+    while (instr != nullptr) {
+      const DecodedInstr* next = instr->handler(*this, *instr);
+      if constexpr (TRACE) {
+        if ((instr->flags & DF_DECODED) != 0u) {
+          dump_registers(instr->ip, instr->op);
+        }
+      }
+      instr = next;
+    }
+  }
+}
+
+template void VM::run_predecoded<false>();
+template void VM::run_predecoded<true>();
+
+/**
+ * @brief Run the VM on natively translated basic blocks.
+ *
+ * Looks up (or translates) the block at IP and calls it; when the instruction
+ * at IP cannot be translated it is executed by its decoded handler, which
+ * covers syscalls and every fault path. Native code reads and writes rF
+ * directly, so pending condition flags are materialized before each block.
+ * Blocks charge the instruction budget themselves. Only used untraced; see
+ * run_engine().
+ *
+ * @return void
+ */
+void VM::run_jit() {
   while (is_running_) {
-    step();
+    ensure_decoded();
+    std::uint32_t ip = registers_[IP];
+    JitBlockFn block = jit_.block_at(decoded_, ip, memory_image_.size(), code_size_bytes_);
+    if (block != nullptr) {
+      materialize_flags();
+      block(registers_, memory_image_.data(), &budget_);
+      block_entry_ip_ = registers_[IP];
+      if (budget_ <= 0) {
+        yield(RunStatus::BudgetExhausted);
+      }
+      continue;
+    }
+
+    const DecodedInstr* instr = decoded_at(ip);
+    if (instr == nullptr) {
+      step();
+      continue;
+    }
+    instr->handler(*this, *instr);
   }
 }
 
 /**
  * @brief Read the value of a CPU register.
  *
+ * rF is computed from the pending compare when its condition bits have not
+ * been materialized yet, so the result is always exact.
+ *
  * @param reg  Register enum to read.
  * @return 32-bit value of the requested register.
  */
 std::uint32_t VM::get_register(Register reg) const {
+  if (reg == RF) {
+    return current_flags();
+  }
   return registers_[static_cast<std::uint8_t>(reg)];
 }
 
@@ -572,6 +1468,7 @@ std::uint32_t VM::get_register(Register reg) const {
  * @brief Write the value of a CPU register.
  *
  * Safe for tests; production code usually manipulates registers via instructions.
+ * Writing rF discards any pending compare.
  *
  * @param reg    Register enum to write.
  * @param value  32-bit value to store into the register.
@@ -579,17 +1476,227 @@ std::uint32_t VM::get_register(Register reg) const {
  */
 void VM::set_register(Register reg, std::uint32_t value) {
   registers_[static_cast<std::uint8_t>(reg)] = value;
+  if (reg == IP) {
+    ip_check_pending_ = true;
+  }
+  if (reg == RF) {
+    flags_pending_ = false;
+  }
 }
 
 /**
  * @brief Enable or disable per-instruction tracing to stdout.
  *
+ * Tracing is a compile-time policy of the engine loops (see run_engine()),
+ * so the untraced loops carry no trace checks. Toggling it rebuilds the
+ * decoded stream, since superinstructions and threaded labels are bound for
+ * one policy.
+ *
  * @param enabled  true to print trace, false to suppress.
  * @return void
  */
 void VM::set_tracing(bool enabled) {
+  if (enabled != tracing_enabled_) {
+    decoded_valid_ = false;
+  }
   tracing_enabled_ = enabled;
 }
 
+/**
+ * @brief Enable or disable execution statistics.
+ *
+ * @param enabled  true to collect statistics (from zero), false to drop them.
+ * @return void
+ */
+void VM::set_stats(bool enabled) {
+  if (enabled) {
+    stats_ = std::make_unique<ExecStats>(code_size_bytes_);
+  } else {
+    stats_.reset();
+  }
+}
+
+/**
+ * @brief Counters collected since set_stats(true).
+ *
+ * @return The counters, or nullptr if statistics are disabled.
+ */
+const ExecStats* VM::stats() const {
+  return stats_.get();
+}
+
+/**
+ * @brief Enable or disable block and edge coverage.
+ *
+ * Enabling starts from empty coverage, with the current IP as the first
+ * block entry.
+ *
+ * @param enabled  true to record coverage, false to drop it.
+ * @return void
+ */
+void VM::set_coverage(bool enabled) {
+  if (enabled) {
+    coverage_ = std::make_unique<Coverage>(code_size_bytes_);
+    coverage_->enter_block(registers_[IP]);
+  } else {
+    coverage_.reset();
+  }
+}
+
+/**
+ * @brief Coverage recorded since set_coverage(true).
+ *
+ * @return The coverage, or nullptr if coverage is disabled.
+ */
+const Coverage* VM::coverage() const {
+  return coverage_.get();
+}
+
+/**
+ * @brief Stream guest data accesses through a simulated cache hierarchy.
+ *
+ * @param levels  Level geometries, L1 first; empty disables the simulation.
+ * @return void
+ */
+void VM::set_cache_simulation(const std::vector<CacheLevelConfig>& levels) {
+  if (levels.empty()) {
+    cache_sim_.reset();
+  } else {
+    cache_sim_ = std::make_unique<CacheSimulator>(levels);
+  }
+}
+
+/**
+ * @brief Cache simulation since set_cache_simulation().
+ *
+ * @return The simulator, or nullptr if disabled.
+ */
+const CacheSimulator* VM::cache_simulation() const {
+  return cache_sim_.get();
+}
+
+/**
+ * @brief Use write(2)/read(2) on the host's fds 0-2 instead of the iostreams.
+ *
+ * @param enabled  true for write(2)/read(2).
+ * @return void
+ */
+void VM::set_direct_io(bool enabled) {
+  output_.set_direct(enabled);
+  direct_io_ = enabled;
+}
+
+/**
+ * @brief Let SC_OPEN open files below a host directory.
+ *
+ * @param directory      Sandbox root.
+ * @param error_message  Set on failure.
+ * @return true on success, false if @p directory is not a directory.
+ */
+bool VM::set_file_root(const std::string& directory, std::string& error_message) {
+  return files_.set_root(directory, error_message);
+}
+
+/**
+ * @brief Record the host side of every syscall into a log file.
+ *
+ * @param path           Output log file (see SyscallLog).
+ * @param error_message  Set on failure.
+ * @return true on success, false if the file cannot be created.
+ */
+bool VM::set_syscall_record(const std::string& path, std::string& error_message) {
+  auto log = std::make_unique<SyscallLog>();
+  if (!log->open_record(path, error_message)) {
+    return false;
+  }
+  syscall_log_ = std::move(log);
+  return true;
+}
+
+/**
+ * @brief Replay syscall results from a recorded log instead of doing I/O.
+ *
+ * @param path           Log written by set_syscall_record().
+ * @param error_message  Set on failure.
+ * @return true on success, false if the log cannot be loaded.
+ */
+bool VM::set_syscall_replay(const std::string& path, std::string& error_message) {
+  auto log = std::make_unique<SyscallLog>();
+  if (!log->open_replay(path, error_message)) {
+    return false;
+  }
+  syscall_log_ = std::move(log);
+  return true;
+}
+
+/**
+ * @brief Log set by set_syscall_record() or set_syscall_replay().
+ *
+ * @return The log, or nullptr if syscalls use real I/O unrecorded.
+ */
+const SyscallLog* VM::syscall_log() const {
+  return syscall_log_.get();
+}
+
+/**
+ * @brief Trace to a binary file instead of printing to stdout.
+ *
+ * @param path           Output trace file.
+ * @param error_message  Set on failure.
+ * @return true on success, false if the file cannot be created.
+ */
+bool VM::set_trace_file(const std::string& path, std::string& error_message) {
+  auto writer = std::make_unique<TraceWriter>();
+  if (!writer->open(path, error_message)) {
+    return false;
+  }
+  trace_writer_ = std::move(writer);
+  set_tracing(true);
+  return true;
+}
+
+/**
+ * @brief Finish the trace file set by set_trace_file().
+ *
+ * @param error_message  Set on failure.
+ * @return true if the whole trace was written, false after a write error.
+ */
+bool VM::close_trace_file(std::string& error_message) {
+  if (trace_writer_ == nullptr) {
+    return true;
+  }
+  bool ok = trace_writer_->close(error_message);
+  trace_writer_.reset();
+  set_tracing(false);
+  return ok;
+}
+
+/**
+ * @brief Verify the code section and enable the unchecked switch-engine path.
+ *
+ * @param error_message  Set to the first problem found on failure.
+ * @return true if the code section verified, false otherwise.
+ */
+bool VM::verify(std::string& error_message) {
+  code_verified_ = false;
+  if (code_size_bytes_ > memory_image_.size()) {
+    error_message = "code section extends past the memory image";
+    return false;
+  }
+  code_verified_ = verify_code(memory_image_.data(), code_size_bytes_, code_boundaries_, error_message);
+  ip_check_pending_ = true;
+  return code_verified_;
+}
+
+/**
+ * @brief Select the execution engine used by run().
+ *
+ * @param engine  Engine to use.
+ * @return void
+ */
+void VM::set_engine(Engine engine) {
+  engine_ = engine;
+}
+
 }  // namespace bc
 
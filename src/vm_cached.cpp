@@ -0,0 +1,198 @@
+//  vm_cached.cpp:
+//    Decoded-record interpreter that keeps guest state in locals.
+//
+
+#include "bytecraft/vm.hpp"
+#include "bytecraft/util.hpp"
+#include "vm_exec.hpp"
+#include <cstring>
+
+// Forms the cached loop executes inline: X(opcode, dst type, src type).
+// Syscalls and everything else leave the loop through step().
+#define BC_CACHED_FORMS(X)            \
+  X(OP_NOP,  OT_NONE, OT_NONE)        \
+  X(OP_MOV,  OT_REG,  OT_REG)         \
+  X(OP_MOV,  OT_REG,  OT_IMM)         \
+  X(OP_MOV,  OT_REG,  OT_MEM)         \
+  X(OP_MOV,  OT_MEM,  OT_REG)         \
+  X(OP_MOV,  OT_MEM,  OT_IMM)         \
+  X(OP_ADD,  OT_REG,  OT_REG)         \
+  X(OP_ADD,  OT_REG,  OT_IMM)         \
+  X(OP_ADD,  OT_REG,  OT_MEM)         \
+  X(OP_SUB,  OT_REG,  OT_REG)         \
+  X(OP_SUB,  OT_REG,  OT_IMM)         \
+  X(OP_SUB,  OT_REG,  OT_MEM)         \
+  X(OP_XOR,  OT_REG,  OT_REG)         \
+  X(OP_XOR,  OT_REG,  OT_IMM)         \
+  X(OP_XOR,  OT_REG,  OT_MEM)         \
+  X(OP_CMP,  OT_REG,  OT_REG)         \
+  X(OP_CMP,  OT_REG,  OT_IMM)         \
+  X(OP_CMP,  OT_REG,  OT_MEM)         \
+  X(OP_JMP,  OT_NONE, OT_REG)         \
+  X(OP_JMP,  OT_NONE, OT_IMM)         \
+  X(OP_JEQ,  OT_NONE, OT_REG)         \
+  X(OP_JEQ,  OT_NONE, OT_IMM)         \
+  X(OP_JNEQ, OT_NONE, OT_REG)         \
+  X(OP_JNEQ, OT_NONE, OT_IMM)         \
+  X(OP_JLA,  OT_NONE, OT_REG)         \
+  X(OP_JLA,  OT_NONE, OT_IMM)         \
+  X(OP_JLE,  OT_NONE, OT_REG)         \
+  X(OP_JLE,  OT_NONE, OT_IMM)
+
+namespace bc {
+
+/**
+ * @brief Run the VM over decoded records with guest state held in locals.
+ *
+ * The other engines go through registers_[] and is_running_ on every
+ * instruction, and any store into the byte-typed memory image forces the
+ * compiler to reload them. Here the register file, the pending compare and
+ * the instruction budget live in locals whose address never escapes, IP is
+ * not maintained per instruction at all (the current record knows it), and
+ * the VM is written back only when something outside the loop needs it:
+ *
+ *   - syscalls, records that did not decode, memory operands that would
+ *     fault and stores into the code region run through step() after a
+ *     write-back, so every fault and side effect is exact;
+ *   - a budget exit or a jump to an IP that is not a decoded boundary.
+ *
+ * Dispatch is a switch on the record's form key, with one straight-line
+ * case per form. Fused records run component by component. Only used
+ * untraced; see run_engine().
+ *
+ * @return void
+ */
+void VM::run_cached() {
+  while (is_running_) {
+    ensure_decoded();
+    const DecodedInstr* instr = decoded_at(registers_[IP]);
+    if (instr == nullptr) {
+      step();
+      continue;
+    }
+
+    const DecodedInstr* const records = decoded_.instrs.data();
+    std::uint8_t* const memory = memory_image_.data();
+    const std::uint64_t memory_size = memory_image_.size();
+    const std::uint32_t code_size = code_size_bytes_;
+
+    std::uint32_t regs[REG_COUNT];
+    std::memcpy(regs, registers_, sizeof(regs));
+    std::uint32_t cmp_lhs = cmp_lhs_;
+    std::uint32_t cmp_rhs = cmp_rhs_;
+    bool cmp_signed = cmp_signed_;
+    bool pending = flags_pending_;
+    std::int64_t budget = budget_;
+    std::uint32_t entry_ip = block_entry_ip_;
+    std::uint32_t entry_index = decoded_.index_at(entry_ip);
+
+    auto write_back = [&](std::uint32_t ip) {
+      regs[IP] = ip;
+      std::memcpy(registers_, regs, sizeof(regs));
+      cmp_lhs_ = cmp_lhs;
+      cmp_rhs_ = cmp_rhs;
+      cmp_signed_ = cmp_signed;
+      flags_pending_ = pending;
+      budget_ = budget;
+      block_entry_ip_ = entry_ip;
+    };
+
+    auto run_slow = [&](const DecodedInstr* at) -> const DecodedInstr* {
+      write_back(at->ip);
+      step();
+      return nullptr;
+    };
+
+    // Execute one record of a fixed form; nullptr means the loop was left
+    // and the VM already holds the written-back state.
+    auto exec_form = [&]<Op OPCODE, std::uint8_t DST, std::uint8_t SRC>(const DecodedInstr* at)
+        -> const DecodedInstr* {
+      if constexpr (OPCODE == OP_NOP) {
+        return at + 1;
+      } else if constexpr (is_branch_op(OPCODE)) {
+        if constexpr (OPCODE != OP_JMP) {
+          bool taken = pending ? compare_taken<OPCODE>(cmp_lhs, cmp_rhs, cmp_signed)
+                               : branch_taken<OPCODE>(regs[RF]);
+          if (!taken) {
+            regs[RF] &= ~static_cast<std::uint32_t>(F_TEST_TRUE);
+            return at + 1;
+          }
+        }
+        regs[RF] |= F_TEST_TRUE;
+
+        std::uint32_t index = static_cast<std::uint32_t>(at - records);
+        bool counted = entry_index != NO_INDEX && index >= entry_index;
+        budget -= counted ? static_cast<std::int64_t>(index - entry_index) + 1 : 1;
+
+        if constexpr (SRC == OT_IMM) {
+          entry_ip = at->src_value;
+          entry_index = at->target_index;
+        } else {
+          entry_ip = (at->src_reg == IP) ? at->next_ip : regs[at->src_reg];
+          entry_index = decoded_.index_at(entry_ip);
+        }
+        if (budget <= 0) {
+          write_back(entry_ip);
+          yield(RunStatus::BudgetExhausted);
+          return nullptr;
+        }
+        if (entry_index == NO_INDEX) {
+          write_back(entry_ip);
+          return nullptr;
+        }
+        return &records[entry_index];
+      } else {
+        std::uint32_t value = 0;
+        if constexpr (SRC == OT_REG) {
+          value = (at->src_reg == IP) ? at->next_ip : regs[at->src_reg];
+        } else if constexpr (SRC == OT_IMM) {
+          value = at->src_value;
+        } else {
+          if (static_cast<std::uint64_t>(at->src_value) + 4 > memory_size) {
+            return run_slow(at);
+          }
+          value = read_u32_le(memory + at->src_value);
+        }
+
+        if constexpr (OPCODE == OP_MOV && DST == OT_MEM) {
+          if (at->dst_value < code_size || static_cast<std::uint64_t>(at->dst_value) + 4 > memory_size) {
+            return run_slow(at);
+          }
+          write_u32_le(memory + at->dst_value, value);
+        } else if constexpr (OPCODE == OP_MOV) {
+          regs[at->dst_reg] = (at->dst_reg == RS) ? (value & 1u) : value;
+        } else if constexpr (OPCODE == OP_ADD) {
+          regs[at->dst_reg] += value;
+        } else if constexpr (OPCODE == OP_SUB) {
+          regs[at->dst_reg] -= value;
+        } else if constexpr (OPCODE == OP_XOR) {
+          regs[at->dst_reg] ^= value;
+        } else {
+          cmp_lhs = regs[at->dst_reg];
+          cmp_rhs = value;
+          cmp_signed = (regs[RS] & 1u) != 0u;
+          pending = true;
+        }
+        return at + 1;
+      }
+    };
+
+#define BC_CACHED_CASE(opcode, dst, src)                                        \
+  case form_of(opcode, dst, src):                                               \
+    instr = exec_form.template operator()<opcode, dst, src>(instr);             \
+    break;
+
+    while (instr != nullptr) {
+      switch (instr->form) {
+        BC_CACHED_FORMS(BC_CACHED_CASE)
+        default:
+          instr = run_slow(instr);
+          break;
+      }
+    }
+
+#undef BC_CACHED_CASE
+  }
+}
+
+}  // namespace bc
@@ -0,0 +1,368 @@
+//  vm_exec.hpp:
+//    Handlers specialized per (opcode, mode byte), shared by the engines that
+//    run from decoded records. Private to the VM translation units.
+//
+
+#pragma once
+#include "bytecraft/vm.hpp"
+
+namespace bc {
+
+/**
+ * @brief Check whether an opcode is one of the branch instructions.
+ *
+ * @param op  Opcode to test.
+ * @return true for jmp/jeq/jneq/jla/jle.
+ */
+constexpr bool is_branch_op(Op op) {
+  return op == OP_JMP || op == OP_JEQ || op == OP_JNEQ || op == OP_JLA || op == OP_JLE;
+}
+
+/**
+ * @brief Check whether an (opcode, mode byte) pair decodes to a runnable instruction.
+ *
+ * Must agree with decode_instruction(): every pair accepted here has a
+ * specialized handler, every other pair is routed to VM::exec_step.
+ *
+ * @param op_byte  Raw opcode byte.
+ * @param mode     Raw mode byte.
+ * @return true if the pair is valid.
+ */
+constexpr bool is_valid_form(std::uint8_t op_byte, std::uint8_t mode) {
+  std::uint8_t dst_type = static_cast<std::uint8_t>((mode >> 4) & 0xF);
+  std::uint8_t src_type = static_cast<std::uint8_t>(mode & 0xF);
+  Op op = static_cast<Op>(op_byte);
+
+  if (op == OP_NOP || op == OP_SYSCALL) {
+    return true;
+  }
+  if (is_branch_op(op)) {
+    return src_type == OT_IMM || src_type == OT_REG;
+  }
+  if (op == OP_MOV) {
+    if (dst_type == OT_REG) {
+      return src_type == OT_REG || src_type == OT_IMM || src_type == OT_MEM;
+    }
+    return dst_type == OT_MEM && (src_type == OT_REG || src_type == OT_IMM);
+  }
+  if (op == OP_ADD || op == OP_SUB || op == OP_XOR || op == OP_CMP) {
+    return dst_type == OT_REG && (src_type == OT_REG || src_type == OT_IMM || src_type == OT_MEM);
+  }
+  return false;
+}
+
+/**
+ * @brief Canonical mode byte for a valid form.
+ *
+ * nop/syscall carry no mode byte and branches ignore the dst nibble, so
+ * those collapse onto a single instantiation.
+ *
+ * @param op_byte  Raw opcode byte.
+ * @param mode     Raw mode byte.
+ * @return Mode byte used to instantiate the handler.
+ */
+constexpr std::uint8_t canonical_mode(std::uint8_t op_byte, std::uint8_t mode) {
+  Op op = static_cast<Op>(op_byte);
+  if (op == OP_NOP || op == OP_SYSCALL) {
+    return 0;
+  }
+  if (is_branch_op(op)) {
+    return static_cast<std::uint8_t>(mode & 0xF);
+  }
+  return mode;
+}
+
+/**
+ * @brief Evaluate a branch condition against the flags register.
+ *
+ * @param flags  Current rF value.
+ * @return true if the branch is taken.
+ */
+template <Op OPCODE>
+constexpr bool branch_taken(std::uint32_t flags) {
+  if constexpr (OPCODE == OP_JMP) {
+    return true;
+  } else if constexpr (OPCODE == OP_JEQ) {
+    return (flags & F_EQ) != 0u;
+  } else if constexpr (OPCODE == OP_JNEQ) {
+    return (flags & F_EQ) == 0u;
+  } else if constexpr (OPCODE == OP_JLA) {
+    return (flags & F_GT) != 0u;
+  } else {
+    return (flags & (F_LT | F_EQ)) != 0u;
+  }
+}
+
+/**
+ * @brief Compute the EQ/GT/LT bits a compare produces.
+ *
+ * @param lhs        Left-hand value.
+ * @param rhs        Right-hand value.
+ * @param is_signed  Compare as int32 (rS bit0 at the time of the cmp).
+ * @return Exactly one of F_EQ, F_GT, F_LT.
+ */
+constexpr std::uint32_t compare_flags(std::uint32_t lhs, std::uint32_t rhs, bool is_signed) {
+  if (lhs == rhs) {
+    return F_EQ;
+  }
+  bool greater = is_signed ? (static_cast<std::int32_t>(lhs) > static_cast<std::int32_t>(rhs)) : (lhs > rhs);
+  return greater ? F_GT : F_LT;
+}
+
+/**
+ * @brief Evaluate a branch condition directly from a pending compare.
+ *
+ * Agrees with branch_taken<OPCODE>(compare_flags(lhs, rhs, is_signed)).
+ *
+ * @param lhs        Left-hand value of the compare.
+ * @param rhs        Right-hand value of the compare.
+ * @param is_signed  Signedness captured by the compare.
+ * @return true if the branch is taken.
+ */
+template <Op OPCODE>
+constexpr bool compare_taken(std::uint32_t lhs, std::uint32_t rhs, bool is_signed) {
+  if constexpr (OPCODE == OP_JMP) {
+    return true;
+  } else if constexpr (OPCODE == OP_JEQ) {
+    return lhs == rhs;
+  } else if constexpr (OPCODE == OP_JNEQ) {
+    return lhs != rhs;
+  } else if constexpr (OPCODE == OP_JLA) {
+    return is_signed ? (static_cast<std::int32_t>(lhs) > static_cast<std::int32_t>(rhs)) : (lhs > rhs);
+  } else {
+    return is_signed ? (static_cast<std::int32_t>(lhs) <= static_cast<std::int32_t>(rhs)) : (lhs <= rhs);
+  }
+}
+
+/**
+ * @brief Record a compare without touching rF.
+ *
+ * The signedness is latched from rS now, so a later "mov rS, ..." does not
+ * change the outcome.
+ *
+ * @param lhs  Left-hand value.
+ * @param rhs  Right-hand value.
+ * @return void
+ */
+inline void VM::record_compare(std::uint32_t lhs, std::uint32_t rhs) {
+  cmp_lhs_ = lhs;
+  cmp_rhs_ = rhs;
+  cmp_signed_ = (registers_[RS] & 1u) != 0u;
+  flags_pending_ = true;
+}
+
+/**
+ * @brief Write the pending compare's EQ/GT/LT bits into rF.
+ *
+ * Called before anything observes or overwrites rF as a whole: rF register
+ * operands, syscalls, tracing and native blocks. Other rF bits (TEST_TRUE,
+ * fault bits) are always kept current and are left untouched.
+ *
+ * @return void
+ */
+inline void VM::materialize_flags() {
+  if (!flags_pending_) {
+    return;
+  }
+  registers_[RF] = current_flags();
+  flags_pending_ = false;
+}
+
+/**
+ * @brief Value rF would have if the pending compare were materialized.
+ *
+ * @return Exact rF value.
+ */
+inline std::uint32_t VM::current_flags() const {
+  if (!flags_pending_) {
+    return registers_[RF];
+  }
+  return (registers_[RF] & ~static_cast<std::uint32_t>(F_EQ | F_GT | F_LT))
+      | compare_flags(cmp_lhs_, cmp_rhs_, cmp_signed_);
+}
+
+/**
+ * @brief Evaluate a branch condition against the pending compare or rF.
+ *
+ * @param vm  VM whose condition state is read.
+ * @return true if the branch is taken.
+ */
+template <Op OPCODE>
+inline bool VM::condition_holds(const VM& vm) {
+  if constexpr (OPCODE == OP_JMP) {
+    return true;
+  } else {
+    return vm.flags_pending_ ? compare_taken<OPCODE>(vm.cmp_lhs_, vm.cmp_rhs_, vm.cmp_signed_)
+                             : branch_taken<OPCODE>(vm.registers_[RF]);
+  }
+}
+
+/**
+ * @brief Charge the instruction budget for a taken branch or IP write.
+ *
+ * The straight-line run from block_entry_ip_ up to and including the branch
+ * is counted through the decoded index map, so no engine counts individual
+ * instructions. When either end is not a decoded boundary the run is charged
+ * as a single instruction. Stops the VM once the budget is spent.
+ *
+ * @param branch_ip  IP of the instruction that transferred control.
+ * @param target_ip  IP control was transferred to.
+ * @return true to keep running, false if the slice is over.
+ */
+inline bool VM::charge_branch(std::uint32_t branch_ip, std::uint32_t target_ip) {
+  std::uint32_t first = decoded_.index_at(block_entry_ip_);
+  std::uint32_t last = decoded_.index_at(branch_ip);
+  bool counted = first != NO_INDEX && last != NO_INDEX && last >= first;
+  budget_ -= counted ? static_cast<std::int64_t>(last - first) + 1 : 1;
+  block_entry_ip_ = target_ip;
+  if (budget_ > 0) {
+    return true;
+  }
+  yield(RunStatus::BudgetExhausted);
+  return false;
+}
+
+/**
+ * @brief Map an IP to its decoded record.
+ *
+ * @param ip  Code offset.
+ * @return Pointer to the record starting at @p ip, or nullptr.
+ */
+inline const DecodedInstr* VM::decoded_at(std::uint32_t ip) const {
+  std::uint32_t index = decoded_.index_at(ip);
+  return (index == NO_INDEX) ? nullptr : &decoded_.instrs[index];
+}
+
+/**
+ * @brief Execute one decoded instruction of a fixed (opcode, mode) form.
+ *
+ * Operand kinds are template parameters, so each instantiation is straight-line
+ * code without operand-kind branches. The caller guarantees IP == instr.ip.
+ *
+ * @param vm     VM to execute on.
+ * @param instr  Decoded record; its form must match the template arguments.
+ * @return Next record to run, or nullptr when the caller must resync from IP
+ *         (VM stopped, code invalidated, or target not a decoded boundary).
+ */
+template <Op OPCODE, std::uint8_t MODE>
+const DecodedInstr* VM::exec(VM& vm, const DecodedInstr& instr) {
+  constexpr std::uint8_t dst_type = static_cast<std::uint8_t>((MODE >> 4) & 0xF);
+  constexpr std::uint8_t src_type = static_cast<std::uint8_t>(MODE & 0xF);
+  std::uint32_t* regs = vm.registers_;
+
+  regs[IP] = instr.next_ip;
+
+  if constexpr (OPCODE == OP_NOP) {
+    return &instr + 1;
+  } else if constexpr (OPCODE == OP_SYSCALL) {
+    vm.handle_syscall();
+    return (vm.is_running_ && vm.decoded_valid_) ? &instr + 1 : nullptr;
+  } else if constexpr (is_branch_op(OPCODE)) {
+    if (!condition_holds<OPCODE>(vm)) {
+      regs[RF] &= ~static_cast<std::uint32_t>(F_TEST_TRUE);
+      return &instr + 1;
+    }
+    regs[RF] |= F_TEST_TRUE;
+    if constexpr (src_type == OT_IMM) {
+      regs[IP] = instr.src_value;
+      if (!vm.charge_branch(instr.ip, regs[IP])) {
+        return nullptr;
+      }
+      return (instr.target_index != NO_INDEX) ? &vm.decoded_.instrs[instr.target_index] : nullptr;
+    } else {
+      regs[IP] = regs[instr.src_reg];
+      if (!vm.charge_branch(instr.ip, regs[IP])) {
+        return nullptr;
+      }
+      return vm.decoded_at(regs[IP]);
+    }
+  } else {
+    std::uint32_t value = 0;
+    if constexpr (src_type == OT_REG) {
+      value = regs[instr.src_reg];
+    } else if constexpr (src_type == OT_IMM) {
+      value = instr.src_value;
+    } else {
+      value = vm.load32(instr.src_value);
+      if (!vm.is_running_) {
+        return nullptr;
+      }
+    }
+
+    if constexpr (OPCODE == OP_MOV && dst_type == OT_MEM) {
+      vm.store32(instr.dst_value, value);
+      return (vm.is_running_ && vm.decoded_valid_) ? &instr + 1 : nullptr;
+    } else if constexpr (OPCODE == OP_MOV) {
+      regs[instr.dst_reg] = (instr.dst_reg == RS) ? (value & 1u) : value;
+    } else if constexpr (OPCODE == OP_ADD) {
+      regs[instr.dst_reg] += value;
+    } else if constexpr (OPCODE == OP_SUB) {
+      regs[instr.dst_reg] -= value;
+    } else if constexpr (OPCODE == OP_XOR) {
+      regs[instr.dst_reg] ^= value;
+    } else {
+      vm.record_compare(regs[instr.dst_reg], value);
+    }
+    return &instr + 1;
+  }
+}
+
+/**
+ * @brief Superinstruction: run consecutive records with one dispatch.
+ *
+ * Every handler but the last must be a form that always falls through
+ * (register/immediate ALU, cmp or mov), so only the last one decides the
+ * successor. Each component still updates IP and rF exactly as it would
+ * on its own.
+ *
+ * @param vm     VM to execute on.
+ * @param instr  First record of the fused sequence.
+ * @return Successor chosen by the last component.
+ */
+template <ExecHandler FIRST, ExecHandler... REST>
+const DecodedInstr* VM::exec_fused(VM& vm, const DecodedInstr& instr) {
+  if constexpr (sizeof...(REST) == 0) {
+    return FIRST(vm, instr);
+  } else {
+    FIRST(vm, instr);
+    return exec_fused<REST...>(vm, (&instr)[1]);
+  }
+}
+
+/**
+ * @brief Pick the fused handler for a fall-through prefix followed by a conditional branch.
+ *
+ * @param branch_op  jeq, jneq, jla or jle with an immediate target.
+ * @return Fused handler, or nullptr for any other opcode.
+ */
+template <ExecHandler... PREFIX>
+ExecHandler VM::fuse_with_branch(Op branch_op) {
+  switch (branch_op) {
+    case OP_JEQ:
+      return &VM::exec_fused<PREFIX..., &VM::exec<OP_JEQ, OT_IMM>>;
+    case OP_JNEQ:
+      return &VM::exec_fused<PREFIX..., &VM::exec<OP_JNEQ, OT_IMM>>;
+    case OP_JLA:
+      return &VM::exec_fused<PREFIX..., &VM::exec<OP_JLA, OT_IMM>>;
+    case OP_JLE:
+      return &VM::exec_fused<PREFIX..., &VM::exec<OP_JLE, OT_IMM>>;
+    default:
+      return nullptr;
+  }
+}
+
+/**
+ * @brief Pick the handler for one (opcode byte, mode byte) table slot.
+ *
+ * @return Specialized handler for valid forms, exec_step otherwise.
+ */
+template <std::uint8_t OP_BYTE, std::uint8_t MODE>
+constexpr ExecHandler VM::select_handler() {
+  if constexpr (OP_BYTE <= OP_SYSCALL && is_valid_form(OP_BYTE, MODE)) {
+    return &VM::exec<static_cast<Op>(OP_BYTE), canonical_mode(OP_BYTE, MODE)>;
+  } else {
+    return &VM::exec_step;
+  }
+}
+
+}  // namespace bc
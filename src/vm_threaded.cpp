@@ -0,0 +1,180 @@
+//  vm_threaded.cpp:
+//    Direct-threaded dispatch over the decoded instruction stream.
+//
+
+#include "bytecraft/vm.hpp"
+#include "vm_exec.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BYTECRAFT_COMPUTED_GOTO 1
+#else
+#define BYTECRAFT_COMPUTED_GOTO 0
+#endif
+
+// Forms that get their own label (and dispatch site) in the threaded engine:
+// X(label, opcode, mode byte). Everything else goes through the record's
+// bound handler at the generic label.
+#define BC_THREADED_FORMS(X)          \
+  X(nop,      OP_NOP,     0x00)       \
+  X(mov_rr,   OP_MOV,     0x11)       \
+  X(mov_ri,   OP_MOV,     0x12)       \
+  X(mov_rm,   OP_MOV,     0x13)       \
+  X(mov_mr,   OP_MOV,     0x31)       \
+  X(mov_mi,   OP_MOV,     0x32)       \
+  X(add_rr,   OP_ADD,     0x11)       \
+  X(add_ri,   OP_ADD,     0x12)       \
+  X(add_rm,   OP_ADD,     0x13)       \
+  X(sub_rr,   OP_SUB,     0x11)       \
+  X(sub_ri,   OP_SUB,     0x12)       \
+  X(sub_rm,   OP_SUB,     0x13)       \
+  X(xor_rr,   OP_XOR,     0x11)       \
+  X(xor_ri,   OP_XOR,     0x12)       \
+  X(xor_rm,   OP_XOR,     0x13)       \
+  X(cmp_rr,   OP_CMP,     0x11)       \
+  X(cmp_ri,   OP_CMP,     0x12)       \
+  X(cmp_rm,   OP_CMP,     0x13)       \
+  X(jmp_i,    OP_JMP,     0x02)       \
+  X(jmp_r,    OP_JMP,     0x01)       \
+  X(jeq_i,    OP_JEQ,     0x02)       \
+  X(jeq_r,    OP_JEQ,     0x01)       \
+  X(jneq_i,   OP_JNEQ,    0x02)       \
+  X(jneq_r,   OP_JNEQ,    0x01)       \
+  X(jla_i,    OP_JLA,     0x02)       \
+  X(jla_r,    OP_JLA,     0x01)       \
+  X(jle_i,    OP_JLE,     0x02)       \
+  X(jle_r,    OP_JLE,     0x01)       \
+  X(syscall,  OP_SYSCALL, 0x00)
+
+// Superinstructions with their own label: X(label, cmp mode byte, branch opcode).
+// Other fused records go through the generic label.
+#define BC_THREADED_FUSED(X)          \
+  X(cmp_rr_jeq,   0x11, OP_JEQ)       \
+  X(cmp_rr_jneq,  0x11, OP_JNEQ)      \
+  X(cmp_rr_jla,   0x11, OP_JLA)       \
+  X(cmp_rr_jle,   0x11, OP_JLE)       \
+  X(cmp_ri_jeq,   0x12, OP_JEQ)       \
+  X(cmp_ri_jneq,  0x12, OP_JNEQ)      \
+  X(cmp_ri_jla,   0x12, OP_JLA)       \
+  X(cmp_ri_jle,   0x12, OP_JLE)
+
+namespace bc {
+
+/**
+ * @brief Run the VM with direct-threaded dispatch.
+ *
+ * Each decoded record carries the address of its handler label, and every
+ * label runs one inlined exec<opcode, mode> instantiation and ends with its
+ * own indirect jump to the next record's label, so the host branch predictor
+ * sees one dispatch site per instruction form instead of the single shared
+ * switch in step(). Handlers that cannot stop the VM return a constant
+ * successor, so the resync check folds away for them. cmp + conditional
+ * branch superinstructions get labels of their own as well.
+ *
+ * TRACE selects the tracing policy. Records hold label addresses of one
+ * instantiation; set_tracing() invalidates the decoded stream whenever it
+ * changes the policy, so they are rebound before the other one runs.
+ *
+ * Compilers without labels-as-values use run_predecoded() instead.
+ *
+ * @return void
+ */
+template <bool TRACE>
+void VM::run_threaded() {
+#if BYTECRAFT_COMPUTED_GOTO
+  const DecodedInstr* instr = nullptr;
+  const DecodedInstr* next = nullptr;
+
+#define BC_TRACE()                                  \
+  do {                                              \
+    if constexpr (TRACE) {                          \
+      dump_registers(instr->ip, instr->op);         \
+    }                                               \
+  } while (0)
+
+#define BC_FORM_LABEL(name, opcode, mode)           \
+  form_##name:                                      \
+    next = exec<opcode, mode>(*this, *instr);       \
+    BC_TRACE();                                     \
+    if (next == nullptr) {                          \
+      goto resync;                                  \
+    }                                               \
+    instr = next;                                   \
+    goto *instr->thread;
+
+#define BC_FUSED_LABEL(name, cmp_mode, branch_op)   \
+  fused_##name:                                     \
+    next = exec_fused<&VM::exec<OP_CMP, cmp_mode>, &VM::exec<branch_op, OT_IMM>>(*this, *instr); \
+    if (next == nullptr) {                          \
+      goto resync;                                  \
+    }                                               \
+    instr = next;                                   \
+    goto *instr->thread;
+
+#define BC_FUSED_MATCH(name, cmp_mode, branch_op)   \
+  if (record.handler == &VM::exec_fused<&VM::exec<OP_CMP, cmp_mode>, &VM::exec<branch_op, OT_IMM>>) { \
+    record.thread = &&fused_##name;                 \
+  }
+
+#define BC_FORM_CASE(name, opcode, mode)            \
+  case ((static_cast<unsigned>(opcode) << 8) | (mode)): \
+    record.thread = &&form_##name;                  \
+    break;
+
+resync:
+  if (!is_running_) {
+    return;
+  }
+  if (!decoded_valid_ || !decoded_threaded_) {
+    ensure_decoded();
+    for (DecodedInstr& record : decoded_.instrs) {
+      record.thread = &&generic;
+      if ((record.flags & DF_DECODED) == 0u) {
+        continue;
+      }
+      if ((record.flags & DF_FUSED) != 0u) {
+        BC_THREADED_FUSED(BC_FUSED_MATCH)
+        continue;
+      }
+      switch ((static_cast<unsigned>(record.op) << 8) | canonical_mode(record.op, record.mode)) {
+        BC_THREADED_FORMS(BC_FORM_CASE)
+        default:
+          break;
+      }
+    }
+    decoded_threaded_ = true;
+  }
+  instr = decoded_at(registers_[IP]);
+  if (instr == nullptr) {
+    step_impl<true, TRACE>();
+    goto resync;
+  }
+  goto *instr->thread;
+
+generic:
+  next = instr->handler(*this, *instr);
+  if ((instr->flags & DF_DECODED) != 0u) {
+    BC_TRACE();
+  }
+  if (next == nullptr) {
+    goto resync;
+  }
+  instr = next;
+  goto *instr->thread;
+
+  BC_THREADED_FORMS(BC_FORM_LABEL)
+  BC_THREADED_FUSED(BC_FUSED_LABEL)
+
+#undef BC_FORM_CASE
+#undef BC_FUSED_MATCH
+#undef BC_FUSED_LABEL
+#undef BC_FORM_LABEL
+#undef BC_TRACE
+#else
+  run_predecoded<TRACE>();
+#endif
+}
+
+template void VM::run_threaded<false>();
+template void VM::run_threaded<true>();
+
+}  // namespace bc
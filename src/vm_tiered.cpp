@@ -0,0 +1,110 @@
+//  vm_tiered.cpp:
+//    Profile-driven promotion from step() to the decoded and native tiers.
+//
+
+#include "bytecraft/vm.hpp"
+#include "vm_exec.hpp"
+
+namespace bc {
+
+namespace {
+
+// Entries a block needs before it leaves the step() interpreter.
+constexpr std::uint32_t TIER_UP_THRESHOLD = 64;
+
+}  // namespace
+
+/**
+ * @brief Run the VM in step() and promote hot basic blocks to faster tiers.
+ *
+ * Tier 0 is the byte interpreter. Every taken branch or IP write charges
+ * the instruction budget, so a change of budget_ across a step marks a
+ * block entry at the new IP; entries are counted per IP. Once a block has
+ * been entered TIER_UP_THRESHOLD times:
+ *
+ *   - the code section is decoded (only then, so short-lived programs never
+ *     pay for it), and the block runs as a native x86-64 block when the JIT
+ *     is available and tracing is off;
+ *   - otherwise it runs on the decoded records with their specialized and
+ *     fused handlers, which keep going as long as control stays on hot
+ *     blocks and drop back to tier 0 when a branch lands on a cold one.
+ *
+ * Native blocks are translated on first use of a hot entry, so only hot
+ * code is ever compiled. The IP a native block exits to counts as a block
+ * entry as well, so the code behind an untranslatable instruction (e.g. a
+ * syscall in a loop body) warms up too.
+ *
+ * @return void
+ */
+template <bool TRACE>
+void VM::run_tiered() {
+  if (block_heat_.size() != code_size_bytes_) {
+    block_heat_.assign(code_size_bytes_, 0);
+  }
+
+  auto is_hot = [&](std::uint32_t ip) {
+    return ip < block_heat_.size() && block_heat_[ip] >= TIER_UP_THRESHOLD;
+  };
+
+  auto heat_up = [&](std::uint32_t ip) {
+    if (ip >= block_heat_.size()) {
+      return false;
+    }
+    if (block_heat_[ip] < TIER_UP_THRESHOLD) {
+      block_heat_[ip] += 1;
+    }
+    return block_heat_[ip] >= TIER_UP_THRESHOLD;
+  };
+
+  while (is_running_) {
+    std::uint32_t ip = registers_[IP];
+    if (!is_hot(ip)) {
+      std::int64_t budget_before = budget_;
+      step_impl<true, TRACE>();
+      if (budget_ != budget_before) {
+        heat_up(registers_[IP]);
+      }
+      continue;
+    }
+
+    ensure_decoded();
+    if constexpr (!TRACE) {
+      JitBlockFn block = jit_.block_at(decoded_, ip, memory_image_.size(), code_size_bytes_);
+      if (block != nullptr) {
+        materialize_flags();
+        block(registers_, memory_image_.data(), &budget_);
+        block_entry_ip_ = registers_[IP];
+        if (budget_ <= 0) {
+          yield(RunStatus::BudgetExhausted);
+          break;
+        }
+        heat_up(registers_[IP]);
+        continue;
+      }
+    }
+
+    const DecodedInstr* instr = decoded_at(ip);
+    if (instr == nullptr) {
+      step_impl<true, TRACE>();
+      continue;
+    }
+    while (instr != nullptr) {
+      std::int64_t budget_before = budget_;
+      const DecodedInstr* next = instr->handler(*this, *instr);
+      if constexpr (TRACE) {
+        if ((instr->flags & DF_DECODED) != 0u) {
+          dump_registers(instr->ip, instr->op);
+        }
+      }
+      if (budget_ != budget_before && !heat_up(registers_[IP])) {
+        break;
+      }
+      instr = next;
+    }
+  }
+}
+
+template void VM::run_tiered<false>();
+template void VM::run_tiered<true>();
+
+}  // namespace bc
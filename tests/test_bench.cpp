@@ -0,0 +1,90 @@
+// test_bench.cpp:
+//    Benchmark reports round-trip through JSON, comparisons flag only
+//    significant slowdowns and list benchmarks or engines that differ.
+//
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "bytecraft/bench.hpp"
+
+TEST(Bench, JsonRoundTrip) {
+  bc::BenchReport report;
+  report.engine = "jit";
+  report.peak_rss_kib = 4321;
+  report.results.push_back({"vm/arith", "instrs/s", {1.5e9, 1.25e9, 1.75e9}});
+  report.results.push_back({"asm/large", "MB/s", {2.5}});
+
+  std::ostringstream json;
+  bc::write_bench_json(json, report);
+  EXPECT_NE(json.str().find("\"ns_per_instr\":"), std::string::npos) << json.str();
+
+  bc::BenchReport parsed;
+  std::string error_message;
+  ASSERT_TRUE(bc::read_bench_json(json.str(), parsed, error_message)) << error_message;
+  EXPECT_EQ(parsed.engine, "jit");
+  EXPECT_EQ(parsed.peak_rss_kib, 4321u);
+  ASSERT_EQ(parsed.results.size(), 2u);
+  EXPECT_EQ(parsed.results[0].name, "vm/arith");
+  EXPECT_EQ(parsed.results[0].samples, report.results[0].samples);
+  EXPECT_DOUBLE_EQ(parsed.results[0].mean(), 1.5e9);
+  EXPECT_EQ(parsed.results[1].unit, "MB/s");
+
+  EXPECT_FALSE(bc::read_bench_json("{\"version\":1}", parsed, error_message));
+  EXPECT_FALSE(bc::read_bench_json("{\"benchmarks\":[", parsed, error_message));
+}
+
+TEST(Bench, WelchMatchesReferenceValue) {
+  // t = -1.0, df = 8 for these sets; two-sided p = 0.3466.
+  std::vector<double> a = {1, 2, 3, 4, 5};
+  std::vector<double> b = {2, 3, 4, 5, 6};
+  EXPECT_NEAR(bc::welch_p_value(a, b), 0.3466, 1e-4);
+  EXPECT_DOUBLE_EQ(bc::welch_p_value(a, a), 1.0);
+  EXPECT_DOUBLE_EQ(bc::welch_p_value({1.0}, b), 1.0);
+}
+
+TEST(Bench, CompareFlagsSignificantSlowdownsOnly) {
+  bc::BenchReport base;
+  base.results.push_back({"vm/arith", "instrs/s", {100, 101, 99, 100, 100}});
+  base.results.push_back({"vm/stream", "instrs/s", {100, 130, 70, 100, 100}});
+  base.results.push_back({"vm/branchy", "instrs/s", {100, 101, 99, 100, 100}});
+
+  bc::BenchReport current;
+  current.results.push_back({"vm/arith", "instrs/s", {90, 91, 89, 90, 90}});     // clear regression
+  current.results.push_back({"vm/stream", "instrs/s", {95, 125, 65, 95, 95}});   // noisy, not significant
+  current.results.push_back({"vm/branchy", "instrs/s", {99.5, 100.5, 98.5, 99.5, 99.5}});  // under threshold
+  current.results.push_back({"vm/new", "instrs/s", {1, 2}});                     // not in base
+
+  bc::BenchDiff diff = bc::compare_bench(base, current, 2.0, 0.05);
+  const std::vector<bc::BenchComparison>& comparisons = diff.comparisons;
+  ASSERT_EQ(comparisons.size(), 3u);
+  EXPECT_TRUE(comparisons[0].regression);
+  EXPECT_NEAR(comparisons[0].change_percent, -10.0, 1e-9);
+  EXPECT_LT(comparisons[0].p_value, 0.001);
+  EXPECT_FALSE(comparisons[1].regression);
+  EXPECT_GT(comparisons[1].p_value, 0.05);
+  EXPECT_FALSE(comparisons[2].regression);
+}
+
+TEST(Bench, CompareReportsMismatches) {
+  bc::BenchReport base;
+  base.engine = "jit";
+  base.results.push_back({"vm/arith", "instrs/s", {100, 101, 99}});
+  base.results.push_back({"vm/gone", "instrs/s", {100, 101, 99}});
+
+  bc::BenchReport current = base;
+  bc::BenchDiff diff = bc::compare_bench(base, current, 2.0, 0.05);
+  EXPECT_FALSE(diff.mismatched());
+  EXPECT_EQ(diff.comparisons.size(), 2u);
+
+  current.engine = "tiered";
+  current.results[1].name = "vm/new";
+  diff = bc::compare_bench(base, current, 2.0, 0.05);
+  EXPECT_TRUE(diff.mismatched());
+  EXPECT_TRUE(diff.engine_mismatch);
+  EXPECT_EQ(diff.missing, std::vector<std::string>{"vm/gone"});
+  EXPECT_EQ(diff.added, std::vector<std::string>{"vm/new"});
+  ASSERT_EQ(diff.comparisons.size(), 1u);
+  EXPECT_EQ(diff.comparisons[0].name, "vm/arith");
+}
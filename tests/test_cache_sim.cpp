@@ -0,0 +1,107 @@
+// test_cache_sim.cpp:
+//    LRU behaviour of the cache simulator and its hook into the VM.
+//
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/cache_sim.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+TEST(CacheSim, ParsesHierarchy) {
+  std::vector<bc::CacheLevelConfig> levels;
+  std::string error_message;
+  ASSERT_TRUE(bc::parse_cache_config("32K:64:8,1M:128:16", levels, error_message)) << error_message;
+  ASSERT_EQ(levels.size(), 2u);
+  EXPECT_EQ(levels[0].size_bytes, 32u * 1024u);
+  EXPECT_EQ(levels[0].line_bytes, 64u);
+  EXPECT_EQ(levels[0].ways, 8u);
+  EXPECT_EQ(levels[1].size_bytes, 1024u * 1024u);
+
+  EXPECT_FALSE(bc::parse_cache_config("32K:48:8", levels, error_message));
+  EXPECT_FALSE(bc::parse_cache_config("96K:64:8", levels, error_message));
+  EXPECT_FALSE(bc::parse_cache_config("32K:64", levels, error_message));
+  EXPECT_FALSE(bc::parse_cache_config("", levels, error_message));
+}
+
+TEST(CacheSim, EvictsLeastRecentlyUsed) {
+  // Two sets of two 64-byte lines.
+  bc::CacheSimulator cache({{256, 64, 2}});
+  cache.access(0, 4, false);     // set 0: miss
+  cache.access(64, 4, false);    // set 1: miss
+  cache.access(128, 4, true);    // set 0: miss
+  cache.access(0, 4, false);     // hit
+  cache.access(256, 4, false);   // set 0: miss, evicts 128
+  cache.access(128, 4, false);   // miss, evicts 0
+  cache.access(0, 4, false);     // miss
+  EXPECT_EQ(cache.hits(0), 1u);
+  EXPECT_EQ(cache.misses(0), 6u);
+  EXPECT_EQ(cache.reads(), 6u);
+  EXPECT_EQ(cache.writes(), 1u);
+
+  cache.access(62, 4, false);    // straddles lines 0 and 1
+  EXPECT_EQ(cache.hits(0) + cache.misses(0), 9u);
+}
+
+TEST(CacheSim, SecondLevelCatchesFirstLevelMisses) {
+  bc::CacheSimulator cache({{128, 64, 1}, {1024, 64, 4}});
+  cache.access(0, 4, false);
+  cache.access(128, 4, false);   // conflicts with line 0 in L1 only
+  cache.access(0, 4, false);
+  EXPECT_EQ(cache.misses(0), 3u);
+  EXPECT_EQ(cache.misses(1), 2u);
+  EXPECT_EQ(cache.hits(1), 1u);
+}
+
+TEST(CacheSim, VmFeedsMemoryOperands) {
+  const char* source =
+    "_main:\n"
+    "  mov r1, 0\n"
+    "loop:\n"
+    "  mov r2, [a]\n"
+    "  add r2, r1\n"
+    "  mov [b], r2\n"
+    "  add r1, 1\n"
+    "  cmp r1, 100\n"
+    "  jneq loop\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB a[4]\n"
+    "  DB b[4]\n";
+
+  bc::Assembler assembler;
+  bc::Module module;
+  std::string error_message;
+  ASSERT_TRUE(assembler.assemble_string(source, module, error_message)) << error_message;
+  ASSERT_EQ(module.data_symbols.size(), 2u);
+  EXPECT_EQ(module.data_symbols[0].name, "a");
+  EXPECT_EQ(module.data_symbols[0].address, module.code_section.size());
+
+  bc::VM vm = bc_test::make_vm(module);
+  vm.set_engine(bc::Engine::Jit);
+
+  std::vector<bc::CacheLevelConfig> levels;
+  ASSERT_TRUE(bc::parse_cache_config("1K:64:2", levels, error_message)) << error_message;
+  vm.set_cache_simulation(levels);
+  vm.run();
+  EXPECT_EQ(vm.get_register(bc::R2), 99u);
+
+  const bc::CacheSimulator* cache = vm.cache_simulation();
+  ASSERT_NE(cache, nullptr);
+  EXPECT_EQ(cache->reads(), 100u);
+  EXPECT_EQ(cache->writes(), 100u);
+  EXPECT_LE(cache->misses(0), 2u);
+
+  std::ostringstream report;
+  cache->write_report(report, module.data_symbols, static_cast<std::uint32_t>(module.code_section.size()));
+  EXPECT_NE(report.str().find("data accesses: 200"), std::string::npos) << report.str();
+  EXPECT_NE(report.str().find("  a  "), std::string::npos) << report.str();
+  EXPECT_NE(report.str().find("  b  "), std::string::npos) << report.str();
+
+  vm.set_cache_simulation({});
+  EXPECT_EQ(vm.cache_simulation(), nullptr);
+}
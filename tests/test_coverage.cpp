@@ -0,0 +1,71 @@
+// test_coverage.cpp:
+//    Block hit counts, the edge bitmap and the annotated report.
+//
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/coverage.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+// Blocks: 0 (entry), 7 (loop, entered by 9 taken branches), 27 (fallthrough).
+const char* const COVERAGE_SOURCE =
+  "_main:\n"
+  "  mov r1, 0\n"
+  "loop:\n"
+  "  add r1, 1\n"
+  "  cmp r1, 10\n"
+  "  jneq loop\n"
+  "  mov r1, 0\n"
+  "  syscall\n";
+
+}  // namespace
+
+TEST(Coverage, CountsBlocksAndEdges) {
+  bc::Module module = bc_test::assemble(COVERAGE_SOURCE);
+  for (bc::Engine engine : {bc::Engine::Switch, bc::Engine::Jit, bc::Engine::Tiered}) {
+    bc::VM vm = bc_test::make_vm(module);
+    vm.set_engine(engine);
+    vm.set_coverage(true);
+    vm.run();
+
+    const bc::Coverage* coverage = vm.coverage();
+    ASSERT_NE(coverage, nullptr);
+    EXPECT_EQ(coverage->block_hits(0), 1u) << bc::engine_name(engine);
+    EXPECT_EQ(coverage->block_hits(7), 9u) << bc::engine_name(engine);
+    EXPECT_EQ(coverage->block_hits(27), 1u) << bc::engine_name(engine);
+    EXPECT_EQ(coverage->block_hits(14), 0u) << bc::engine_name(engine);
+    // entry, entry->loop, loop->loop, loop->exit
+    EXPECT_EQ(coverage->edges_covered(), 4u) << bc::engine_name(engine);
+    EXPECT_EQ(coverage->edge_map().size(), bc::Coverage::MAP_SIZE);
+  }
+}
+
+TEST(Coverage, ReportHasLabelsAndSourceLines) {
+  bc::Module module = bc_test::assemble(COVERAGE_SOURCE);
+  ASSERT_EQ(module.line_table.size(), 6u);
+  EXPECT_EQ(module.line_table[1].address, 7u);
+  EXPECT_EQ(module.line_table[1].line, 4u);
+
+  bc::VM vm = bc_test::make_vm(module);
+  vm.set_coverage(true);
+  vm.run();
+
+  std::vector<std::string> source_lines;
+  std::istringstream source(COVERAGE_SOURCE);
+  for (std::string line; std::getline(source, line);) {
+    source_lines.push_back(line);
+  }
+
+  std::ostringstream report;
+  vm.coverage()->write_report(report, module.code_symbols, module.line_table, source_lines);
+  EXPECT_NE(report.str().find("blocks: 3  edges: 4/65536\n"), std::string::npos) << report.str();
+  EXPECT_NE(report.str().find("IP:00000007"), std::string::npos) << report.str();
+  EXPECT_NE(report.str().find("loop"), std::string::npos) << report.str();
+  EXPECT_NE(report.str().find("line 4       add r1, 1\n"), std::string::npos) << report.str();
+}
@@ -0,0 +1,73 @@
+// test_gen.cpp:
+//    Generated workloads are deterministic, assemble, and halt.
+//
+
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <sstream>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/gen.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+TEST(Gen, SameSeedSameSource) {
+  bc::GenOptions options;
+  options.workload = bc::Workload::Branchy;
+  options.seed = 42;
+  std::string first = bc::generate_program(options);
+  EXPECT_EQ(bc::generate_program(options), first);
+
+  options.seed = 43;
+  EXPECT_NE(bc::generate_program(options), first);
+
+  bc::Workload workload = bc::Workload::Arith;
+  EXPECT_TRUE(bc::parse_workload("stream", workload));
+  EXPECT_EQ(workload, bc::Workload::Stream);
+  EXPECT_FALSE(bc::parse_workload("nope", workload));
+}
+
+TEST(Gen, EveryWorkloadAssemblesAndHalts) {
+  for (bc::Workload workload :
+       {bc::Workload::Arith, bc::Workload::Stream, bc::Workload::Branchy, bc::Workload::Syscall, bc::Workload::Large}) {
+    SCOPED_TRACE(bc::workload_name(workload));
+    bc::GenOptions options;
+    options.workload = workload;
+    options.seed = 7;
+    options.iterations = 50;
+    options.size = (workload == bc::Workload::Stream) ? 4096 : 32;
+    bc::Module module = bc_test::assemble(bc::generate_program(options));
+
+    bc::VM vm = bc_test::make_vm(module);
+    vm.set_engine(bc::Engine::Tiered);
+    vm.set_stats(true);
+
+    std::ostringstream output;
+    std::streambuf* saved_out = std::cout.rdbuf(output.rdbuf());
+    vm.run();
+    std::cout.rdbuf(saved_out);
+
+    EXPECT_EQ(vm.get_register(bc::RF) & bc::F_BAD_INSTR, 0u);
+    EXPECT_EQ(vm.stats()->counter(bc::ExecStats::SYSCALL_SLOTS + bc::SC_EXIT), 1u);
+    if (workload == bc::Workload::Stream) {
+      EXPECT_EQ(module.data_section.size(), 4096u);
+      EXPECT_EQ(vm.stats()->counter(bc::ExecStats::LOAD_SLOT), 50u * 64u);
+    }
+    if (workload == bc::Workload::Syscall) {
+      EXPECT_EQ(output.str().size(), 50u * 4u * 32u);
+    }
+  }
+}
+
+TEST(Gen, LargeHasManyLabels) {
+  bc::GenOptions options;
+  options.workload = bc::Workload::Large;
+  options.size = 5000;
+  std::string source = bc::generate_program(options);
+  EXPECT_GT(source.size(), 300000u);
+
+  bc::Module module = bc_test::assemble(source);
+  EXPECT_EQ(module.code_symbols.size(), 5001u);
+  EXPECT_EQ(module.data_symbols.size(), 1250u);
+}
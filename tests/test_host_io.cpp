@@ -0,0 +1,658 @@
+// test_host_io.cpp:
+//    SC_WRITE output is buffered per fd and flushed at the right points;
+//    SC_READ reads stdin in bulk; files open only inside the sandbox root
+//    and can be mapped into guest memory; vectored I/O covers every pair.
+//
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/host_io.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+/**
+ * @brief Redirects std::cout and std::cerr into strings for its lifetime.
+ */
+class CaptureStreams {
+ public:
+  CaptureStreams()
+      : saved_out_(std::cout.rdbuf(out_.rdbuf())),
+        saved_err_(std::cerr.rdbuf(err_.rdbuf())) {}
+
+  ~CaptureStreams() {
+    std::cout.rdbuf(saved_out_);
+    std::cerr.rdbuf(saved_err_);
+  }
+
+  std::string out() const {
+    return out_.str();
+  }
+
+  std::string err() const {
+    return err_.str();
+  }
+
+ private:
+  std::ostringstream out_;
+  std::ostringstream err_;
+  std::streambuf* saved_out_;
+  std::streambuf* saved_err_;
+};
+
+/**
+ * @brief String buffer that counts how often its stream is flushed.
+ */
+class CountingBuffer : public std::stringbuf {
+ public:
+  int flushes = 0;
+
+ protected:
+  int sync() override {
+    flushes += 1;
+    return std::stringbuf::sync();
+  }
+};
+
+}  // namespace
+
+TEST(HostIo, BuffersUntilFlushOrThreshold) {
+  CaptureStreams capture;
+  {
+    bc::OutputBuffers output;
+    const std::uint8_t text[] = {'a', 'b', 'c'};
+    output.write(1, text, 3);
+    output.write(2, text, 2);
+    output.write(7, text, 1);
+    EXPECT_EQ(capture.out(), "");
+    output.flush(1);
+    EXPECT_EQ(capture.out(), "abca");
+    EXPECT_EQ(capture.err(), "");
+
+    std::vector<std::uint8_t> big(bc::OutputBuffers::FLUSH_THRESHOLD, 'x');
+    output.write(1, text, 1);
+    output.write(1, big.data(), big.size());
+    EXPECT_EQ(capture.out().size(), 4u + 1u + big.size());
+  }
+  EXPECT_EQ(capture.err(), "ab");
+}
+
+TEST(HostIo, VmFlushesOnSyscallAndReturn) {
+  // Writes "hi" to stdout and "!" to stderr, flushes stdout, then faults.
+  bc::VM vm = bc_test::make_vm(
+    "_main:\n"
+    "  mov r1, 1\n"
+    "  mov r2, 1\n"
+    "  mov r3, msg\n"
+    "  mov r4, 2\n"
+    "  syscall\n"
+    "  mov r1, 1\n"
+    "  mov r2, 2\n"
+    "  mov r3, bang\n"
+    "  mov r4, 1\n"
+    "  syscall\n"
+    "  mov r1, 4\n"
+    "  mov r2, 1\n"
+    "  syscall\n"
+    "  mov r1, 99\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB msg[2] = \"hi\"\n"
+    "  DB bang[1] = \"!\"\n");
+  vm.set_engine(bc::Engine::Jit);
+  CaptureStreams capture;
+  vm.run();
+  EXPECT_NE(vm.get_register(bc::RF) & bc::F_BAD_INSTR, 0u);
+  EXPECT_EQ(capture.out(), "hi");
+  EXPECT_EQ(capture.err(), "!");
+}
+
+TEST(HostIo, TracedOutputStaysInProgramOrder) {
+  // Four movs, the write of "HELLO", then two more instructions.
+  const char* source =
+    "_main:\n"
+    "  mov r1, 1\n"
+    "  mov r2, 1\n"
+    "  mov r3, msg\n"
+    "  mov r4, 5\n"
+    "  syscall\n"
+    "  mov r5, 1\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB msg[5] = \"HELLO\"\n";
+
+  for (bc::Engine engine : {bc::Engine::Switch, bc::Engine::Threaded, bc::Engine::Tiered}) {
+    SCOPED_TRACE(static_cast<int>(engine));
+    bc::VM vm = bc_test::make_vm(source);
+    vm.set_engine(engine);
+    vm.set_tracing(true);
+    CaptureStreams capture;
+    vm.run();
+
+    std::string out = capture.out();
+    std::size_t hello = out.find("HELLO");
+    ASSERT_NE(hello, std::string::npos);
+    // The output lands between the trace lines of the movs and the syscall.
+    EXPECT_EQ(std::count(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(hello), '\n'), 4);
+    EXPECT_EQ(out.compare(hello + 5, 3, "IP:"), 0);
+  }
+}
+
+TEST(HostIo, DirectWritesGoToHostDescriptor) {
+  std::string path = ::testing::TempDir() + "bytecraft_direct_io.txt";
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  std::cout.flush();
+  int saved_stdout = dup(STDOUT_FILENO);
+  dup2(fileno(file), STDOUT_FILENO);
+  {
+    bc::OutputBuffers output;
+    output.set_direct(true);
+    const std::uint8_t text[] = {'o', 'k', '\n'};
+    output.write(1, text, 3);
+    // Past the threshold, segments bypass the buffer in one writev(2).
+    std::vector<std::uint8_t> large(bc::OutputBuffers::FLUSH_THRESHOLD, 'x');
+    iovec segments[] = {{const_cast<std::uint8_t*>(text), 3}, {large.data(), large.size()}};
+    output.write(1, segments, 2);
+  }
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  std::fclose(file);
+
+  std::ifstream result(path);
+  std::string line;
+  std::getline(result, line);
+  EXPECT_EQ(line, "ok");
+  std::getline(result, line);
+  EXPECT_EQ(line, "ok");
+  std::getline(result, line);
+  EXPECT_EQ(line.size(), bc::OutputBuffers::FLUSH_THRESHOLD);
+}
+
+TEST(HostIo, LargeVectoredWriteFlushesOnce) {
+  CountingBuffer counting;
+  std::streambuf* saved = std::cout.rdbuf(&counting);
+  {
+    bc::OutputBuffers output;
+    std::vector<std::uint8_t> half(bc::OutputBuffers::FLUSH_THRESHOLD / 2, 'x');
+    std::vector<iovec> segments(4, iovec{half.data(), half.size()});
+    output.write(1, segments.data(), segments.size());
+  }
+  std::cout.rdbuf(saved);
+  EXPECT_EQ(counting.str().size(), 2u * bc::OutputBuffers::FLUSH_THRESHOLD);
+  EXPECT_EQ(counting.flushes, 1);
+}
+
+TEST(HostIo, ReadsStdinInBulk) {
+  const char* source =
+    "_main:\n"
+    "  mov r1, 2\n"
+    "  mov r2, 0\n"
+    "  mov r3, buffer\n"
+    "  mov r4, 8\n"
+    "  syscall\n"
+    "  mov r5, [buffer]\n"
+    "  mov r6, [tail]\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB buffer[4]\n"
+    "  DB tail[4] = \"....\"\n";
+
+  bc::VM vm = bc_test::make_vm(source);
+  std::istringstream input("ABCDEF");
+  std::streambuf* saved_in = std::cin.rdbuf(input.rdbuf());
+  vm.run();
+  std::cin.rdbuf(saved_in);
+  EXPECT_EQ(vm.get_register(bc::R1), 0u);
+  EXPECT_EQ(vm.get_register(bc::R5), 0x44434241u);
+  EXPECT_EQ(vm.get_register(bc::R6), 0x2E2E4645u);  // "EF.."
+
+  // read(2) returns what the pipe holds instead of waiting for 8 bytes.
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  ASSERT_EQ(write(pipe_fds[1], "xyz", 3), 3);
+  int saved_stdin = dup(STDIN_FILENO);
+  dup2(pipe_fds[0], STDIN_FILENO);
+  std::uint8_t data[8] = {};
+  std::size_t received = bc::read_stdin(data, sizeof(data), true);
+  dup2(saved_stdin, STDIN_FILENO);
+  close(saved_stdin);
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  EXPECT_EQ(received, 3u);
+  EXPECT_EQ(std::string(reinterpret_cast<char*>(data), 3), "xyz");
+}
+
+TEST(HostIo, FilesStayInsideSandbox) {
+  std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "bytecraft_sandbox";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root / "sub");
+  std::ofstream(root.parent_path() / "bytecraft_outside.txt") << "secret";
+
+  bc::FileTable files;
+  EXPECT_EQ(files.open("sub/a.txt", bc::OPEN_WRITE | bc::OPEN_CREATE), -1);  // no root yet
+
+  std::string error_message;
+  EXPECT_FALSE(files.set_root((root / "missing").string(), error_message));
+  ASSERT_TRUE(files.set_root(root.string(), error_message)) << error_message;
+  EXPECT_EQ(files.open("../bytecraft_outside.txt", bc::OPEN_READ), -1);
+  EXPECT_EQ(files.open("sub/../../bytecraft_outside.txt", bc::OPEN_READ), -1);
+  EXPECT_EQ(files.open(".", bc::OPEN_READ), -1);
+  EXPECT_EQ(files.open("missing.txt", bc::OPEN_READ), -1);
+  EXPECT_EQ(files.close(3), -1);
+
+  EXPECT_EQ(files.open("/sub/a.txt", bc::OPEN_WRITE | bc::OPEN_CREATE), 3);
+  EXPECT_EQ(files.open("sub/b.txt", bc::OPEN_WRITE | bc::OPEN_CREATE), 4);
+  EXPECT_EQ(files.close(3), 0);
+  EXPECT_EQ(files.open("sub/c.txt", bc::OPEN_WRITE | bc::OPEN_CREATE), 3);
+  EXPECT_TRUE(std::filesystem::exists(root / "sub" / "a.txt"));
+
+  // Symlinks under the root that point outside it are not followed, not
+  // even to create or truncate the target.
+  std::filesystem::path outside = root.parent_path() / "bytecraft_outside_dir";
+  std::filesystem::remove_all(outside);
+  std::filesystem::create_directories(outside);
+  std::filesystem::create_directory_symlink(outside, root / "link");
+  std::filesystem::create_symlink(root.parent_path() / "bytecraft_outside.txt", root / "escape.txt");
+  EXPECT_EQ(files.open("link/new.txt", bc::OPEN_WRITE | bc::OPEN_CREATE), -1);
+  EXPECT_FALSE(std::filesystem::exists(outside / "new.txt"));
+  EXPECT_EQ(files.open("escape.txt", bc::OPEN_WRITE | bc::OPEN_TRUNCATE), -1);
+  EXPECT_EQ(std::filesystem::file_size(root.parent_path() / "bytecraft_outside.txt"), 6u);
+}
+
+TEST(HostIo, VmReadsWritesAndSeeksFiles) {
+  std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "bytecraft_vm_files";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+
+  // open(name, read|write|create) -> r6; write "abcd"; seek 1; read 2; close.
+  bc::VM vm = bc_test::make_vm(
+    "_main:\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 7\n"
+    "  syscall\n"
+    "  mov r6, r1\n"
+    "  mov r1, 1\n"
+    "  mov r2, r6\n"
+    "  mov r3, text\n"
+    "  mov r4, 4\n"
+    "  syscall\n"
+    "  mov r1, 6\n"
+    "  mov r2, r6\n"
+    "  mov r3, 1\n"
+    "  mov r4, 0\n"
+    "  syscall\n"
+    "  mov r7, r1\n"
+    "  mov r1, 2\n"
+    "  mov r2, r6\n"
+    "  mov r3, back\n"
+    "  mov r4, 2\n"
+    "  syscall\n"
+    "  mov r8, r1\n"
+    "  mov r5, [back]\n"
+    "  mov r1, 5\n"
+    "  mov r2, r6\n"
+    "  syscall\n"
+    "  mov r4, r1\n"
+    "  mov r1, 5\n"
+    "  mov r2, r6\n"
+    "  syscall\n"
+    "  mov r3, r1\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB name[9] = \"data.bin\"\n"
+    "  DB text[4] = \"abcd\"\n"
+    "  DB back[4]\n");
+  std::string error_message;
+  ASSERT_TRUE(vm.set_file_root(root.string(), error_message)) << error_message;
+  vm.run();
+
+  EXPECT_EQ(vm.get_register(bc::RF) & bc::F_BAD_INSTR, 0u);
+  EXPECT_EQ(vm.get_register(bc::R6), 3u);
+  EXPECT_EQ(vm.get_register(bc::R7), 1u);
+  EXPECT_EQ(vm.get_register(bc::R8), 2u);
+  EXPECT_EQ(vm.get_register(bc::R5), 0x00006362u);  // "bc"
+  EXPECT_EQ(vm.get_register(bc::R4), 0u);
+  EXPECT_EQ(vm.get_register(bc::R3), 0xFFFFFFFFu);  // second close
+  std::ifstream written(root / "data.bin");
+  std::string content;
+  std::getline(written, content);
+  EXPECT_EQ(content, "abcd");
+}
+
+TEST(HostIo, MappedFileIsGuestMemory) {
+  std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "bytecraft_vm_mmap";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  std::ofstream(root / "table.bin") << "wxyz0123";
+
+  // open(name, read) -> r6; mmap(r6, read-only, 0x10000) -> r7; load both
+  // words, write the second one to stdout, then store into the mapping.
+  const char* source =
+    "_main:\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 1\n"
+    "  syscall\n"
+    "  mov r6, r1\n"
+    "  mov r1, 7\n"
+    "  mov r2, r6\n"
+    "  mov r3, 0\n"
+    "  mov r4, 0x10000\n"
+    "  syscall\n"
+    "  mov r7, r1\n"
+    "  mov r5, [0x10000]\n"
+    "  mov r8, [0x10004]\n"
+    "  mov r1, 1\n"
+    "  mov r2, 1\n"
+    "  mov r3, 0x10004\n"
+    "  mov r4, 4\n"
+    "  syscall\n"
+    "  mov [0x10000], r8\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB name[10] = \"table.bin\"\n";
+
+  for (bc::Engine engine : {bc::Engine::Switch, bc::Engine::Predecoded, bc::Engine::Threaded,
+                            bc::Engine::Cached, bc::Engine::Jit, bc::Engine::Tiered}) {
+    SCOPED_TRACE(static_cast<int>(engine));
+    bc::VM vm = bc_test::make_vm(source);
+    vm.set_engine(engine);
+    std::string error_message;
+    ASSERT_TRUE(vm.set_file_root(root.string(), error_message)) << error_message;
+    CaptureStreams capture;
+    vm.run();
+
+    EXPECT_EQ(vm.get_register(bc::R7), 0x10000u);
+    EXPECT_EQ(vm.get_register(bc::R5), 0x7A797877u);  // "wxyz"
+    EXPECT_EQ(vm.get_register(bc::R8), 0x33323130u);  // "0123"
+    EXPECT_EQ(capture.out(), "0123");
+    EXPECT_NE(vm.get_register(bc::RF) & bc::F_WRITE_OOB, 0u);  // read-only mapping
+  }
+}
+
+TEST(HostIo, TruncatedMappingFaultsInsteadOfCrashing) {
+  std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "bytecraft_vm_mmap_trunc";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+
+  // open("t.bin", read); mmap it at 0x10000 with the flags in r7; load;
+  // reopen it write|truncate; load again.
+  const char* source =
+    "_main:\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 1\n"
+    "  syscall\n"
+    "  mov r2, r1\n"
+    "  mov r1, 7\n"
+    "  mov r3, r7\n"
+    "  mov r4, 0x10000\n"
+    "  syscall\n"
+    "  mov r4, [0x10000]\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 10\n"
+    "  syscall\n"
+    "  mov r6, r1\n"
+    "  mov r5, [0x10000]\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB name[6] = \"t.bin\"\n";
+
+  for (bc::Engine engine : {bc::Engine::Switch, bc::Engine::Jit}) {
+    for (std::uint32_t flags : {0u, std::uint32_t{bc::MMAP_COPY_ON_WRITE}, std::uint32_t{bc::MMAP_SNAPSHOT}}) {
+      SCOPED_TRACE(static_cast<int>(engine) * 10 + static_cast<int>(flags));
+      std::ofstream(root / "t.bin") << "wxyz0123";
+      bc::VM vm = bc_test::make_vm(source);
+      vm.set_engine(engine);
+      vm.set_register(bc::R7, flags);
+      std::string error_message;
+      ASSERT_TRUE(vm.set_file_root(root.string(), error_message)) << error_message;
+      vm.run();
+
+      EXPECT_EQ(vm.get_register(bc::R4), 0x7A797877u);
+      EXPECT_EQ(vm.get_register(bc::R6), 4u);
+      EXPECT_EQ(std::filesystem::file_size(root / "t.bin"), 0u);
+      if (flags == bc::MMAP_SNAPSHOT) {
+        EXPECT_EQ(vm.get_register(bc::RF) & bc::F_READ_OOB, 0u);
+        EXPECT_EQ(vm.get_register(bc::R5), 0x7A797877u);  // copied at mmap
+      } else {
+        EXPECT_NE(vm.get_register(bc::RF) & bc::F_READ_OOB, 0u);
+        EXPECT_EQ(vm.get_register(bc::R5), 0u);
+      }
+    }
+  }
+}
+
+TEST(HostIo, SharedMappingSeesFileWrites) {
+  std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "bytecraft_vm_mmap_shared";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  std::ofstream(root / "s.bin") << "wxyz";
+
+  // mmap s.bin read-only at 0x10000, then overwrite it through a second fd.
+  const char* source =
+    "_main:\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 1\n"
+    "  syscall\n"
+    "  mov r2, r1\n"
+    "  mov r1, 7\n"
+    "  mov r3, 0\n"
+    "  mov r4, 0x10000\n"
+    "  syscall\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 2\n"
+    "  syscall\n"
+    "  mov r2, r1\n"
+    "  mov r1, 1\n"
+    "  mov r3, text\n"
+    "  mov r4, 4\n"
+    "  syscall\n"
+    "  mov r5, [0x10000]\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB name[6] = \"s.bin\"\n"
+    "  DB text[4] = \"WXYZ\"\n";
+
+  bc::VM vm = bc_test::make_vm(source);
+  std::string error_message;
+  ASSERT_TRUE(vm.set_file_root(root.string(), error_message)) << error_message;
+  vm.run();
+  EXPECT_EQ(vm.get_register(bc::RF) & (bc::F_READ_OOB | bc::F_BAD_INSTR), 0u);
+  EXPECT_EQ(vm.get_register(bc::R5), 0x5A595857u);
+}
+
+TEST(HostIo, CopyOnWriteMappingKeepsFile) {
+  std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "bytecraft_vm_mmap_cow";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  std::ofstream(root / "table.bin") << "wxyz";
+
+  // Two copy-on-write mappings of the same file at VM-chosen addresses
+  // (r6, r7); a third one at the address of the second fails (r8).
+  bc::VM vm = bc_test::make_vm(
+    "_main:\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 1\n"
+    "  syscall\n"
+    "  mov r5, r1\n"
+    "  mov r1, 7\n"
+    "  mov r2, r5\n"
+    "  mov r3, 1\n"
+    "  mov r4, 0\n"
+    "  syscall\n"
+    "  mov r6, r1\n"
+    "  mov r1, 7\n"
+    "  mov r2, r5\n"
+    "  mov r3, 1\n"
+    "  mov r4, 0\n"
+    "  syscall\n"
+    "  mov r7, r1\n"
+    "  mov r1, 7\n"
+    "  mov r2, r5\n"
+    "  mov r3, 0\n"
+    "  mov r4, 0x2000\n"
+    "  syscall\n"
+    "  mov r8, r1\n"
+    "  mov [0x1000], 0x21212121\n"
+    "  mov r5, [0x1000]\n"
+    "  mov r4, [0x2000]\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB name[10] = \"table.bin\"\n");
+  std::string error_message;
+  ASSERT_TRUE(vm.set_file_root(root.string(), error_message)) << error_message;
+  vm.run();
+
+  EXPECT_EQ(vm.get_register(bc::RF) & (bc::F_READ_OOB | bc::F_WRITE_OOB), 0u);
+  EXPECT_EQ(vm.get_register(bc::R6), 0x1000u);
+  EXPECT_EQ(vm.get_register(bc::R7), 0x2000u);
+  EXPECT_EQ(vm.get_register(bc::R8), 0xFFFFFFFFu);
+  EXPECT_EQ(vm.get_register(bc::R5), 0x21212121u);
+  EXPECT_EQ(vm.get_register(bc::R4), 0x7A797877u);  // second mapping untouched
+  std::ifstream file(root / "table.bin");
+  std::string content;
+  std::getline(file, content);
+  EXPECT_EQ(content, "wxyz");
+}
+
+TEST(HostIo, VectoredWriteAndRead) {
+  // writev(1, [hello, space, world]) -> r6; readv(0, [first, second]) -> r7;
+  // writev with IOVEC_MAX + 1 pairs -> r8.
+  const char* source =
+    "_main:\n"
+    "  mov [w0], hello\n"
+    "  mov [w1], space\n"
+    "  mov [w2], world\n"
+    "  mov r1, 8\n"
+    "  mov r2, 1\n"
+    "  mov r3, w0\n"
+    "  mov r4, 3\n"
+    "  syscall\n"
+    "  mov r6, r1\n"
+    "  mov [q0], first\n"
+    "  mov [q1], second\n"
+    "  mov r1, 9\n"
+    "  mov r2, 0\n"
+    "  mov r3, q0\n"
+    "  mov r4, 2\n"
+    "  syscall\n"
+    "  mov r7, r1\n"
+    "  mov r5, [second]\n"
+    "  mov r1, 8\n"
+    "  mov r2, 1\n"
+    "  mov r3, w0\n"
+    "  mov r4, 1025\n"
+    "  syscall\n"
+    "  mov r8, r1\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB hello[5] = \"hello\"\n"
+    "  DB space[1] = \" \"\n"
+    "  DB world[5] = \"world\"\n"
+    "  DB w0[4]\n"
+    "  DB w0_length[4] = { 5, 0, 0, 0 }\n"
+    "  DB w1[4]\n"
+    "  DB w1_length[4] = { 1, 0, 0, 0 }\n"
+    "  DB w2[4]\n"
+    "  DB w2_length[4] = { 5, 0, 0, 0 }\n"
+    "  DB q0[4]\n"
+    "  DB q0_length[4] = { 2, 0, 0, 0 }\n"
+    "  DB q1[4]\n"
+    "  DB q1_length[4] = { 4, 0, 0, 0 }\n"
+    "  DB first[2]\n"
+    "  DB second[4] = \"....\"\n";
+
+  for (bc::Engine engine : {bc::Engine::Switch, bc::Engine::Tiered}) {
+    SCOPED_TRACE(static_cast<int>(engine));
+    bc::VM vm = bc_test::make_vm(source);
+    vm.set_engine(engine);
+    std::istringstream input("ABCDE");
+    std::streambuf* saved_in = std::cin.rdbuf(input.rdbuf());
+    {
+      CaptureStreams capture;
+      vm.run();
+      EXPECT_EQ(capture.out(), "hello world");
+    }
+    std::cin.rdbuf(saved_in);
+
+    EXPECT_EQ(vm.get_register(bc::RF) & (bc::F_READ_OOB | bc::F_WRITE_OOB), 0u);
+    EXPECT_EQ(vm.get_register(bc::R6), 11u);
+    EXPECT_EQ(vm.get_register(bc::R7), 5u);
+    EXPECT_EQ(vm.get_register(bc::R5), 0x2E454443u);  // "CDE."
+    EXPECT_EQ(vm.get_register(bc::R8), 0xFFFFFFFFu);
+  }
+}
+
+TEST(HostIo, VectoredIoChecksEveryPairFirst) {
+  std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "bytecraft_vm_writev";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+
+  // writev(file, [text, past the end]) faults before anything is written.
+  bc::VM vm = bc_test::make_vm(
+    "_main:\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 6\n"
+    "  syscall\n"
+    "  mov r2, r1\n"
+    "  mov [p0], text\n"
+    "  mov r1, 8\n"
+    "  mov r3, p0\n"
+    "  mov r4, 2\n"
+    "  syscall\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB name[6] = \"v.txt\"\n"
+    "  DB text[4] = \"abcd\"\n"
+    "  DB p0[4]\n"
+    "  DB p0_length[4] = { 4, 0, 0, 0 }\n"
+    "  DB p1[4] = { 0, 0, 0, 0x7F }\n"
+    "  DB p1_length[4] = { 4, 0, 0, 0 }\n");
+  std::string error_message;
+  ASSERT_TRUE(vm.set_file_root(root.string(), error_message)) << error_message;
+  vm.run();
+
+  EXPECT_NE(vm.get_register(bc::RF) & bc::F_READ_OOB, 0u);
+  EXPECT_EQ(std::filesystem::file_size(root / "v.txt"), 0u);
+
+  // The host side gathers segments into one writev(2).
+  char a[] = "ab";
+  char b[] = "cde";
+  iovec segments[] = {{a, 2}, {b, 3}};
+  bc::FileTable files;
+  ASSERT_TRUE(files.set_root(root.string(), error_message)) << error_message;
+  std::int64_t fd = files.open("out.bin", bc::OPEN_WRITE | bc::OPEN_CREATE);
+  ASSERT_GE(fd, 3);
+  EXPECT_EQ(files.writev(static_cast<std::uint32_t>(fd), segments, 2), 5);
+  std::ifstream written(root / "out.bin");
+  std::string content;
+  std::getline(written, content);
+  EXPECT_EQ(content, "abcde");
+}
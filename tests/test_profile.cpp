@@ -0,0 +1,140 @@
+// test_profile.cpp:
+//    Code labels survive the BVM round trip and samples land on the hot label.
+//
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/bytecode.hpp"
+#include "bytecraft/profile.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+// hot runs 4 * 2000 instructions, cold 4 * 20.
+const char* const PROFILE_SOURCE =
+  "_main:\n"
+  "  mov r1, 0\n"
+  "hot:\n"
+  "  add r1, 1\n"
+  "  xor r2, r1\n"
+  "  cmp r1, 2000\n"
+  "  jneq hot\n"
+  "  mov r1, 0\n"
+  "cold:\n"
+  "  add r1, 1\n"
+  "  xor r2, r1\n"
+  "  cmp r1, 20\n"
+  "  jneq cold\n"
+  "  mov r1, 0\n"
+  "  syscall\n";
+
+}  // namespace
+
+TEST(Profile, SymbolsSurviveSaveAndLoad) {
+  bc::Module module = bc_test::assemble(PROFILE_SOURCE);
+  ASSERT_EQ(module.code_symbols.size(), 2u);
+  EXPECT_EQ(module.code_symbols[0].name, "hot");
+  EXPECT_EQ(module.code_symbols[0].address, 7u);
+  EXPECT_EQ(module.code_symbols[1].name, "cold");
+
+  std::string path = ::testing::TempDir() + "bytecraft_symbols.bvm";
+  std::string error_message;
+  ASSERT_TRUE(bc::save_bvm(path, module, error_message)) << error_message;
+
+  bc::Module loaded;
+  ASSERT_TRUE(bc::load_bvm(path, loaded, error_message)) << error_message;
+  EXPECT_EQ(loaded.code_section, module.code_section);
+  ASSERT_EQ(loaded.code_symbols.size(), 2u);
+  EXPECT_EQ(loaded.code_symbols[1].name, "cold");
+  EXPECT_EQ(loaded.code_symbols[1].address, module.code_symbols[1].address);
+}
+
+TEST(Profile, LoadSkipsUnknownTables) {
+  bc::Module module = bc_test::assemble(PROFILE_SOURCE);
+  std::string path = ::testing::TempDir() + "bytecraft_future.bvm";
+  std::string error_message;
+  ASSERT_TRUE(bc::save_bvm(path, module, error_message)) << error_message;
+  {
+    // A table from a newer writer: magic, byte length, payload.
+    std::ofstream output_file(path, std::ios::binary | std::ios::app);
+    const char future_table[] = {'B', 'X', 'Y', 'Z', 3, 0, 0, 0, 'a', 'b', 'c'};
+    output_file.write(future_table, sizeof(future_table));
+  }
+
+  bc::Module loaded;
+  ASSERT_TRUE(bc::load_bvm(path, loaded, error_message)) << error_message;
+  ASSERT_EQ(loaded.code_symbols.size(), 2u);
+  EXPECT_EQ(loaded.line_table.size(), module.line_table.size());
+
+  {
+    // Claims more bytes than the file holds.
+    std::ofstream output_file(path, std::ios::binary | std::ios::app);
+    const char cut_table[] = {'B', 'X', 'Y', 'Z', 9, 0, 0, 0, 'a'};
+    output_file.write(cut_table, sizeof(cut_table));
+  }
+  EXPECT_FALSE(bc::load_bvm(path, loaded, error_message));
+  EXPECT_EQ(error_message, "truncated table");
+}
+
+TEST(Profile, LoadRejectsUnsortedTables) {
+  bc::Module module = bc_test::assemble(PROFILE_SOURCE);
+  std::swap(module.code_symbols[0], module.code_symbols[1]);
+
+  std::string path = ::testing::TempDir() + "bytecraft_unsorted.bvm";
+  std::string error_message;
+  ASSERT_TRUE(bc::save_bvm(path, module, error_message)) << error_message;
+  bc::Module loaded;
+  EXPECT_FALSE(bc::load_bvm(path, loaded, error_message));
+  EXPECT_EQ(error_message, "unsorted symbol table");
+
+  module = bc_test::assemble(PROFILE_SOURCE);
+  ASSERT_GE(module.line_table.size(), 2u);
+  std::swap(module.line_table.front(), module.line_table.back());
+  ASSERT_TRUE(bc::save_bvm(path, module, error_message)) << error_message;
+  EXPECT_FALSE(bc::load_bvm(path, loaded, error_message));
+  EXPECT_EQ(error_message, "unsorted line table");
+}
+
+TEST(Profile, SamplesLandOnHotLabel) {
+  bc::Module module = bc_test::assemble(PROFILE_SOURCE);
+  for (bc::Engine engine : {bc::Engine::Switch, bc::Engine::Jit, bc::Engine::Tiered}) {
+    bc::VM vm = bc_test::make_vm(module);
+    vm.set_engine(engine);
+
+    bc::SamplingProfiler profiler(module.code_symbols);
+    EXPECT_EQ(profiler.run(vm, 40), bc::RunStatus::Halted);
+    EXPECT_EQ(vm.get_register(bc::R1), 0u);
+
+    std::ostringstream folded;
+    profiler.write_folded(folded);
+    EXPECT_GE(profiler.sample_count(), 150u) << bc::engine_name(engine);
+
+    std::uint64_t hot_samples = 0;
+    std::istringstream lines(folded.str());
+    std::string frame;
+    std::uint64_t count = 0;
+    while (lines >> frame >> count) {
+      if (frame == "hot") {
+        hot_samples = count;
+      }
+    }
+    EXPECT_GE(hot_samples * 10, profiler.sample_count() * 9) << folded.str();
+  }
+}
+
+TEST(Profile, CodeBeforeFirstLabelIsMain) {
+  bc::SamplingProfiler profiler({{"loop", 10}});
+  profiler.sample(3);
+  profiler.sample(10);
+  profiler.sample(12);
+
+  std::ostringstream folded;
+  profiler.write_folded(folded);
+  EXPECT_EQ(folded.str(), "_main 1\nloop 2\n");
+}
@@ -0,0 +1,162 @@
+// test_replay.cpp:
+//    A recorded run replays without stdin or stdout, and stops on divergence.
+//
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+// Reads up to 8 bytes, echoes them, then exits.
+const char* const ECHO_SOURCE =
+  "_main:\n"
+  "  mov r1, 2\n"
+  "  mov r2, 0\n"
+  "  mov r3, buffer\n"
+  "  mov r4, 8\n"
+  "  syscall\n"
+  "  mov r6, r1\n"
+  "  mov r5, [buffer]\n"
+  "  mov r1, 1\n"
+  "  mov r2, 1\n"
+  "  mov r3, buffer\n"
+  "  mov r4, r6\n"
+  "  syscall\n"
+  "  mov r1, 0\n"
+  "  syscall\n"
+  "_data:\n"
+  "  DB buffer[8]\n";
+
+// Runs @p vm with the given stdin and returns what it printed to stdout.
+std::string run_with_io(bc::VM& vm, const std::string& input_text) {
+  std::istringstream input(input_text);
+  std::ostringstream output;
+  std::streambuf* saved_in = std::cin.rdbuf(input.rdbuf());
+  std::streambuf* saved_out = std::cout.rdbuf(output.rdbuf());
+  vm.run();
+  std::cin.rdbuf(saved_in);
+  std::cout.rdbuf(saved_out);
+  return output.str();
+}
+
+}  // namespace
+
+TEST(Replay, ReplaysInputWithoutRealIo) {
+  std::string log_path = ::testing::TempDir() + "bytecraft_echo.log";
+  std::string error_message;
+  {
+    bc::VM vm = bc_test::make_vm(ECHO_SOURCE);
+    ASSERT_TRUE(vm.set_syscall_record(log_path, error_message)) << error_message;
+    EXPECT_EQ(run_with_io(vm, "ABCDE"), "ABCDE");
+    EXPECT_EQ(vm.get_register(bc::R5), 0x44434241u);
+  }
+
+  bc::VM vm = bc_test::make_vm(ECHO_SOURCE);
+  vm.set_engine(bc::Engine::Tiered);
+  ASSERT_TRUE(vm.set_syscall_replay(log_path, error_message)) << error_message;
+  EXPECT_EQ(run_with_io(vm, "zzzzzzzz"), "");
+  EXPECT_EQ(vm.get_register(bc::R6), 5u);
+  EXPECT_EQ(vm.get_register(bc::R5), 0x44434241u);
+  EXPECT_EQ(vm.get_register(bc::R1), 0u);
+  EXPECT_EQ(vm.get_register(bc::RF) & bc::F_BAD_INSTR, 0u);
+  ASSERT_NE(vm.syscall_log(), nullptr);
+  EXPECT_FALSE(vm.syscall_log()->diverged());
+}
+
+TEST(Replay, StopsWhenProgramDiverges) {
+  std::string log_path = ::testing::TempDir() + "bytecraft_diverge.log";
+  std::string error_message;
+  {
+    bc::VM vm = bc_test::make_vm(ECHO_SOURCE);
+    ASSERT_TRUE(vm.set_syscall_record(log_path, error_message)) << error_message;
+    run_with_io(vm, "hi");
+  }
+
+  // Writes first where the recording read first.
+  bc::VM vm = bc_test::make_vm(
+    "_main:\n"
+    "  mov r1, 1\n"
+    "  mov r2, 1\n"
+    "  mov r3, 0\n"
+    "  mov r4, 1\n"
+    "  syscall\n"
+    "  mov r1, 0\n"
+    "  syscall\n");
+  ASSERT_TRUE(vm.set_syscall_replay(log_path, error_message)) << error_message;
+  EXPECT_EQ(run_with_io(vm, ""), "");
+  EXPECT_NE(vm.get_register(bc::RF) & bc::F_BAD_INSTR, 0u);
+  EXPECT_TRUE(vm.syscall_log()->diverged());
+}
+
+TEST(Replay, RejectsMissingOrForeignLog) {
+  bc::VM vm = bc_test::make_vm(ECHO_SOURCE);
+  std::string error_message;
+  EXPECT_FALSE(vm.set_syscall_replay(::testing::TempDir() + "bytecraft_missing.log", error_message));
+  EXPECT_EQ(vm.syscall_log(), nullptr);
+
+  std::string trace_path = ::testing::TempDir() + "bytecraft_not_a_log.trace";
+  ASSERT_TRUE(vm.set_trace_file(trace_path, error_message)) << error_message;
+  EXPECT_FALSE(vm.set_syscall_replay(trace_path, error_message));
+  EXPECT_EQ(error_message, "not a syscall log");
+
+  // An entry claiming 4 GiB of data is rejected without allocating it.
+  std::string corrupt_path = ::testing::TempDir() + "bytecraft_corrupt.log";
+  {
+    std::ofstream corrupt(corrupt_path, std::ios::binary);
+    const unsigned char bytes[] = {'B', 'C', 'R', 'L', 1, 0, 0, 0,
+                                   2, 0, 0, 0, 5, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 'A', 'B'};
+    corrupt.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+  }
+  EXPECT_FALSE(vm.set_syscall_replay(corrupt_path, error_message));
+  EXPECT_EQ(error_message, "truncated syscall log");
+}
+
+TEST(Replay, ReplaysMappedFileWithoutSandbox) {
+  std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "bytecraft_replay_mmap";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  std::ofstream(root / "m.bin") << "mmap";
+  std::string log_path = ::testing::TempDir() + "bytecraft_mmap.log";
+
+  // open("m.bin", read); mmap it read-only at 0x8000; load the first word.
+  const char* source =
+    "_main:\n"
+    "  mov r1, 3\n"
+    "  mov r2, name\n"
+    "  mov r3, 1\n"
+    "  syscall\n"
+    "  mov r2, r1\n"
+    "  mov r1, 7\n"
+    "  mov r3, 0\n"
+    "  mov r4, 0x8000\n"
+    "  syscall\n"
+    "  mov r5, [0x8000]\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB name[6] = \"m.bin\"\n";
+
+  std::string error_message;
+  {
+    bc::VM vm = bc_test::make_vm(source);
+    ASSERT_TRUE(vm.set_file_root(root.string(), error_message)) << error_message;
+    ASSERT_TRUE(vm.set_syscall_record(log_path, error_message)) << error_message;
+    vm.run();
+    EXPECT_EQ(vm.get_register(bc::R5), 0x70616D6Du);  // "mmap"
+  }
+  std::filesystem::remove_all(root);
+
+  bc::VM vm = bc_test::make_vm(source);
+  ASSERT_TRUE(vm.set_syscall_replay(log_path, error_message)) << error_message;
+  vm.run();
+  EXPECT_EQ(vm.get_register(bc::RF) & (bc::F_BAD_INSTR | bc::F_READ_OOB), 0u);
+  EXPECT_EQ(vm.get_register(bc::R5), 0x70616D6Du);
+}
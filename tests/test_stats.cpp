@@ -0,0 +1,88 @@
+// test_stats.cpp:
+//    Execution statistics must count exactly what the program executed.
+//
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/stats.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+// 2 + 10 * 6 + 2 instructions; the jneq sits at IP 49.
+const char* const LOOP_SOURCE =
+  "_main:\n"
+  "  mov r1, 0\n"
+  "  mov [cell], 0\n"
+  "loop:\n"
+  "  add r1, 1\n"
+  "  mov r2, [cell]\n"
+  "  add r2, r1\n"
+  "  mov [cell], r2\n"
+  "  cmp r1, 10\n"
+  "  jneq loop\n"
+  "  mov r1, 0\n"
+  "  syscall\n"
+  "_data:\n"
+  "  DB cell[4]\n";
+
+}  // namespace
+
+TEST(Stats, CountsLoop) {
+  bc::VM vm = bc_test::make_vm(LOOP_SOURCE);
+  vm.set_stats(true);
+  vm.run();
+
+  const bc::ExecStats* stats = vm.stats();
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->counter(bc::ExecStats::INSTRUCTION_SLOT), 64u);
+  EXPECT_EQ(stats->counter(bc::ExecStats::OPCODE_SLOTS + bc::OP_ADD), 20u);
+  EXPECT_EQ(stats->counter(bc::ExecStats::OPCODE_SLOTS + bc::OP_MOV), 23u);
+  EXPECT_EQ(stats->counter(bc::ExecStats::OPCODE_SLOTS + bc::OP_SYSCALL), 1u);
+  EXPECT_EQ(stats->counter(bc::ExecStats::MODE_SLOTS + ((bc::OT_REG << 4) | bc::OT_IMM)), 22u);
+  EXPECT_EQ(stats->counter(bc::ExecStats::SYSCALL_SLOTS + bc::SC_EXIT), 1u);
+  EXPECT_EQ(stats->counter(bc::ExecStats::LOAD_SLOT), 10u);
+  EXPECT_EQ(stats->counter(bc::ExecStats::STORE_SLOT), 11u);
+  EXPECT_EQ(stats->branch_count(49, true), 9u);
+  EXPECT_EQ(stats->branch_count(49, false), 1u);
+  EXPECT_EQ(vm.get_register(bc::R2), 55u);
+}
+
+TEST(Stats, SameCountsOnEveryEngine) {
+  bc::VM reference = bc_test::make_vm(LOOP_SOURCE);
+  reference.set_stats(true);
+  reference.run();
+
+  for (bc::Engine engine : {bc::Engine::Threaded, bc::Engine::Jit, bc::Engine::Tiered}) {
+    bc::VM vm = bc_test::make_vm(LOOP_SOURCE);
+    vm.set_engine(engine);
+    vm.set_stats(true);
+    vm.run();
+
+    for (std::size_t slot = 0; slot < bc::ExecStats::SLOT_COUNT; slot += 1) {
+      EXPECT_EQ(vm.stats()->counter(slot), reference.stats()->counter(slot))
+          << bc::engine_name(engine) << " slot " << slot;
+    }
+  }
+}
+
+TEST(Stats, JsonAndDisabled) {
+  bc::VM vm = bc_test::make_vm(LOOP_SOURCE);
+  EXPECT_EQ(vm.stats(), nullptr);
+
+  vm.set_stats(true);
+  vm.run();
+
+  std::ostringstream json;
+  vm.stats()->write_json(json);
+  EXPECT_NE(json.str().find("\"instructions\":64"), std::string::npos) << json.str();
+  EXPECT_NE(json.str().find("\"syscalls\":{\"0\":1}"), std::string::npos) << json.str();
+  EXPECT_NE(json.str().find("{\"ip\":49,\"taken\":9,\"not_taken\":1}"), std::string::npos) << json.str();
+
+  vm.set_stats(false);
+  EXPECT_EQ(vm.stats(), nullptr);
+}
@@ -0,0 +1,110 @@
+// test_trace.cpp:
+//    Binary trace files must render exactly like the stdout trace.
+//
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/trace.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+/**
+ * @brief Run @p source with stdout tracing and return what was printed.
+ */
+std::string stdout_trace(const char* source) {
+  bc::VM vm = bc_test::make_vm(source);
+  vm.set_tracing(true);
+  std::ostringstream captured;
+  std::streambuf* saved = std::cout.rdbuf(captured.rdbuf());
+  vm.run();
+  std::cout.rdbuf(saved);
+  return captured.str();
+}
+
+/**
+ * @brief Run @p source with a binary trace file and return it rendered by dump_trace().
+ */
+std::string file_trace(const char* source, const std::string& path) {
+  {
+    bc::VM vm = bc_test::make_vm(source);
+    std::string error_message;
+    EXPECT_TRUE(vm.set_trace_file(path, error_message)) << error_message;
+    vm.run();
+    EXPECT_TRUE(vm.close_trace_file(error_message)) << error_message;
+  }
+
+  std::ostringstream rendered;
+  std::string error_message;
+  EXPECT_TRUE(bc::dump_trace(path, rendered, error_message)) << error_message;
+  return rendered.str();
+}
+
+}  // namespace
+
+TEST(Trace, FileRendersLikeStdout) {
+  const char* source =
+    "_main:\n"
+    "  mov r1, 0xFFFFFFFF\n"
+    "  mov rS, 1\n"
+    "  cmp r1, 1\n"
+    "  jle done\n"
+    "  mov r8, 1\n"
+    "done:\n"
+    "  mov [cell], r1\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB cell[4]\n";
+
+  std::string expected = stdout_trace(source);
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(file_trace(source, ::testing::TempDir() + "bytecraft_small.trace"), expected);
+}
+
+TEST(Trace, LongTraceWrapsRing) {
+  // About 100k records, several times the ring capacity.
+  const char* source =
+    "_main:\n"
+    "  mov r1, 0\n"
+    "loop:\n"
+    "  add r1, 1\n"
+    "  cmp r1, 33000\n"
+    "  jneq loop\n"
+    "  mov r1, 0\n"
+    "  syscall\n";
+
+  std::string expected = stdout_trace(source);
+  std::string actual = file_trace(source, ::testing::TempDir() + "bytecraft_long.trace");
+  EXPECT_EQ(actual.size(), expected.size());
+  EXPECT_TRUE(actual == expected);
+}
+
+TEST(Trace, ReportsWriteErrors) {
+  if (!std::filesystem::exists("/dev/full")) {
+    GTEST_SKIP() << "no /dev/full";
+  }
+  // Every write to /dev/full fails with ENOSPC, like a full disk.
+  bc::VM vm = bc_test::make_vm(
+    "_main:\n"
+    "  mov r1, 0\n"
+    "  syscall\n");
+  std::string error_message;
+  ASSERT_TRUE(vm.set_trace_file("/dev/full", error_message)) << error_message;
+  vm.run();
+  EXPECT_FALSE(vm.close_trace_file(error_message));
+  EXPECT_EQ(error_message, "cannot write trace file (trace is incomplete)");
+}
+
+TEST(Trace, RejectsOtherFiles) {
+  std::ostringstream rendered;
+  std::string error_message;
+  EXPECT_FALSE(bc::dump_trace(::testing::TempDir() + "bytecraft_missing.trace", rendered, error_message));
+  EXPECT_FALSE(error_message.empty());
+}
@@ -0,0 +1,46 @@
+// test_util.hpp:
+//    Helpers shared by the test files: assembling a source string and
+//    building an untraced VM around it.
+//
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/bytecode.hpp"
+#include "bytecraft/vm.hpp"
+
+namespace bc_test {
+
+/**
+ * @brief Assemble @p source, failing the current test if it does not assemble.
+ */
+inline bc::Module assemble(const std::string& source) {
+  bc::Assembler assembler;
+  bc::Module module;
+  std::string error_message;
+  bool ok = assembler.assemble_string(source, module, error_message);
+  EXPECT_TRUE(ok) << "Assembly failed: " << error_message;
+  return module;
+}
+
+/**
+ * @brief Build a VM around @p module with stdout tracing off.
+ */
+inline bc::VM make_vm(const bc::Module& module) {
+  bc::VM vm(module);
+  vm.set_tracing(false);
+  return vm;
+}
+
+/**
+ * @brief Assemble @p source and build a VM around the resulting module.
+ */
+inline bc::VM make_vm(const std::string& source) {
+  return make_vm(assemble(source));
+}
+
+}  // namespace bc_test
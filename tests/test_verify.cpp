@@ -0,0 +1,129 @@
+// test_verify.cpp:
+//    Load-time verifier and the unchecked switch-engine path.
+//
+
+#include <gtest/gtest.h>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/verify.hpp"
+#include "bytecraft/vm.hpp"
+
+namespace {
+
+/**
+ * @brief Assemble @p source into a module, failing the test on error.
+ */
+bc::Module assemble(const char* source) {
+  bc::Assembler assembler;
+  bc::Module module;
+  std::string error_message;
+  EXPECT_TRUE(assembler.assemble_string(source, module, error_message))
+      << "Assembly failed: " << error_message;
+  return module;
+}
+
+/**
+ * @brief Run @p source with and without verification and compare every register.
+ */
+void run_verified_and_compare(const char* source) {
+  bc::Module module = assemble(source);
+  std::vector<std::uint8_t> memory_image = module.code_section;
+  memory_image.insert(memory_image.end(), module.data_section.begin(), module.data_section.end());
+  std::uint32_t code_size = static_cast<std::uint32_t>(module.code_section.size());
+  std::uint32_t data_size = static_cast<std::uint32_t>(module.data_section.size());
+
+  bc::VM reference(memory_image, module.entry_point, code_size, data_size);
+  reference.set_tracing(false);
+  reference.run();
+
+  bc::VM vm(memory_image, module.entry_point, code_size, data_size);
+  vm.set_tracing(false);
+  std::string error_message;
+  ASSERT_TRUE(vm.verify(error_message)) << error_message;
+  vm.run();
+
+  for (std::uint8_t reg = 0; reg < bc::REG_COUNT; reg += 1) {
+    EXPECT_EQ(vm.get_register(static_cast<bc::Register>(reg)),
+              reference.get_register(static_cast<bc::Register>(reg)))
+        << "register " << bc::register_name(reg);
+  }
+}
+
+}  // namespace
+
+TEST(Verifier, AcceptsAssembledProgramAndMarksBoundaries) {
+  bc::Module module = assemble(
+    "_main:\n"
+    "  mov r1, 5\n"
+    "loop:\n"
+    "  sub r1, 1\n"
+    "  cmp r1, 0\n"
+    "  jneq loop\n"
+    "  syscall\n");
+
+  std::vector<std::uint8_t> boundaries;
+  std::string error_message;
+  ASSERT_TRUE(bc::verify_code(module.code_section.data(),
+                              static_cast<std::uint32_t>(module.code_section.size()),
+                              boundaries, error_message)) << error_message;
+
+  ASSERT_EQ(boundaries.size(), module.code_section.size());
+  EXPECT_EQ(boundaries[0], 1u);
+  EXPECT_EQ(boundaries[1], 0u);
+  EXPECT_EQ(boundaries[7], 1u);
+  EXPECT_EQ(boundaries.back(), 1u);
+}
+
+TEST(Verifier, RejectsMalformedCode) {
+  std::vector<std::uint8_t> boundaries;
+  std::string error_message;
+
+  // jmp 1: the target is inside the jmp itself.
+  bc::Module misaligned = assemble("_main:\n  jmp 1\n");
+  EXPECT_FALSE(bc::verify_code(misaligned.code_section.data(),
+                               static_cast<std::uint32_t>(misaligned.code_section.size()),
+                               boundaries, error_message));
+  EXPECT_NE(error_message.find("boundary"), std::string::npos);
+
+  // mov r?, 1 with register index 0x20.
+  const std::uint8_t bad_register[] = {bc::OP_MOV, 0x12, 0x20, 1, 0, 0, 0};
+  EXPECT_FALSE(bc::verify_code(bad_register, sizeof(bad_register), boundaries, error_message));
+
+  // mov r1, imm32 cut off after two immediate bytes.
+  const std::uint8_t truncated[] = {bc::OP_MOV, 0x12, bc::R1, 1, 0};
+  EXPECT_FALSE(bc::verify_code(truncated, sizeof(truncated), boundaries, error_message));
+}
+
+TEST(Verifier, IndirectJumpIntoInstructionStaysChecked) {
+  // "mov r2, 0x0B000000" at offset 7: its last immediate byte (offset 13) is
+  // 0x0B, a syscall opcode, and r1 is 0 there, so the landing exits cleanly.
+  run_verified_and_compare(
+    "_main:\n"
+    "  mov r5, 13\n"
+    "  mov r2, 0x0B000000\n"
+    "  mov r1, 0\n"
+    "  jmp r5\n");
+
+  // Jumping past the end of code must still fault.
+  run_verified_and_compare(
+    "_main:\n"
+    "  mov r5, 0x1000\n"
+    "  jmp r5\n");
+}
+
+TEST(Verifier, CodeWriteFallsBackToCheckedPath) {
+  // Overwrite the "mov r2, 1" immediate at offset 10, then rerun it.
+  run_verified_and_compare(
+    "_main:\n"
+    "  mov r3, 0\n"
+    "top:\n"
+    "  mov r2, 1\n"
+    "  add r3, r2\n"
+    "  cmp r3, 1\n"
+    "  jneq done\n"
+    "  mov [10], 5\n"
+    "  jmp top\n"
+    "done:\n"
+    "  mov r1, 0\n"
+    "  syscall\n");
+}
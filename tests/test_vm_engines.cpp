@@ -0,0 +1,299 @@
+// test_vm_engines.cpp:
+//    Differential tests: every engine must leave the same architectural
+//    state as the byte-at-a-time switch interpreter.
+//
+
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <sstream>
+
+#include "bytecraft/asm.hpp"
+#include "bytecraft/vm.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+/**
+ * @brief Run @p source on @p engine and compare every register with the switch engine.
+ */
+bc::VM run_and_compare(const char* source, bc::Engine engine) {
+  bc::VM reference = bc_test::make_vm(source);
+  reference.run();
+
+  bc::VM vm = bc_test::make_vm(source);
+  vm.set_engine(engine);
+  vm.run();
+
+  for (std::uint8_t reg = 0; reg < bc::REG_COUNT; reg += 1) {
+    EXPECT_EQ(vm.get_register(static_cast<bc::Register>(reg)),
+              reference.get_register(static_cast<bc::Register>(reg)))
+        << "register " << bc::register_name(reg);
+  }
+  return vm;
+}
+
+class VMEngines : public ::testing::TestWithParam<bc::Engine> {};
+
+}  // namespace
+
+TEST_P(VMEngines, CountingLoop) {
+  const char* source =
+    "_main:\n"
+    "  mov r1, 0\n"
+    "  mov r2, 0\n"
+    "loop:\n"
+    "  add r1, 1\n"
+    "  add r2, r1\n"
+    "  cmp r1, 100\n"
+    "  jneq loop\n"
+    "  mov r1, 0\n"
+    "  syscall\n";
+
+  bc::VM vm = run_and_compare(source, GetParam());
+  EXPECT_EQ(vm.get_register(bc::R2), 5050u);
+}
+
+TEST_P(VMEngines, MemoryOperandsAndAlu) {
+  const char* source =
+    "_main:\n"
+    "  mov [cell], 0x0F0F0F0F\n"
+    "  mov r1, [cell]\n"
+    "  xor r1, 0xFFFFFFFF\n"
+    "  sub r1, [cell]\n"
+    "  mov [cell], r1\n"
+    "  add r2, [cell]\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB cell[4]\n";
+
+  bc::VM vm = run_and_compare(source, GetParam());
+  EXPECT_EQ(vm.get_register(bc::R2), 0xF0F0F0F0u - 0x0F0F0F0Fu);
+}
+
+TEST_P(VMEngines, SignedAndUnsignedBranches) {
+  const char* source =
+    "_main:\n"
+    "  mov r1, 0xFFFFFFFF\n"
+    "  cmp r1, 1\n"
+    "  jla unsigned_ok\n"
+    "  mov r8, 1\n"
+    "unsigned_ok:\n"
+    "  mov rS, 1\n"
+    "  cmp r1, 1\n"
+    "  jle signed_ok\n"
+    "  mov r8, 2\n"
+    "signed_ok:\n"
+    "  mov r5, after\n"
+    "  jmp r5\n"
+    "  mov r8, 3\n"
+    "after:\n"
+    "  mov r1, 0\n"
+    "  syscall\n";
+
+  bc::VM vm = run_and_compare(source, GetParam());
+  EXPECT_EQ(vm.get_register(bc::R8), 0u);
+  EXPECT_NE(vm.get_register(bc::RF) & bc::F_TEST_TRUE, 0u);
+}
+
+TEST_P(VMEngines, ConditionFlagsObservedThroughRf) {
+  // The compare latches rS; flipping rS afterwards must not change the branch.
+  const char* source =
+    "_main:\n"
+    "  mov r1, 0xFFFFFFFF\n"
+    "  cmp r1, 1\n"
+    "  mov rS, 1\n"
+    "  jla taken\n"
+    "  mov r8, 1\n"
+    "taken:\n"
+    "  cmp r1, r1\n"
+    "  mov r2, rF\n"
+    "  cmp r1, 2\n"
+    "  xor rF, rF\n"
+    "  add r3, rF\n"
+    "  cmp r3, 5\n"
+    "  mov r1, 0\n"
+    "  syscall\n";
+
+  bc::VM vm = run_and_compare(source, GetParam());
+  EXPECT_EQ(vm.get_register(bc::R8), 0u);
+  EXPECT_EQ(vm.get_register(bc::R2), static_cast<std::uint32_t>(bc::F_EQ | bc::F_TEST_TRUE));
+  EXPECT_EQ(vm.get_register(bc::R3), 0u);
+  EXPECT_EQ(vm.get_register(bc::RF), static_cast<std::uint32_t>(bc::F_LT));
+}
+
+TEST_P(VMEngines, FaultsMatchSwitchEngine) {
+  bc::VM read_fault = run_and_compare(
+    "_main:\n"
+    "  mov r1, [0xFFFFFF00]\n", GetParam());
+  EXPECT_NE(read_fault.get_register(bc::RF) & bc::F_READ_OOB, 0u);
+
+  bc::VM fall_off = run_and_compare(
+    "_main:\n"
+    "  mov r1, 1\n", GetParam());
+  EXPECT_NE(fall_off.get_register(bc::RF) & bc::F_IP_OOB, 0u);
+
+  bc::VM bad_target = run_and_compare(
+    "_main:\n"
+    "  jmp 1\n", GetParam());
+  EXPECT_NE(bad_target.get_register(bc::RF) & bc::F_BAD_INSTR, 0u);
+}
+
+TEST_P(VMEngines, SelfModifyingCode) {
+  // "mov r2, 1" sits at offset 7, so its immediate lives at 10..13.
+  const char* source =
+    "_main:\n"
+    "  mov r3, 0\n"
+    "top:\n"
+    "  mov r2, 1\n"
+    "  add r3, r2\n"
+    "  cmp r3, 1\n"
+    "  jneq done\n"
+    "  mov [10], 5\n"
+    "  jmp top\n"
+    "done:\n"
+    "  mov r1, 0\n"
+    "  syscall\n";
+
+  bc::VM vm = run_and_compare(source, GetParam());
+  EXPECT_EQ(vm.get_register(bc::R3), 6u);
+}
+
+TEST_P(VMEngines, JumpIntoFusedSequence) {
+  // add/cmp/jneq at "loop" is a fused loop tail; "check" lands on its branch.
+  const char* source =
+    "_main:\n"
+    "  mov r1, 0\n"
+    "  mov r2, 0\n"
+    "  jmp check\n"
+    "loop:\n"
+    "  add r1, 1\n"
+    "  add r2, 3\n"
+    "  cmp r2, 30\n"
+    "check:\n"
+    "  jneq loop\n"
+    "  mov r1, 0\n"
+    "  syscall\n";
+
+  bc::VM vm = run_and_compare(source, GetParam());
+  EXPECT_EQ(vm.get_register(bc::R2), 30u);
+  EXPECT_EQ(vm.get_register(bc::RF) & (bc::F_EQ | bc::F_TEST_TRUE), static_cast<std::uint32_t>(bc::F_EQ));
+}
+
+TEST_P(VMEngines, RunForSlicesMatchRun) {
+  const char* source =
+    "_main:\n"
+    "  mov r1, 0\n"
+    "  mov r2, 0\n"
+    "loop:\n"
+    "  add r1, 1\n"
+    "  add r2, r1\n"
+    "  cmp r1, 1000\n"
+    "  jneq loop\n"
+    "  mov r1, 0\n"
+    "  syscall\n";
+
+  bc::VM reference = bc_test::make_vm(source);
+  reference.run();
+
+  bc::VM vm = bc_test::make_vm(source);
+  vm.set_engine(GetParam());
+  int slices = 0;
+  bc::RunStatus status = bc::RunStatus::BudgetExhausted;
+  while (status == bc::RunStatus::BudgetExhausted && slices < 10000) {
+    status = vm.run_for(100);
+    slices += 1;
+  }
+
+  EXPECT_EQ(status, bc::RunStatus::Halted);
+  // 4000 loop instructions at 100 per slice, overshooting by at most one block.
+  EXPECT_GE(slices, 30);
+  EXPECT_LE(slices, 41);
+  for (std::uint8_t reg = 0; reg < bc::REG_COUNT; reg += 1) {
+    EXPECT_EQ(vm.get_register(static_cast<bc::Register>(reg)),
+              reference.get_register(static_cast<bc::Register>(reg)))
+        << "register " << bc::register_name(reg);
+  }
+}
+
+TEST_P(VMEngines, RunForReportsFaultsAndIpWriteLoops) {
+  bc::VM faulted = bc_test::make_vm(
+    "_main:\n"
+    "  mov r1, [0xFFFFFF00]\n");
+  faulted.set_engine(GetParam());
+  EXPECT_EQ(faulted.run_for(1000), bc::RunStatus::Faulted);
+  EXPECT_EQ(faulted.run_for(1000), bc::RunStatus::Faulted);
+
+  // Fault bits the guest writes into rF itself are not a fault.
+  bc::VM flagged = bc_test::make_vm(
+    "_main:\n"
+    "  mov rF, 0x80\n"
+    "  mov r1, 0\n"
+    "  syscall\n");
+  flagged.set_engine(GetParam());
+  EXPECT_EQ(flagged.run_for(1000), bc::RunStatus::Halted);
+  EXPECT_NE(flagged.get_register(bc::RF) & bc::F_WRITE_OOB, 0u);
+
+  // A loop closed by an IP write instead of a branch must still be bounded.
+  bc::VM spinning = bc_test::make_vm(
+    "_main:\n"
+    "top:\n"
+    "  add r1, 1\n"
+    "  mov IP, top\n");
+  spinning.set_engine(GetParam());
+  EXPECT_EQ(spinning.run_for(50), bc::RunStatus::BudgetExhausted);
+  EXPECT_EQ(spinning.get_register(bc::R1), 25u);
+  EXPECT_EQ(spinning.run_for(0), bc::RunStatus::BudgetExhausted);
+  EXPECT_EQ(spinning.get_register(bc::R1), 25u);
+}
+
+TEST_P(VMEngines, RunForYieldsBeforeStdinRead) {
+  const char* source =
+    "_main:\n"
+    "  mov r1, 2\n"
+    "  mov r2, 0\n"
+    "  mov r3, buffer\n"
+    "  mov r4, 4\n"
+    "  syscall\n"
+    "  mov r5, [buffer]\n"
+    "  mov r1, 0\n"
+    "  syscall\n"
+    "_data:\n"
+    "  DB buffer[4]\n";
+
+  bc::VM vm = bc_test::make_vm(source);
+  vm.set_engine(GetParam());
+  EXPECT_EQ(vm.run_for(1000), bc::RunStatus::BlockedOnSyscall);
+  EXPECT_EQ(vm.get_register(bc::IP), 28u);
+
+  std::istringstream input("ABCD");
+  std::streambuf* saved = std::cin.rdbuf(input.rdbuf());
+  bc::RunStatus status = vm.run_for(1000);
+  std::cin.rdbuf(saved);
+
+  EXPECT_EQ(status, bc::RunStatus::Halted);
+  EXPECT_EQ(vm.get_register(bc::R5), 0x44434241u);
+
+  // Input that is already buffered is read in the same slice.
+  bc::VM ready = bc_test::make_vm(source);
+  ready.set_engine(GetParam());
+  std::istringstream buffered("WXYZ");
+  saved = std::cin.rdbuf(buffered.rdbuf());
+  status = ready.run_for(1000);
+  std::cin.rdbuf(saved);
+  EXPECT_EQ(status, bc::RunStatus::Halted);
+  EXPECT_EQ(ready.get_register(bc::R5), 0x5A595857u);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllEngines,
+                         VMEngines,
+                         ::testing::Values(bc::Engine::Switch,
+                                           bc::Engine::Predecoded,
+                                           bc::Engine::Threaded,
+                                           bc::Engine::Cached,
+                                           bc::Engine::Jit,
+                                           bc::Engine::Tiered),
+                         [](const ::testing::TestParamInfo<bc::Engine>& info) {
+                           return std::string(bc::engine_name(info.param));
+                         });